@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bf.h"
+#include "bplus_file_funcs.h"
+#include "record_generator.h"
+
+/*
+ * Checks that inserts and lookups on an open B+ tree file make no heap allocations: inserts take their buffers from
+ * the file's insert arena, and bplus_record_get/bplus_record_contains copy into buffers of the caller.
+ * Build with the bplus_alloc_check_compile target, which links with -Wl,--wrap for the allocation functions, so that
+ * every call to them from the bplus layer goes through the counters below (the BF library is not counted).
+ * Exits with 1 if the counts change across the batches.
+ */
+
+#define CALL_OR_DIE(call)     \
+{                             \
+  BF_ErrorCode code = call;   \
+  if (code != BF_OK) {        \
+    BF_PrintError(code);      \
+    exit(code);               \
+  }                           \
+}
+
+#define FILE_NAME "alloc_check.db"
+#define INSERT_NUM 20000 // inserts in the counted batch, enough for many data and index block splits
+#define LOOKUP_NUM 20000
+
+static long allocation_count = 0;
+static long free_count = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void __real_free(void *pointer);
+
+void *__wrap_malloc(size_t size) {
+  allocation_count++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  allocation_count++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+  allocation_count++;
+  return __real_realloc(pointer, size);
+}
+
+void __wrap_free(void *pointer) {
+  if (pointer) free_count++;
+  __real_free(pointer);
+}
+
+// prints the allocations and frees made since the counts were taken; returns 1 if there were any
+static int report(const char *name, int operations, long allocations_before, long frees_before) {
+  long allocations = allocation_count - allocations_before;
+  long frees = free_count - frees_before;
+  printf("%-24s %6d operations, %ld allocations, %ld frees\n", name, operations, allocations, frees);
+  return allocations != 0 || frees != 0;
+}
+
+int main() {
+  TableSchema schema = employee_get_schema();
+
+  CALL_OR_DIE(BF_Init(LRU));
+  remove(FILE_NAME);
+  bplus_create_file(&schema, FILE_NAME);
+
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(FILE_NAME, &file_desc, &info) != 0) {
+    printf("bplus_open_file failed\n");
+    return 1;
+  }
+
+  // the records are generated up front, so that only the bplus calls are counted
+  Record *records = malloc(INSERT_NUM * sizeof(Record));
+  srand(42);
+  for (int i = 0; i < INSERT_NUM; i++)
+    employee_random_record(&schema, &records[i]);
+
+  int failed = 0;
+  int blocks_before = info->block_count;
+  long allocations_before = allocation_count, frees_before = free_count;
+  for (int i = 0; i < INSERT_NUM; i++)
+    bplus_record_insert(file_desc, info, &records[i]);
+  failed |= report("bplus_record_insert", INSERT_NUM, allocations_before, frees_before);
+  printf("%-24s %6d blocks added by splits\n", "", info->block_count - blocks_before);
+
+  int found = 0;
+  Record result;
+  allocations_before = allocation_count;
+  frees_before = free_count;
+  for (int i = 0; i < LOOKUP_NUM; i++)
+    found += (bplus_record_get(file_desc, info, rand() % 100000, &result) == 1);
+  failed |= report("bplus_record_get", LOOKUP_NUM, allocations_before, frees_before);
+
+  allocations_before = allocation_count;
+  frees_before = free_count;
+  for (int i = 0; i < LOOKUP_NUM; i++)
+    found += (bplus_record_contains(file_desc, info, rand() % 100000) == 1);
+  failed |= report("bplus_record_contains", LOOKUP_NUM, allocations_before, frees_before);
+
+  free(records);
+  bplus_close_file(file_desc, info);
+  CALL_OR_DIE(BF_Close());
+  remove(FILE_NAME);
+
+  printf("%d lookups found; %s\n", found, failed ? "FAILED: the batches allocated memory" : "OK");
+  return failed;
+}
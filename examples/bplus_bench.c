@@ -0,0 +1,1201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bf.h"
+#include "bplus_file_funcs.h"
+#include "record_generator.h"
+
+#define BENCH_FILE "bench.db"
+#define INGEST_FILE "ingest.db"
+#define DEFAULT_RECORDS 200 // small enough for the whole tree to stay in the BF_BUFFER_SIZE frames
+#define DEFAULT_LOOKUPS 1000000
+#define DEFAULT_INGEST_RECORDS 50000 // large enough for the tree to be evicted from the BF_BUFFER_SIZE frames
+#define IO_MODE_LOOKUPS 20000
+#define WARM_HOT_KEYS 1000 // the hot keys of the warm restart case are [0, WARM_HOT_KEYS), about BF_BUFFER_SIZE blocks
+#define WARM_LOOKUPS 200 // only the first lookups after a restart differ
+#define QUOTA_ROUNDS 50
+#define QUOTA_ROUND_LOOKUPS 200 // lookups on each of the two files per round
+#define ARENA_LOOKUPS 1000000
+#define SCAN_ROUND_RECORDS 200 // records scanned on the large tree between two rounds of lookups on the small one
+#define BLOOM_LOOKUPS 200000 // random keys of [0, 200000), most of which are not in the ingest tree
+#define ZIPF_LOOKUPS 1000000
+#define SORTED_LOOKUPS 200000 // keys of [0, SORTED_LOOKUPS), in ascending order or shuffled
+#define SECONDARY_QUERIES 20 // surname equality queries per case
+#define EVENT_FILE "events.db"
+#define EVENT_LONG_FILE "events_long.db" // the events, in a LONG key file with the 64-bit ids as keys
+#define EVENT_RECORDS 20000
+#define EVENT_LOOKUPS 20000 // random events, by their int key or by their 64-bit id
+#define ORDER_QUERIES 200 // key range counts and pages by offset per case
+#define ORDER_PAGE_SIZE 50
+#define ORDER_FILE "order.db" // a copy of the ingest tree with subtree counts
+#define SALES_FILE "sales.db"
+#define SALES_RECORDS 50000
+#define SALES_QUERIES 200 // aggregates of the amounts of random key ranges
+#define FILTER_QUERIES 20 // full scans for city = 'Athina'
+#define PARALLEL_SCANS 20 // full scans per case; a cold one drops the file from the page cache before each
+#define LAYOUT_FILE "layout.db"
+#define LAYOUT_SCANS 20 // scans of all the city values per case
+#define LAYOUT_LOOKUPS 200000
+
+// Macro to handle BF library errors
+#define CALL_OR_DIE(call)     \
+{                             \
+  BF_ErrorCode code = call;   \
+  if (code != BF_OK) {        \
+    BF_PrintError(code);      \
+    exit(code);               \
+  }                           \
+}
+
+double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void report(const char *name, int lookups, int found, double seconds) {
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %.3f s)\n", name, lookups / seconds, found, lookups, seconds);
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Reads a counter of /proc/self/io (e.g. "wchar", "syscw"), or returns -1 if it is not available.
+ */
+long read_io_counter(const char *name) {
+  FILE *file = fopen("/proc/self/io", "r");
+  if (file == NULL) return -1;
+
+  char line[128];
+  long value = -1;
+  size_t name_length = strlen(name);
+  while (fgets(line, sizeof(line), file)) {
+    if (strncmp(line, name, name_length) == 0 && line[name_length] == ':') {
+      value = atol(line + name_length + 1);
+      break;
+    }
+  }
+  fclose(file);
+  return value;
+}
+
+/**
+ * Inserts rec_num random employee records in a file of their own, reporting the latency
+ * distribution of the inserts and the write traffic they cause (dirty blocks written by BF).
+ */
+void bench_ingest(const TableSchema *schema, int rec_num) {
+  remove(INGEST_FILE);
+  bplus_create_file(schema, INGEST_FILE);
+
+  int file_desc;
+  BPlusMeta *info;
+  bplus_open_file(INGEST_FILE, &file_desc, &info);
+
+  double *latencies = malloc(rec_num * sizeof(double));
+  long written_before = read_io_counter("wchar");
+  long writes_before = read_io_counter("syscw");
+
+  Record record;
+  srand(1234);
+  double start = now_seconds();
+  for (int i = 0; i < rec_num; i++) {
+    employee_random_record(schema, &record);
+    double insert_start = now_seconds();
+    bplus_record_insert(file_desc, info, &record);
+    latencies[i] = now_seconds() - insert_start;
+  }
+  double seconds = now_seconds() - start;
+
+  long written = read_io_counter("wchar") - written_before;
+  long writes = read_io_counter("syscw") - writes_before;
+  bplus_close_file(file_desc, info);
+
+  qsort(latencies, rec_num, sizeof(double), compare_doubles);
+  printf("%-32s %12.0f inserts/s  (p50 %.1f us, p99 %.1f us, max %.1f us, %ld writes, %ld KB written)\n",
+         "bplus_record_insert", rec_num / seconds, latencies[rec_num / 2] * 1e6,
+         latencies[(int)(rec_num * 0.99)] * 1e6, latencies[rec_num - 1] * 1e6, writes, written / 1024);
+  free(latencies);
+}
+
+/**
+ * Returns how many KB of the file are currently in the kernel page cache (mincore), or -1 on failure.
+ */
+long page_cache_kb(const char *file_name) {
+  int fd = open(file_name, O_RDONLY);
+  if (fd == -1) return -1;
+
+  struct stat st;
+  fstat(fd, &st);
+  long page_size = sysconf(_SC_PAGESIZE);
+  long page_count = (st.st_size + page_size - 1) / page_size;
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  unsigned char *residency = malloc(page_count);
+  long resident = -1;
+  if (map != MAP_FAILED && mincore(map, st.st_size, residency) == 0) {
+    resident = 0;
+    for (long i = 0; i < page_count; i++)
+      resident += residency[i] & 1;
+  }
+
+  if (map != MAP_FAILED) munmap(map, st.st_size);
+  free(residency);
+  close(fd);
+  return (resident == -1) ? -1 : resident * page_size / 1024;
+}
+
+/**
+ * Random lookups on the (large) ingest tree, with the given page cache mode of the file.
+ */
+void bench_io_mode(int mode, int lookup_num) {
+  int file_desc;
+  BPlusMeta *info;
+  bplus_open_file(INGEST_FILE, &file_desc, &info);
+  bplus_set_io_mode(file_desc, mode);
+
+  srand(99);
+  int found = 0;
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++) {
+    Record *result;
+    if (bplus_record_find(file_desc, info, rand() % 200000, &result) == 0) {
+      found++;
+      free(result);
+    }
+  }
+  double seconds = now_seconds() - start;
+  long cached_kb = page_cache_kb(INGEST_FILE);
+
+  bplus_close_file(file_desc, info);
+
+  char name[64];
+  snprintf(name, sizeof(name), "bplus_record_find (%s)", (mode == BPLUS_IO_UNCACHED) ? "uncached" : "buffered");
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %ld KB of file in page cache)\n",
+         name, lookup_num / seconds, found, lookup_num, cached_kb);
+}
+
+/**
+ * Random lookups on the (large) ingest tree, with the file opened read-only in a memory mapping.
+ */
+void bench_mmap(int lookup_num) {
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file_mmap(INGEST_FILE, &file_desc, &info) != 0) {
+    printf("bplus_open_file_mmap failed\n");
+    return;
+  }
+
+  srand(99); // the same keys as bench_io_mode
+  int found = 0;
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++) {
+    Record *result;
+    if (bplus_record_find(file_desc, info, rand() % 200000, &result) == 0) {
+      found++;
+      free(result);
+    }
+  }
+  double seconds = now_seconds() - start;
+
+  bplus_close_file(file_desc, info);
+  report("bplus_record_find (mmap)", lookup_num, found, seconds);
+}
+
+/**
+ * Writes back and drops the kernel copies of a file's blocks, as after a restart of the machine.
+ */
+void drop_page_cache(const char *file_name) {
+  int fd = open(file_name, O_RDONLY);
+  if (fd == -1) return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+/**
+ * Hot lookups right after opening the ingest tree, with an empty buffer pool and page cache.
+ */
+void bench_restart(int preload, int lookup_num) {
+  drop_page_cache(INGEST_FILE);
+
+  int file_desc;
+  BPlusMeta *info;
+  bplus_open_file(INGEST_FILE, &file_desc, &info);
+
+  double start = now_seconds();
+  int preloaded = preload ? bplus_warm_preload(file_desc, info) : 0;
+  double preload_seconds = now_seconds() - start;
+
+  srand(5);
+  int found = 0;
+  start = now_seconds();
+  for (int i = 0; i < lookup_num; i++) {
+    Record *result;
+    if (bplus_record_find(file_desc, info, rand() % WARM_HOT_KEYS, &result) == 0) {
+      found++;
+      free(result);
+    }
+  }
+  double seconds = now_seconds() - start;
+
+  bplus_close_file(file_desc, info);
+
+  char name[64];
+  snprintf(name, sizeof(name), "bplus_record_find (%s restart)", preload ? "warm" : "cold");
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %d blocks preloaded in %.2f ms)\n",
+         name, lookup_num / seconds, found, lookup_num, preloaded, preload_seconds * 1e3);
+}
+
+/**
+ * Hot lookups on the ingest tree, tracking its working set so that it is saved on close, then a cold and a warm
+ * restart.
+ */
+void bench_warm_restart(int lookup_num) {
+  int file_desc;
+  BPlusMeta *info;
+  bplus_open_file(INGEST_FILE, &file_desc, &info);
+  bplus_warm_enable(file_desc);
+
+  srand(3);
+  for (int i = 0; i < 10 * lookup_num; i++) {
+    Record *result;
+    if (bplus_record_find(file_desc, info, rand() % WARM_HOT_KEYS, &result) == 0)
+      free(result);
+  }
+  bplus_close_file(file_desc, info);
+
+  bench_restart(0, lookup_num);
+  bench_restart(1, lookup_num);
+}
+
+/**
+ * Rounds of lookups on the small bench tree alternating with random lookups on the large ingest tree, which
+ * evict the small tree's blocks unless it has a min frame quota; reports the block reads of the small tree.
+ */
+void bench_quota(int min_frames, const int *lookup_keys, int lookup_num) {
+  int small_desc, large_desc;
+  BPlusMeta *small_info, *large_info;
+  bplus_open_file(BENCH_FILE, &small_desc, &small_info);
+  bplus_open_file(INGEST_FILE, &large_desc, &large_info);
+  if (min_frames > 0 && bplus_set_frame_quota(small_desc, min_frames, 0) != 0)
+    printf("bplus_set_frame_quota failed\n");
+
+  srand(11);
+  int found = 0, lookups = 0, next_key = 0;
+  long reads = 0;
+  double seconds = 0;
+  for (int round = 0; round < QUOTA_ROUNDS; round++) {
+    long reads_before = read_io_counter("syscr");
+    double start = now_seconds();
+    for (int i = 0; i < QUOTA_ROUND_LOOKUPS; i++, lookups++) {
+      Record *result;
+      if (bplus_record_find(small_desc, small_info, lookup_keys[next_key++ % lookup_num], &result) == 0) {
+        found++;
+        free(result);
+      }
+    }
+    seconds += now_seconds() - start;
+    reads += read_io_counter("syscr") - reads_before;
+
+    for (int i = 0; i < QUOTA_ROUND_LOOKUPS; i++) {
+      Record *result;
+      if (bplus_record_find(large_desc, large_info, rand() % 200000, &result) == 0)
+        free(result);
+    }
+  }
+  int resident = bplus_pool_resident_frames(small_desc);
+
+  bplus_close_file(large_desc, large_info);
+  bplus_close_file(small_desc, small_info);
+
+  char name[64];
+  snprintf(name, sizeof(name), "bplus_record_find (min quota %d)", min_frames);
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %ld block reads, %d frames held at the end)\n",
+         name, lookups / seconds, found, lookups, reads, resident);
+}
+
+/**
+ * Rounds of lookups on the small bench tree alternating with a full scan of the large ingest tree, with the given
+ * access hint for the scan; reports the block reads of the small tree and the speed of the scan.
+ */
+void bench_scan(int access_hint, const int *lookup_keys, int lookup_num) {
+  int small_desc, large_desc;
+  BPlusMeta *small_info, *large_info;
+  bplus_open_file(BENCH_FILE, &small_desc, &small_info);
+  bplus_open_file(INGEST_FILE, &large_desc, &large_info);
+
+  BPlusScan scan;
+  bplus_scan_open(&scan, large_desc, large_info, 0, access_hint);
+
+  int found = 0, lookups = 0, next_key = 0, scanned = 0, scan_result = 1;
+  long reads = 0;
+  double lookup_seconds = 0, scan_seconds = 0;
+  while (scan_result == 1) {
+    long reads_before = read_io_counter("syscr");
+    double start = now_seconds();
+    for (int i = 0; i < QUOTA_ROUND_LOOKUPS; i++, lookups++) {
+      Record *result;
+      if (bplus_record_find(small_desc, small_info, lookup_keys[next_key++ % lookup_num], &result) == 0) {
+        found++;
+        free(result);
+      }
+    }
+    lookup_seconds += now_seconds() - start;
+    reads += read_io_counter("syscr") - reads_before;
+
+    Record record;
+    start = now_seconds();
+    for (int i = 0; i < SCAN_ROUND_RECORDS && (scan_result = bplus_scan_next(&scan, &record)) == 1; i++)
+      scanned++;
+    scan_seconds += now_seconds() - start;
+  }
+  bplus_scan_close(&scan);
+
+  bplus_close_file(large_desc, large_info);
+  bplus_close_file(small_desc, small_info);
+
+  char name[64];
+  snprintf(name, sizeof(name), "bplus_record_find (%s scan)", (access_hint == BPLUS_ACCESS_SCAN) ? "ring" : "LRU");
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %ld block reads; %d records scanned at %.0f/s)\n",
+         name, lookups / lookup_seconds, found, lookups, reads, scanned, scanned / scan_seconds);
+}
+
+/**
+ * Returns how many KB of the process's anonymous memory are backed by transparent huge pages, or -1 on failure.
+ */
+long anon_huge_pages_kb() {
+  FILE *file = fopen("/proc/self/smaps_rollup", "r");
+  if (file == NULL) return -1;
+
+  char line[128];
+  long value = -1;
+  while (fgets(line, sizeof(line), file)) {
+    if (strncmp(line, "AnonHugePages:", 14) == 0) {
+      value = atol(line + 14);
+      break;
+    }
+  }
+  fclose(file);
+  return value;
+}
+
+/**
+ * Random lookups on the (large) ingest tree, with the file read into an arena of huge or small pages
+ * (arena_flags), or mapped from the page cache (arena_flags -1).
+ */
+void bench_arena(int arena_flags, int lookup_num) {
+  int file_desc;
+  BPlusMeta *info;
+  int result = (arena_flags == -1) ? bplus_open_file_mmap(INGEST_FILE, &file_desc, &info)
+                                   : bplus_open_file_arena(INGEST_FILE, &file_desc, &info, arena_flags);
+  if (result != 0) {
+    printf("opening %s failed\n", INGEST_FILE);
+    return;
+  }
+
+  srand(17);
+  int found = 0;
+  Record record;
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++)
+    found += bplus_mmap_find(bplus_handle_get(file_desc), info, rand() % 200000, &record);
+  double seconds = now_seconds() - start;
+  long huge_kb = anon_huge_pages_kb();
+
+  bplus_close_file(file_desc, info);
+
+  char name[64];
+  snprintf(name, sizeof(name), "bplus_mmap_find (%s)",
+           (arena_flags == -1) ? "file mapping" : (arena_flags == BPLUS_ARENA_HUGE_PAGES) ? "huge page arena" : "4K arena");
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %ld KB in huge pages)\n",
+         name, lookup_num / seconds, found, lookup_num, huge_kb);
+}
+
+/**
+ * Inserts rec_num random employee records and returns their keys (caller frees).
+ */
+int *build_tree(const TableSchema *schema, int rec_num) {
+  remove(BENCH_FILE);
+  bplus_create_file(schema, BENCH_FILE);
+
+  int file_desc;
+  BPlusMeta *info;
+  bplus_open_file(BENCH_FILE, &file_desc, &info);
+
+  int *keys = malloc(rec_num * sizeof(int));
+  Record record;
+  srand(42);
+  for (int i = 0; i < rec_num; i++) {
+    employee_random_record(schema, &record);
+    keys[i] = record_get_key(schema, &record);
+    bplus_record_insert(file_desc, info, &record);
+  }
+
+  bplus_close_file(file_desc, info);
+  return keys;
+}
+
+/**
+ * Lookups of lookup_num keys with bplus_record_find, one at a time.
+ */
+void bench_single(int file_desc, BPlusMeta *info, const int *lookup_keys, int lookup_num) {
+  int found = 0;
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++) {
+    Record *result;
+    if (bplus_record_find(file_desc, info, lookup_keys[i], &result) == 0) {
+      found++;
+      free(result);
+    }
+  }
+  report("bplus_record_find", lookup_num, found, now_seconds() - start);
+}
+
+/**
+ * Random lookups on the ingest tree, most of them for missing keys, without a Bloom filter (false_positive_rate 0)
+ * or with one; reports the block reads and how many lookups the filter answered.
+ */
+void bench_bloom(double false_positive_rate, int lookup_num) {
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(INGEST_FILE, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", INGEST_FILE);
+    return;
+  }
+
+  double enable_start = now_seconds();
+  if (false_positive_rate > 0 && bplus_bloom_enable(file_desc, info, false_positive_rate) != 0)
+    printf("bplus_bloom_enable failed\n");
+  double enable_seconds = now_seconds() - enable_start;
+
+  srand(13);
+  int found = 0;
+  long reads_before = read_io_counter("syscr");
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++)
+    found += (bplus_record_contains(file_desc, info, rand() % 200000) == 1);
+  double seconds = now_seconds() - start;
+  long reads = read_io_counter("syscr") - reads_before;
+
+  BPlusBloomStats stats = { 0 };
+  bplus_bloom_stats(file_desc, &stats);
+  bplus_close_file(file_desc, info);
+
+  char name[64];
+  if (false_positive_rate > 0)
+    snprintf(name, sizeof(name), "bplus_record_contains (bloom %g)", false_positive_rate);
+  else
+    snprintf(name, sizeof(name), "bplus_record_contains (no bloom)");
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %ld block reads, %ld filtered, %ld false positives, built in %.1f ms)\n",
+         name, lookup_num / seconds, found, lookup_num, reads, stats.negatives, stats.false_positives,
+         enable_seconds * 1000);
+}
+
+/**
+ * Zipfian lookups (s = 1) on the ingest tree: its keys are ranked in a random order, and the key of rank r is asked
+ * for with probability proportional to 1 / r; with a record cache of cache_bytes (0 for none).
+ */
+void bench_zipf(size_t cache_bytes, int lookup_num) {
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(INGEST_FILE, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", INGEST_FILE);
+    return;
+  }
+
+  // the keys of the tree, in a random order of ranks
+  int key_count = 0;
+  int *keys = malloc(info->record_count * sizeof(int));
+  BPlusScan scan;
+  Record record;
+  bplus_scan_open(&scan, file_desc, info, 0, BPLUS_ACCESS_SCAN);
+  while (key_count < info->record_count && bplus_scan_next(&scan, &record) == 1)
+    keys[key_count++] = record_get_key(&(info->schema), &record);
+  bplus_scan_close(&scan);
+
+  srand(17);
+  for (int i = key_count - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    int temp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = temp;
+  }
+
+  // drawing the lookups from the cumulative weights of the ranks
+  double *cumulative = malloc(key_count * sizeof(double));
+  double sum = 0;
+  for (int i = 0; i < key_count; i++) {
+    sum += 1.0 / (i + 1);
+    cumulative[i] = sum;
+  }
+
+  int *lookup_keys = malloc(lookup_num * sizeof(int));
+  for (int i = 0; i < lookup_num; i++) {
+    double target = (double)rand() / ((double)RAND_MAX + 1) * sum;
+    int low = 0, high = key_count - 1;
+    while (low < high) {
+      int mid = (low + high) / 2;
+      if (cumulative[mid] <= target)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+    lookup_keys[i] = keys[low];
+  }
+
+  if (cache_bytes > 0 && bplus_cache_enable(file_desc, cache_bytes) != 0)
+    printf("bplus_cache_enable failed\n");
+
+  int found = 0;
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++)
+    found += (bplus_record_get(file_desc, info, lookup_keys[i], &record) == 1);
+  double seconds = now_seconds() - start;
+
+  BPlusCacheStats stats = { 0 };
+  bplus_cache_stats(file_desc, &stats);
+  bplus_close_file(file_desc, info);
+
+  char name[64];
+  snprintf(name, sizeof(name), "bplus_record_get (zipf, %zuK)", cache_bytes / 1024);
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %ld hits, %ld misses, %ld evictions)\n",
+         name, lookup_num / seconds, found, lookup_num, stats.hits, stats.misses, stats.evictions);
+
+  free(keys);
+  free(cumulative);
+  free(lookup_keys);
+}
+
+/**
+ * Lookups of every key of [0, lookup_num) on the ingest tree, in ascending order (sorted) or shuffled; reports how
+ * many of them started from the finger of the previous one instead of descending from the root.
+ */
+void bench_finger(int sorted, int lookup_num) {
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(INGEST_FILE, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", INGEST_FILE);
+    return;
+  }
+
+  int *lookup_keys = malloc(lookup_num * sizeof(int));
+  for (int i = 0; i < lookup_num; i++)
+    lookup_keys[i] = i;
+  srand(19);
+  for (int i = lookup_num - 1; i > 0 && !sorted; i--) {
+    int j = rand() % (i + 1);
+    int temp = lookup_keys[i];
+    lookup_keys[i] = lookup_keys[j];
+    lookup_keys[j] = temp;
+  }
+
+  BPlusFingerStats before, after;
+  bplus_finger_stats(file_desc, &before);
+  int found = 0;
+  Record record;
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++)
+    found += (bplus_record_get(file_desc, info, lookup_keys[i], &record) == 1);
+  double seconds = now_seconds() - start;
+  bplus_finger_stats(file_desc, &after);
+  bplus_close_file(file_desc, info);
+
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %ld from the finger, %ld from the root)\n",
+         sorted ? "bplus_record_get (sorted keys)" : "bplus_record_get (shuffled keys)", lookup_num / seconds, found,
+         lookup_num, after.hits - before.hits, after.misses - before.misses);
+  free(lookup_keys);
+}
+
+/**
+ * Surname equality queries on the ingest tree: by a full scan over the leaf chain (mode 0), or with a secondary index
+ * on surname, getting the primary keys only (mode 1) or the records as well (mode 2).
+ */
+void bench_secondary(int mode, int query_num) {
+  const char *surnames[] = {"Papadopoulos", "Georgiou", "Nikolaou", "Kostopoulos", "Smith"}; // the last one is missing
+  const int surname_count = sizeof(surnames) / sizeof(surnames[0]);
+
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(INGEST_FILE, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", INGEST_FILE);
+    return;
+  }
+
+  double index_start = now_seconds();
+  if (mode != 0 && bplus_create_secondary_index(file_desc, info, "surname") != 0)
+    printf("bplus_create_secondary_index failed\n");
+  double index_seconds = now_seconds() - index_start;
+  BPlusSecondaryStats index_stats = {0, 0};
+  if (mode != 0)
+    bplus_secondary_stats(file_desc, info, "surname", &index_stats);
+
+  int *primary_keys = malloc(info->record_count * sizeof(int));
+  Record *records = malloc(info->record_count * sizeof(Record));
+  Record probe;
+  long found = 0;
+  long reads_before = read_io_counter("syscr");
+  double start = now_seconds();
+  for (int i = 0; i < query_num; i++) {
+    const char *surname = surnames[i % surname_count];
+    record_create(&(info->schema), &probe, 0, "", surname, "");
+    if (mode == 0) {
+      BPlusScan scan;
+      Record record;
+      bplus_scan_open(&scan, file_desc, info, INT_MIN, BPLUS_ACCESS_SCAN);
+      while (bplus_scan_next(&scan, &record) == 1)
+        found += (strncmp(record.values[2].string_value, surname, 20) == 0);
+      bplus_scan_close(&scan);
+    } else if (mode == 1) {
+      found += bplus_secondary_find(file_desc, info, "surname", &probe, primary_keys, info->record_count);
+    } else {
+      found += bplus_secondary_find_records(file_desc, info, "surname", &probe, records, info->record_count);
+    }
+  }
+  double seconds = now_seconds() - start;
+  long reads = read_io_counter("syscr") - reads_before;
+  bplus_close_file(file_desc, info);
+  free(primary_keys);
+  free(records);
+
+  const char *names[] = {"surname = ? (full scan)", "bplus_secondary_find", "bplus_secondary_find_records"};
+  printf("%-32s %12.1f queries/s  (%ld records found, %ld block reads per query, index of %d entries in %d blocks "
+         "opened in %.1f ms)\n", names[mode], query_num / seconds, found, reads / query_num, index_stats.entry_count,
+         index_stats.block_count, index_seconds * 1000);
+}
+
+/**
+ * Counts the index blocks of a tree (int key or keyed ones) and their children.
+ */
+void count_index_blocks(int file_desc, const BPlusMeta *info, int *index_blocks, int *children) {
+  BF_Block *block;
+  BF_Block_Init(&block);
+  *index_blocks = 0;
+  *children = 0;
+  for (int i = 1; i < info->block_count; i++) {
+    CALL_OR_DIE(BF_GetBlock(file_desc, i, block));
+    const char *data = BF_Block_GetData(block);
+    int type;
+    memcpy(&type, data, sizeof(int));
+    if (bplus_file_is_keyed(info) && type == BLOCK_TYPE_KEYED_INDEX) {
+      KeyedIndexHeader header;
+      memcpy(&header, data + sizeof(int), sizeof(KeyedIndexHeader));
+      (*index_blocks)++;
+      *children += header.entry_count + 1;
+    } else if (!bplus_file_is_keyed(info) && is_index_block(data)) {
+      IndexNodeHeader header;
+      index_block_copy_header(data, &header);
+      (*index_blocks)++;
+      *children += header.index_count;
+    }
+    CALL_OR_DIE(BF_UnpinBlock(block));
+  }
+  BF_Block_Destroy(&block);
+}
+
+/**
+ * Lookups of events (records with an int key and a unique 64-bit id) by their key (mode 0), by their 64-bit id
+ * through a secondary index on it (mode 1), or by their 64-bit id as the key of a LONG key file (mode 2); modes 0
+ * and 2 also time the inserts and report the fan-out of the index blocks.
+ */
+void bench_long_ids(int mode, int lookup_num) {
+  AttributeSchema attrs[] = {{"id", TYPE_INT, 0}, {"event_id", TYPE_LONG, 0}, {"payload", TYPE_CHAR, 19}};
+  TableSchema schema;
+  schema_init(&schema, attrs, 3, mode == 2 ? "event_id" : "id");
+  const char *file_name = (mode == 2) ? EVENT_LONG_FILE : EVENT_FILE;
+
+  int file_desc;
+  BPlusMeta *info;
+  if (mode != 1) {
+    remove(file_name);
+    bplus_create_file(&schema, file_name); // a LONG key file for mode 2
+  }
+  if (bplus_open_file(file_name, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", file_name);
+    return;
+  }
+
+  // the ids are above 2^32, and spread over the 64-bit range by a multiplicative hash of the key
+  Record record;
+  double start = now_seconds();
+  for (int i = 0; i < EVENT_RECORDS && mode != 1; i++) {
+    record_create(&schema, &record, i, (1LL << 40) + (long long)i * 2654435761LL, "event");
+    bplus_record_insert(file_desc, info, &record);
+  }
+  double insert_seconds = now_seconds() - start;
+  if (mode == 1 && bplus_create_secondary_index(file_desc, info, "event_id") != 0)
+    printf("bplus_create_secondary_index failed\n");
+
+  srand(23);
+  int found = 0;
+  start = now_seconds();
+  for (int i = 0; i < lookup_num; i++) {
+    int key = rand() % EVENT_RECORDS;
+    if (mode == 0) {
+      found += (bplus_record_get(file_desc, info, key, &record) == 1);
+    } else {
+      Record probe;
+      record_create(&schema, &probe, 0, (1LL << 40) + (long long)key * 2654435761LL, "");
+      if (mode == 1)
+        found += (bplus_secondary_find_records(file_desc, info, "event_id", &probe, &record, 1) == 1);
+      else
+        found += (bplus_keyed_get(file_desc, info, &probe, &record) == 1);
+    }
+  }
+  double seconds = now_seconds() - start;
+
+  const char *names[] = {"bplus_record_get (int key)", "bplus_secondary_find (LONG id)", "bplus_keyed_get (LONG key)"};
+  printf("%-32s %12.0f lookups/s  (%d/%d found, %d blocks in the tree", names[mode], lookup_num / seconds, found,
+         lookup_num, info->block_count);
+  if (mode != 1) {
+    int index_blocks, children;
+    count_index_blocks(file_desc, info, &index_blocks, &children);
+    printf(", %d index blocks of %.1f children, inserts at %.0f/s", index_blocks,
+           index_blocks ? (double)children / index_blocks : 0.0, EVENT_RECORDS / insert_seconds);
+  }
+  printf(")\n");
+  bplus_close_file(file_desc, info);
+}
+
+/**
+ * Copies the records of the ingest tree into ORDER_FILE, made with bplus_create_counted_file().
+ */
+void copy_to_counted_file() {
+  int ingest_desc, file_desc;
+  BPlusMeta *ingest_info, *info;
+  remove(ORDER_FILE);
+  bplus_open_file(INGEST_FILE, &ingest_desc, &ingest_info);
+  bplus_create_counted_file(&(ingest_info->schema), ORDER_FILE);
+  bplus_open_file(ORDER_FILE, &file_desc, &info);
+
+  BPlusScan scan;
+  Record record;
+  bplus_scan_open(&scan, ingest_desc, ingest_info, INT_MIN, BPLUS_ACCESS_SCAN);
+  while (bplus_scan_next(&scan, &record) == 1)
+    bplus_record_insert(file_desc, info, &record);
+  bplus_scan_close(&scan);
+
+  bplus_close_file(file_desc, info);
+  bplus_close_file(ingest_desc, ingest_info);
+}
+
+/**
+ * COUNT(*) of random key ranges and pages of ORDER_PAGE_SIZE records at random offsets (as in LIMIT/OFFSET): by a scan
+ * over the leaf chain of the ingest tree (mode 0), or with the subtree counts of the index blocks of its counted copy
+ * (mode 1).
+ */
+void bench_order(int mode, int query_num) {
+  const char *file_name = INGEST_FILE;
+  if (mode == 1) {
+    copy_to_counted_file();
+    file_name = ORDER_FILE;
+  }
+
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(file_name, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", file_name);
+    return;
+  }
+
+  srand(29);
+  long counted = 0, paged = 0;
+  Record record;
+  double start = now_seconds();
+  for (int i = 0; i < query_num; i++) {
+    int low_key = rand() % 200000; // the ingest keys are random ints of [0, 200000)
+    int high_key = low_key + rand() % 50000;
+    int offset = rand() % (info->record_count - ORDER_PAGE_SIZE);
+    if (mode == 0) {
+      BPlusScan scan;
+      bplus_scan_open(&scan, file_desc, info, low_key, BPLUS_ACCESS_SCAN);
+      while (bplus_scan_next(&scan, &record) == 1 && record_get_key(&(info->schema), &record) <= high_key)
+        counted++;
+      bplus_scan_close(&scan);
+
+      bplus_scan_open(&scan, file_desc, info, INT_MIN, BPLUS_ACCESS_SCAN);
+      for (int position = 0; position < offset + ORDER_PAGE_SIZE && bplus_scan_next(&scan, &record) == 1; position++)
+        paged += (position >= offset);
+      bplus_scan_close(&scan);
+    } else {
+      counted += bplus_count_range(file_desc, info, low_key, high_key);
+      for (int position = offset; position < offset + ORDER_PAGE_SIZE; position++)
+        paged += (bplus_select(file_desc, info, position, &record) == 1);
+    }
+  }
+  double seconds = now_seconds() - start;
+  bplus_close_file(file_desc, info);
+
+  printf("%-32s %12.1f queries/s  (%ld records counted, %ld records paged)\n",
+         mode == 0 ? "count and offset (scan)" : "bplus_count_range/bplus_select", query_num / seconds, counted,
+         paged);
+}
+
+/**
+ * COUNT, MIN, MAX and SUM of the amount of sales with ids in random ranges, on a file without aggregates (so by a
+ * scan of each range, mode 0) or on one that keeps them for the amount (mode 1).
+ */
+void bench_aggregate(int mode, int query_num) {
+  AttributeSchema attrs[] = {{"id", TYPE_INT, 0}, {"amount", TYPE_INT, 0}, {"item", TYPE_CHAR, 19}};
+  TableSchema schema;
+  schema_init(&schema, attrs, 3, "id");
+
+  remove(SALES_FILE);
+  if (mode == 0)
+    bplus_create_file(&schema, SALES_FILE);
+  else
+    bplus_create_aggregated_file(&schema, SALES_FILE, "amount");
+
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(SALES_FILE, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", SALES_FILE);
+    return;
+  }
+
+  Record record;
+  srand(31);
+  double insert_start = now_seconds();
+  for (int i = 0; i < SALES_RECORDS; i++) {
+    record_create(&schema, &record, rand() % (4 * SALES_RECORDS), rand() % 1000, "item");
+    bplus_record_insert(file_desc, info, &record);
+  }
+  double insert_seconds = now_seconds() - insert_start;
+
+  long counted = 0;
+  long long sum = 0;
+  BPlusAggregate aggregate;
+  double start = now_seconds();
+  for (int i = 0; i < query_num; i++) {
+    int low_key = rand() % (4 * SALES_RECORDS);
+    int high_key = low_key + rand() % SALES_RECORDS;
+    if (bplus_aggregate_range(file_desc, info, "amount", low_key, high_key, &aggregate) == 0) {
+      counted += aggregate.count;
+      sum += aggregate.sum.long_value;
+    }
+  }
+  double seconds = now_seconds() - start;
+
+  printf("%-32s %12.1f queries/s  (%ld records, amount sum %lld, %d blocks, inserts at %.0f/s)\n",
+         mode == 0 ? "aggregate (scan)" : "bplus_aggregate_range", query_num / seconds, counted, sum,
+         info->block_count, SALES_RECORDS / insert_seconds);
+  bplus_close_file(file_desc, info);
+}
+
+/**
+ * city = 'Athina' queries on the ingest tree, returning the id and name of the matching employees: by a scan that
+ * reads the attributes of every record with record_get_value (mode 0), or by a filtered scan (mode 1). The file is
+ * memory-mapped, so that the blocks are not read through the BF frames and the evaluation of the records is measured.
+ */
+void bench_filter(int mode, int query_num) {
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file_mmap(INGEST_FILE, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", INGEST_FILE);
+    return;
+  }
+
+  BPlusPredicate predicate;
+  bplus_predicate_compile(&predicate, &(info->schema), "city", BPLUS_COMPARE_EQ, "Athina");
+  const char *columns[] = {"id", "name"};
+  BPlusColumnBatch *batch = malloc(sizeof(BPlusColumnBatch));
+
+  long found = 0, id_sum = 0;
+  double start = now_seconds();
+  for (int i = 0; i < query_num; i++) {
+    if (mode == 0) {
+      BPlusScan scan;
+      Record record;
+      char city[MAX_STRING_LENGTH], name[MAX_STRING_LENGTH];
+      int id;
+      bplus_scan_open(&scan, file_desc, info, INT_MIN, BPLUS_ACCESS_SCAN);
+      while (bplus_scan_next(&scan, &record) == 1) {
+        record_get_value(&(info->schema), &record, "city", city);
+        if (strcmp(city, "Athina") != 0)
+          continue;
+        record_get_value(&(info->schema), &record, "id", (char *)&id);
+        record_get_value(&(info->schema), &record, "name", name);
+        found++;
+        id_sum += id;
+      }
+      bplus_scan_close(&scan);
+    } else {
+      BPlusFilterScan scan;
+      int rows;
+      bplus_filter_open(&scan, file_desc, info, &predicate, 1, columns, 2, BPLUS_ACCESS_SCAN);
+      while ((rows = bplus_filter_next(&scan, batch)) > 0) {
+        found += rows;
+        for (int r = 0; r < rows; r++)
+          id_sum += batch->columns[0][r].int_value;
+      }
+      bplus_filter_close(&scan);
+    }
+  }
+  double seconds = now_seconds() - start;
+  int record_count = info->record_count;
+  bplus_close_file(file_desc, info);
+  free(batch);
+
+  printf("%-32s %12.1f queries/s  (%ld records found, id sum %ld, %.1f M records/s scanned)\n",
+         mode == 0 ? "city = ? (record_get_value)" : "bplus_filter_next", query_num / seconds, found, id_sum,
+         (double)record_count * query_num / seconds / 1e6);
+}
+
+typedef struct {
+  long count;
+  long long id_sum;
+  char padding[48]; // one cache line per partition, so that the workers do not share lines
+} PartitionTotals;
+
+/**
+ * Callback of bplus_parallel_scan: adds the record to the totals of its partition (user_data is their array).
+ */
+void count_partition_record(void *user_data, int partition, const Record *record) {
+  PartitionTotals *totals = &(((PartitionTotals *)user_data)[partition]);
+  totals->count++;
+  totals->id_sum += record->values[0].int_value;
+}
+
+/**
+ * Full scans of the memory-mapped ingest tree with bplus_parallel_scan, with thread_count worker threads, counting the
+ * records of each partition; cold scans start with the file dropped from the page cache.
+ */
+void bench_parallel(int thread_count, int mode, int cold, int scan_num) {
+  PartitionTotals totals[BPLUS_PARALLEL_MAX_THREADS];
+  memset(totals, 0, sizeof(totals));
+  double seconds = 0;
+  long scanned = 0;
+  for (int i = 0; i < scan_num; i++) {
+    if (cold)
+      drop_page_cache(INGEST_FILE);
+
+    int file_desc;
+    BPlusMeta *info;
+    if (bplus_open_file_mmap(INGEST_FILE, &file_desc, &info) != 0) {
+      printf("bplus_open_file_mmap failed\n");
+      return;
+    }
+    double start = now_seconds();
+    scanned += bplus_parallel_scan(file_desc, info, thread_count, mode, count_partition_record, totals);
+    seconds += now_seconds() - start;
+    bplus_close_file(file_desc, info);
+  }
+
+  long long id_sum = 0;
+  for (int p = 0; p < thread_count; p++)
+    id_sum += totals[p].id_sum;
+  char name[64];
+  snprintf(name, sizeof(name), "parallel scan %s T=%d (%s)", mode == BPLUS_PARALLEL_ORDERED ? "ordered" : "unordered",
+           thread_count, cold ? "cold" : "warm");
+  printf("%-32s %12.1f M records/s  (%ld records, id sum %lld)\n", name, scanned / seconds / 1e6, scanned, id_sum);
+}
+
+/**
+ * The ingest records (the same keys and values) in a file with record data blocks (layout 0), PAX data blocks
+ * (layout 1) or PAX data blocks with dictionary codes (layout 2): scans of all the city values with a filtered scan
+ * that projects only that attribute, filtered scans of the ids with city = "Athina", then random lookups of whole
+ * records.
+ */
+void bench_layout(const TableSchema *schema, int layout, int record_num) {
+  remove(LAYOUT_FILE);
+  if (layout == 2)
+    bplus_create_dictionary_file(schema, LAYOUT_FILE);
+  else if (layout == 1)
+    bplus_create_pax_file(schema, LAYOUT_FILE);
+  else
+    bplus_create_file(schema, LAYOUT_FILE);
+
+  int file_desc;
+  BPlusMeta *info;
+  if (bplus_open_file(LAYOUT_FILE, &file_desc, &info) != 0) {
+    printf("opening %s failed\n", LAYOUT_FILE);
+    return;
+  }
+  Record record;
+  srand(1234); // the same records as bench_ingest
+  for (int i = 0; i < record_num; i++) {
+    employee_random_record(schema, &record);
+    bplus_record_insert(file_desc, info, &record);
+  }
+
+  const char *columns[] = {"city"};
+  BPlusColumnBatch *batch = malloc(sizeof(BPlusColumnBatch));
+  long values = 0, athina = 0;
+  double start = now_seconds();
+  for (int i = 0; i < LAYOUT_SCANS; i++) {
+    BPlusFilterScan scan;
+    int rows;
+    bplus_filter_open(&scan, file_desc, info, NULL, 0, columns, 1, BPLUS_ACCESS_SCAN);
+    while ((rows = bplus_filter_next(&scan, batch)) > 0) {
+      values += rows;
+      for (int r = 0; r < rows; r++)
+        athina += (strcmp(batch->columns[0][r].string_value, "Athina") == 0);
+    }
+    bplus_filter_close(&scan);
+  }
+  double scan_seconds = now_seconds() - start;
+
+  BPlusPredicate predicate;
+  bplus_predicate_compile(&predicate, schema, "city", BPLUS_COMPARE_EQ, "Athina");
+  const char *id_column[] = {"id"};
+  long matches = 0;
+  start = now_seconds();
+  for (int i = 0; i < LAYOUT_SCANS; i++) {
+    BPlusFilterScan scan;
+    int rows;
+    bplus_filter_open(&scan, file_desc, info, &predicate, 1, id_column, 1, BPLUS_ACCESS_SCAN);
+    while ((rows = bplus_filter_next(&scan, batch)) > 0)
+      matches += rows;
+    bplus_filter_close(&scan);
+  }
+  double filter_seconds = now_seconds() - start;
+  free(batch);
+
+  int found = 0;
+  start = now_seconds();
+  for (int i = 0; i < LAYOUT_LOOKUPS; i++)
+    found += (bplus_record_get(file_desc, info, rand() % 200000, &record) == 1);
+  double lookup_seconds = now_seconds() - start;
+
+  const char *names[] = {"city scan (record blocks)", "city scan (PAX blocks)", "city scan (dictionary codes)"};
+  printf("%-32s %12.1f M values/s  (%ld Athina, %d records in %d blocks, %d records per block; lookups at %.0f/s, "
+         "%d/%d found)\n", names[layout], values / scan_seconds / 1e6, athina, info->record_count, info->block_count,
+         info->max_records_per_block, LAYOUT_LOOKUPS / lookup_seconds, found, LAYOUT_LOOKUPS);
+  printf("%-32s %12.1f M records/s  (%ld matches)\n", "  city = \"Athina\" filter",
+         (double)info->record_count * LAYOUT_SCANS / filter_seconds / 1e6, matches);
+  bplus_close_file(file_desc, info);
+}
+
+/**
+ * Lookups of lookup_num keys with bplus_record_get (into a caller buffer), or with bplus_record_contains.
+ */
+void bench_get(int file_desc, BPlusMeta *info, const int *lookup_keys, int lookup_num, int contains_only) {
+  int found = 0;
+  Record result;
+  double start = now_seconds();
+  for (int i = 0; i < lookup_num; i++) {
+    if (contains_only)
+      found += (bplus_record_contains(file_desc, info, lookup_keys[i]) == 1);
+    else
+      found += (bplus_record_get(file_desc, info, lookup_keys[i], &result) == 1);
+  }
+  report(contains_only ? "bplus_record_contains" : "bplus_record_get", lookup_num, found, now_seconds() - start);
+}
+
+/**
+ * Lookups of lookup_num keys with bplus_record_find_batch, interleaving group_size lookups.
+ */
+void bench_batch(int file_desc, BPlusMeta *info, const int *lookup_keys, int lookup_num, int group_size) {
+  Record *results = malloc(lookup_num * sizeof(Record));
+  int *found_flags = malloc(lookup_num * sizeof(int));
+
+  double start = now_seconds();
+  int found = bplus_record_find_batch(file_desc, info, lookup_keys, lookup_num, group_size, results, found_flags);
+  double seconds = now_seconds() - start;
+
+  char name[64];
+  snprintf(name, sizeof(name), "bplus_record_find_batch G=%d", group_size);
+  report(name, lookup_num, found, seconds);
+
+  free(results);
+  free(found_flags);
+}
+
+int main(int argc, char *argv[]) {
+  int rec_num = (argc > 1) ? atoi(argv[1]) : DEFAULT_RECORDS;
+  int lookup_num = (argc > 2) ? atoi(argv[2]) : DEFAULT_LOOKUPS;
+  int ingest_num = (argc > 3) ? atoi(argv[3]) : DEFAULT_INGEST_RECORDS;
+  if (rec_num <= 0 || lookup_num <= 0 || ingest_num <= 0) {
+    fprintf(stderr, "Usage: %s [records] [lookups] [ingest records]\n", argv[0]);
+    return 1;
+  }
+
+  CALL_OR_DIE(BF_Init(LRU));
+  const TableSchema schema = employee_get_schema();
+  int *keys = build_tree(&schema, rec_num);
+
+  // the searched keys are drawn uniformly from the inserted ones
+  int *lookup_keys = malloc(lookup_num * sizeof(int));
+  srand(7);
+  for (int i = 0; i < lookup_num; i++)
+    lookup_keys[i] = keys[rand() % rec_num];
+
+  int file_desc;
+  BPlusMeta *info;
+  bplus_open_file(BENCH_FILE, &file_desc, &info);
+  printf("%d records, %d blocks, %d lookups\n", info->record_count, info->block_count, lookup_num);
+
+  bench_single(file_desc, info, lookup_keys, lookup_num);
+  bench_get(file_desc, info, lookup_keys, lookup_num, 0);
+  bench_get(file_desc, info, lookup_keys, lookup_num, 1);
+  int group_sizes[] = {1, 4, 8, 16};
+  for (int i = 0; i < 4; i++)
+    bench_batch(file_desc, info, lookup_keys, lookup_num, group_sizes[i]);
+
+  int bench_blocks = info->block_count;
+  bplus_close_file(file_desc, info);
+
+  bench_ingest(&schema, ingest_num);
+  bench_io_mode(BPLUS_IO_BUFFERED, IO_MODE_LOOKUPS);
+  bench_io_mode(BPLUS_IO_UNCACHED, IO_MODE_LOOKUPS);
+  bench_mmap(IO_MODE_LOOKUPS);
+  bench_arena(-1, ARENA_LOOKUPS);
+  bench_arena(BPLUS_ARENA_SMALL_PAGES, ARENA_LOOKUPS);
+  bench_arena(BPLUS_ARENA_HUGE_PAGES, ARENA_LOOKUPS);
+  bench_warm_restart(WARM_LOOKUPS);
+  bench_quota(0, lookup_keys, lookup_num);
+  bench_quota(bench_blocks, lookup_keys, lookup_num);
+  bench_scan(BPLUS_ACCESS_NORMAL, lookup_keys, lookup_num);
+  bench_scan(BPLUS_ACCESS_SCAN, lookup_keys, lookup_num);
+  bench_bloom(0, BLOOM_LOOKUPS);
+  bench_bloom(0.01, BLOOM_LOOKUPS);
+  bench_bloom(0.01, BLOOM_LOOKUPS); // the filter is read back from the sidecar file
+  remove(INGEST_FILE BPLUS_BLOOM_SUFFIX);
+  bench_zipf(0, ZIPF_LOOKUPS);
+  bench_zipf(128 * 1024, ZIPF_LOOKUPS);
+  bench_zipf(1024 * 1024, ZIPF_LOOKUPS);
+  bench_finger(0, SORTED_LOOKUPS);
+  bench_finger(1, SORTED_LOOKUPS);
+  bench_filter(0, FILTER_QUERIES);
+  bench_filter(1, FILTER_QUERIES);
+  int thread_counts[] = {1, 2, 4, 8};
+  for (int i = 0; i < 4; i++)
+    bench_parallel(thread_counts[i], BPLUS_PARALLEL_UNORDERED, 0, PARALLEL_SCANS);
+  bench_parallel(4, BPLUS_PARALLEL_ORDERED, 0, PARALLEL_SCANS);
+  bench_parallel(1, BPLUS_PARALLEL_UNORDERED, 1, PARALLEL_SCANS);
+  bench_parallel(4, BPLUS_PARALLEL_UNORDERED, 1, PARALLEL_SCANS);
+  bench_layout(&schema, 0, ingest_num);
+  bench_layout(&schema, 1, ingest_num);
+  bench_layout(&schema, 2, ingest_num);
+  remove(LAYOUT_FILE);
+  bench_secondary(0, SECONDARY_QUERIES);
+  bench_secondary(1, SECONDARY_QUERIES); // the index is built by a scan
+  bench_secondary(2, SECONDARY_QUERIES); // the index file is reused
+  remove(INGEST_FILE ".surname" BPLUS_SECONDARY_SUFFIX);
+  bench_order(0, ORDER_QUERIES);
+  bench_order(1, ORDER_QUERIES);
+  remove(ORDER_FILE);
+  bench_aggregate(0, SALES_QUERIES);
+  bench_aggregate(1, SALES_QUERIES);
+  remove(SALES_FILE);
+  bench_long_ids(0, EVENT_LOOKUPS);
+  bench_long_ids(1, EVENT_LOOKUPS);
+  bench_long_ids(2, EVENT_LOOKUPS);
+  remove(EVENT_FILE);
+  remove(EVENT_LONG_FILE);
+  remove(EVENT_FILE ".event_id" BPLUS_SECONDARY_SUFFIX);
+  remove(INGEST_FILE BPLUS_WARM_SUFFIX);
+  CALL_OR_DIE(BF_Close());
+
+  free(keys);
+  free(lookup_keys);
+  return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef BP_AGGREGATE_H
+#define BP_AGGREGATE_H
+
+#include "bplus_file_structs.h"
+#include "record.h"
+
+/* Range aggregates: COUNT, MIN, MAX and SUM of a numeric attribute (INT, LONG or FLOAT) over the records whose keys
+** are in a range, without reading every record of the range.
+** - A file made with bplus_create_aggregated_file() keeps, for one designated attribute, the aggregate of the records
+**   under each child of every index block, next to its count (see bplus_index_node.h); the aggregate of a data block
+**   is the one its parent keeps for it
+** - A range query descends from the root, takes the kept aggregate of every child whose keys are all in the range,
+**   and only descends into the children that the range bounds cut, so it reads the data blocks at the two ends of the
+**   range and O(height) index blocks
+** - Inserts merge the new record into the aggregates on the path above it, and splits give both halves the aggregates
+**   of their records or entries; an update of a record in place (bplus_record_update()) recomputes the aggregates on
+**   its path from the records and children below them, as a value that was a minimum or maximum can change
+** - Records are never deleted from a tree, so no aggregate needs to be recomputed on a delete
+** - The aggregates take 28 bytes per child, so the index blocks of such a file have a smaller fan-out; files without
+**   an aggregated attribute (and queries on other attributes) get the same results by a scan of the range
+*/
+
+typedef union {
+    long long long_value; // of an INT or LONG attribute
+    double float_value; // of a FLOAT attribute
+} BPlusAggregateValue;
+
+typedef struct {
+    int count; // records
+    BPlusAggregateValue min; // the next ones are undefined if count is 0
+    BPlusAggregateValue max;
+    BPlusAggregateValue sum;
+} BPlusAggregate;
+
+/**
+ * @brief Computes COUNT, MIN, MAX and SUM of an attribute over the records whose keys are in a range.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_name Name of an INT, LONG or FLOAT attribute (the kept aggregates are used if it is the aggregated
+ *        attribute of the file).
+ * @param low_key Smallest key of the range.
+ * @param high_key Largest key of the range (included; INT_MAX for no upper bound).
+ * @param aggregate Pointer to store the aggregate (as long_value for INT and LONG, float_value for FLOAT).
+ * @return 0 on success, -1 on failure (e.g. not a numeric attribute).
+ */
+int bplus_aggregate_range(int file_desc, const BPlusMeta *metadata, const char *attr_name, int low_key, int high_key,
+                          BPlusAggregate *aggregate);
+
+// returns the position of the aggregated attribute of the file of metadata in its schema, or -1 if it has none
+int bplus_aggregate_attribute(const BPlusMeta *metadata);
+
+// sets aggregate to that of no records
+void bplus_aggregate_init(BPlusAggregate *aggregate);
+
+// adds record to aggregate (only its count if attribute is -1)
+void bplus_aggregate_add_record(BPlusAggregate *aggregate, const TableSchema *schema, int attribute,
+                                const Record *record);
+
+// adds the records of from to aggregate; type is that of the aggregated attribute
+void bplus_aggregate_merge(BPlusAggregate *aggregate, const BPlusAggregate *from, DataType type);
+
+// sets aggregate to that of the records of the data block at block_start with keys in [low_key, high_key]
+void bplus_aggregate_data_block(const char *block_start, const BPlusMeta *metadata, int attribute,
+                                long long low_key, long long high_key, BPlusAggregate *aggregate);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef BP_ARENA_H
+#define BP_ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator for buffers that all live exactly as long as one operation.
+** The memory is allocated once (bplus_arena_init()); each allocation takes the next aligned piece of it, and
+** bplus_arena_reset() gives all of it back at once, so an operation that takes its buffers from an arena makes
+** no malloc() or free() calls. An allocation that does not fit fails, as a failed malloc() would.
+*/
+
+#define BPLUS_ARENA_ALIGNMENT 16 // alignment of every allocation (enough for any type the bplus layer stores)
+
+typedef struct {
+    char *base;
+    size_t capacity;
+    size_t used;
+} BPlusArena;
+
+// allocates capacity bytes for arena
+// returns 0 on success, -1 if unsuccessful
+int bplus_arena_init(BPlusArena *arena, size_t capacity);
+
+// returns size bytes from arena, aligned to BPLUS_ARENA_ALIGNMENT
+// returns NULL if they do not fit in the rest of the arena
+void *bplus_arena_alloc(BPlusArena *arena, size_t size);
+
+// frees all allocations of arena at once
+void bplus_arena_reset(BPlusArena *arena);
+
+// returns the space that an allocation of size bytes takes in an arena, including alignment
+size_t bplus_arena_space(size_t size);
+
+// frees the memory of arena (nothing happens if it was never initialized)
+void bplus_arena_free(BPlusArena *arena);
+
+#endif
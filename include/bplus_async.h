@@ -0,0 +1,61 @@
+#ifndef BP_ASYNC_H
+#define BP_ASYNC_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Asynchronous lookups: a lookup is submitted with bplus_record_find_async() and completes later, inside
+** bplus_poll(), by calling its callback. This way one thread can keep many lookups in flight.
+** - bplus_poll() serves the pending lookups as one batch, in ascending key order, so lookups that fall in the
+**   same data block share a single descent and a single pin of that block
+** - The block is unpinned as soon as the last completion that needs it has been delivered
+** - The BF layer only offers synchronous block reads, so the batching happens above it; the page reads
+**   themselves are still issued one at a time by BF_GetBlock()
+*/
+
+#define BPLUS_ASYNC_INITIAL_CAPACITY 64 // initial size of a file's queue of pending lookups; it doubles when full
+
+/**
+ * @brief Completion callback of an asynchronous lookup.
+ * @param user_data The pointer given to bplus_record_find_async().
+ * @param key The key that was searched.
+ * @param record The found record (or NULL if not found); it is only valid during the call, so copy it if needed.
+ */
+typedef void (*BPlusFindCallback)(void *user_data, int key, const Record *record);
+
+struct bplus_async_request {
+    int key;
+    long sequence; // submission order, keeps the sort stable for equal keys
+    const BPlusMeta *metadata;
+    BPlusFindCallback callback;
+    void *user_data;
+};
+
+/**
+ * @brief Submits a lookup of a record by key, which completes in a later bplus_poll() call.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree; must stay valid until the lookup completes.
+ * @param key Key value to search for.
+ * @param callback Function called when the lookup completes.
+ * @param user_data Pointer passed as is to callback.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_record_find_async(int file_desc, const BPlusMeta *metadata, int key,
+                            BPlusFindCallback callback, void *user_data);
+
+/**
+ * @brief Completes pending lookups of a file, calling their callbacks.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param max_completions Maximum number of lookups to complete (the oldest ones); 0 or less completes all.
+ * @return Number of completed lookups on success, -1 on failure (the failed lookups complete as not found).
+ */
+int bplus_poll(int file_desc, int max_completions);
+
+/**
+ * @brief Returns the number of submitted lookups that have not completed yet.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @return Number of pending lookups, -1 if the file is not open.
+ */
+int bplus_pending_count(int file_desc);
+
+#endif
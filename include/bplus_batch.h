@@ -0,0 +1,32 @@
+#ifndef BP_BATCH_H
+#define BP_BATCH_H
+
+#include "bplus_file_structs.h"
+
+/* Batched lookups: the lookups of a batch run as a group of interleaved state machines, each one at some
+** level of its own descent. In every step, the next block of each lookup of the group is pinned and prefetched,
+** and only then each lookup searches its block and moves one level down. So the memory loads of different
+** lookups overlap, instead of each lookup waiting on its own chain of dependent loads (block -> header -> entry -> child).
+** - A lookup leaves the group when it reaches its data block, and the next key of the batch takes its place
+** - Each lookup pins at most one block at a time, so a group pins at most group_size blocks
+*/
+
+#define BPLUS_BATCH_DEFAULT_GROUP_SIZE 8 // used when group_size <= 0
+#define BPLUS_BATCH_MAX_GROUP_SIZE 32 // keeps the pinned blocks of a group well below BF_BUFFER_SIZE
+#define BPLUS_CACHE_LINE_SIZE 64 // prefetch granularity
+
+/**
+ * @brief Finds many records in the B+ tree by key, interleaving their descents.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param keys Key values to search for.
+ * @param key_count Number of keys.
+ * @param group_size Number of lookups interleaved together (at most BPLUS_BATCH_MAX_GROUP_SIZE, default if <= 0).
+ * @param out_records Array of key_count records; out_records[i] gets the record with keys[i], if found.
+ * @param found Array of key_count ints; found[i] is set to 1 if keys[i] was found, 0 otherwise.
+ * @return Number of found records on success, -1 on failure.
+ */
+int bplus_record_find_batch(int file_desc, const BPlusMeta *metadata, const int *keys, int key_count,
+                            int group_size, Record *out_records, int *found);
+
+#endif
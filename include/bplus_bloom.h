@@ -0,0 +1,76 @@
+#ifndef BP_BLOOM_H
+#define BP_BLOOM_H
+
+#include <stdint.h>
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Bloom filter over the keys of a B+ tree file, so that a lookup of a key that is not in the tree returns without
+** descending the tree.
+** - It is a blocked Bloom filter: all bits of a key are in one line of BPLUS_BLOOM_LINE_BITS bits (a cache line),
+**   chosen by the key's hash, so a probe costs one memory access; the bits per key and the number of hashes follow
+**   from the false positive rate given to bplus_bloom_enable()
+** - It is kept in memory while the file is open, and inserts add their keys to it; it is sized for twice the keys of
+**   the tree, and rebuilt with twice the capacity when the tree outgrows it
+** - On close it is written to a sidecar file, <file name>.bloom; bplus_bloom_enable() reads it back if it matches the
+**   tree (same record and block counts, same rate), else the filter is built by a scan over the leaf chain
+** - BF allocates the blocks of the tree file itself and the metadata has no room to list extra blocks, so the
+**   filter is kept in the sidecar rather than in blocks of the tree file, which leaves the file format unchanged
+** - Records are never deleted from a tree, so keys never need to be removed from the filter (which a plain Bloom
+**   filter could not do)
+*/
+
+#define BPLUS_BLOOM_SUFFIX ".bloom" // appended to the file name to get the sidecar file name
+#define BPLUS_BLOOM_LINE_BITS 512 // bits of a line; all bits of a key are in one line
+#define BPLUS_BLOOM_MIN_KEYS 1024 // smallest capacity of a filter
+#define BPLUS_BLOOM_MAX_HASHES 16
+
+typedef struct {
+    long lookups; // lookups that probed the filter
+    long negatives; // lookups that the filter answered (the key is not in the tree) without descending the tree
+    long false_positives; // lookups that passed the filter, but did not find the key
+} BPlusBloomStats;
+
+struct bplus_bloom {
+    uint64_t *bits; // line_count lines of BPLUS_BLOOM_LINE_BITS bits
+    int line_count;
+    int capacity; // keys the filter is sized for
+    int bits_per_key;
+    int hash_count;
+    int record_count; // record count of the tree when the filter was last changed
+    int block_count; // block count of the tree when the filter was last changed
+    int is_dirty; // 1 if the filter changed since it was read from the sidecar
+    BPlusBloomStats stats;
+};
+
+/**
+ * @brief Builds (or reads back) the Bloom filter of an open B+ tree file; its lookups use it from then on.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param false_positive_rate Fraction of the lookups of missing keys that may still descend the tree, in (0, 1).
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_bloom_enable(int file_desc, const BPlusMeta *metadata, double false_positive_rate);
+
+/**
+ * @brief Gets the counters of the Bloom filter of an open B+ tree file.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param stats Pointer to store the counters.
+ * @return 0 on success, -1 if the file is not open or has no filter.
+ */
+int bplus_bloom_stats(int file_desc, BPlusBloomStats *stats);
+
+// returns 0 if key is certainly not in the tree of handle, 1 if it may be (always 1 if the file has no filter)
+int bplus_bloom_may_contain(BPlusHandle *handle, int key);
+
+// counts a lookup of handle that passed its filter but did not find the key
+void bplus_bloom_count_false_positive(BPlusHandle *handle);
+
+// adds key, which was just inserted into the tree of file_desc, to the file's filter (if any)
+void bplus_bloom_add(int file_desc, const BPlusMeta *metadata, int key);
+
+// writes the filter of handle to its sidecar file (if it changed) and frees it
+void bplus_bloom_close(BPlusHandle *handle);
+
+#endif
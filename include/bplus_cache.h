@@ -0,0 +1,70 @@
+#ifndef BP_CACHE_H
+#define BP_CACHE_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Record cache in front of the point lookups of a B+ tree file, for lookup traffic that keeps asking for the same
+** few keys: a hit copies the record from the cache, without descending the tree or decoding the data block.
+** - It holds copies of found records, keyed by PK, in a fixed number of slots that fit the size in bytes given to
+**   bplus_cache_enable(); a hash table with linear probing maps each cached key to its slot
+** - Slots are replaced in CLOCK order: a hit marks its slot referenced, and the clock hand passes over (and clears)
+**   referenced slots before it takes one, so keys that keep being hit stay while keys seen once are replaced first
+** - Only found records are cached; inserts and updates drop their key from the cache (bplus_cache_invalidate()), so
+**   that a cached copy can never be older than the tree
+** - bplus_record_get(), bplus_record_contains() and bplus_record_find() use it; the batch and async lookups do not
+*/
+
+typedef struct {
+    long hits;
+    long misses;
+    long evictions; // records replaced to make room for others
+} BPlusCacheStats;
+
+struct bplus_cache_slot {
+    int key;
+    int is_cached; // 0 once the key of the slot was dropped by bplus_cache_invalidate()
+    int is_referenced; // set by a hit, cleared when the clock hand passes
+    Record record;
+};
+
+struct bplus_cache {
+    struct bplus_cache_slot *slots;
+    int slot_count;
+    int used_count; // slots in use; the first used_count slots are the used ones
+    int hand; // next slot the clock hand looks at
+    int *table; // slot of each cached key (-1 for an empty entry); table_size is a power of 2
+    int table_size;
+    BPlusCacheStats stats;
+};
+
+/**
+ * @brief Gives an open B+ tree file a record cache of a given size, or removes it; an existing cache is emptied.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param capacity_bytes Memory the cache may use (records and hash table), or 0 to remove the cache.
+ * @return 0 on success, -1 on failure (file not open, capacity too small for one record, or out of memory).
+ */
+int bplus_cache_enable(int file_desc, size_t capacity_bytes);
+
+/**
+ * @brief Gets the counters of the record cache of an open B+ tree file.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param stats Pointer to store the counters.
+ * @return 0 on success, -1 if the file is not open or has no cache.
+ */
+int bplus_cache_stats(int file_desc, BPlusCacheStats *stats);
+
+// copies the cached record with key to record (unless it is NULL)
+// returns 1 on a hit, 0 on a miss (always 0 if the file has no cache)
+int bplus_cache_get(BPlusHandle *handle, int key, Record *record);
+
+// adds a copy of record, which was found in the tree with key, to the cache of handle (if any)
+void bplus_cache_put(BPlusHandle *handle, int key, const Record *record);
+
+// drops key from the cache of handle (if it is cached)
+void bplus_cache_invalidate(BPlusHandle *handle, int key);
+
+// frees the cache of handle (if any)
+void bplus_cache_close(BPlusHandle *handle);
+
+#endif
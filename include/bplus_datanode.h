@@ -19,6 +19,15 @@
 **                             because of that, this heap part is unsorted; their sorted order is defined using
 **                             the index array, which is always updated as needed
 ** - possibly unused space is either space not yet used by future records or a remainder < sizeof(Record)
+** In a file with PAX data blocks (see bplus_create_pax_file()) the heap part is split into one minipage per attribute
+** instead, each with the values of that attribute for all max_records_per_block heap positions, back to back:
+** (heap part)[key minipage][minipage of attribute 0]...[minipage of the last attribute] (the key is not repeated)
+** - A value takes the bytes of its type, or the length of a CHAR attribute (see data_block_value_width()), so the
+**   blocks hold more records than sizeof(Record) slots allow when the schema has fewer or shorter attributes
+** - The index array is the same, and the heap index of a record is its position in every minipage; records are
+**   gathered from the minipages when they are read, and scattered to them when they are written
+** - In a file with dictionaries (see bplus_create_dictionary_file()) the data blocks are PAX data blocks whose CHAR
+**   minipages hold the dictionary code of each value instead of its characters (see bplus_dictionary.h)
 */
 
 typedef struct {
@@ -42,11 +51,17 @@ void data_block_print(const char *block_start, const BPlusMeta *metadata);
 // caller is responsible for freeing the returned memory
 DataNodeHeader *data_block_read_header(const char *block_start);
 
+// copies the data node header of a block to header (no memory is allocated)
+void data_block_copy_header(const char *block_start, DataNodeHeader *header);
+
 // returns the index array of a block
 // returns NULL if unsuccessful
 // caller is responsible for freeing the returned memory
 int *data_block_read_index_array(const char *block_start, const BPlusMeta *metadata);
 
+// copies the index array of a block to index_array, which must fit max record count per block ints (no memory is allocated)
+void data_block_copy_index_array(const char *block_start, const BPlusMeta *metadata, int *index_array);
+
 // returns the record at index, where index refers to the unsorted heap of records
 // returns NULL if index >= max record count per block or if unsuccessful
 // caller is responsible for freeing the returned memory
@@ -59,6 +74,26 @@ Record *data_block_read_unordered_record(const char *block_start, const BPlusMet
 Record *data_block_read_record(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
                                const BPlusMeta *metadata, int index);
 
+// copies the record at index (i-th smallest, as in data_block_read_record()) to record (no memory is allocated)
+// returns -1 if index >= current record count, else 0 (successful)
+int data_block_copy_record(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
+                           const BPlusMeta *metadata, int index, Record *record);
+
+// returns the bytes that a value of the attribute at position attribute of the schema takes in a PAX minipage: those
+// of its type, the length of a CHAR attribute (with no '\0' after a value of that many characters), or those of a
+// dictionary code for a CHAR attribute of a file with dictionaries (see bplus_dictionary.h)
+int data_block_value_width(const BPlusMeta *metadata, int attribute);
+
+// returns the bytes of a record in the minipages of a PAX data block (the sum of the widths of its values)
+int data_block_pax_record_size(const BPlusMeta *metadata);
+
+// returns where the value of the attribute at position attribute of the schema starts in the block for the record at
+// heap index 0, and sets stride to the bytes between the values of two consecutive heap indexes: sizeof(Record) for
+// records, or the value width (see data_block_value_width()) for the minipage of a PAX data block
+// the value of the record at heap index h starts at the result + h * stride; nothing is copied, so it is valid while
+// the block is
+const char *data_block_column_start(const char *block_start, const BPlusMeta *metadata, int attribute, int *stride);
+
 // fills an allocated buffer record_array with all records of the block, 
 // in the order they appear with in the heap part of the block (only copies the current count of records)
 // record_array buffer is assumed to be large enough to fit the records; if not, this is undefined behavior
@@ -84,6 +119,16 @@ int data_block_write_unordered_record(char *block_start, const BPlusMeta *metada
 int data_block_search_insert_pos(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
                                  const BPlusMeta *metadata, int new_key);
 
+// returns the (0-based) position in index array of the record with the specified key
+// returns -1 if no record of the block has that key
+// reads only the key of each probed record, so it allocates no memory
+int data_block_key_search(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
+                          const BPlusMeta *metadata, int key);
+
+// returns the largest key of the block (the key of its last record in sorted order), reading only that key
+// the block must have at least one record
+int data_block_last_key(const char *block_start, const DataNodeHeader *block_header, const BPlusMeta *metadata);
+
 // prints metadata info and each block in ascending block id order
 int print_all_blocks(int file_desc);
 
@@ -0,0 +1,104 @@
+#ifndef BP_DICTIONARY_H
+#define BP_DICTIONARY_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Dictionaries of the CHAR attributes of a file made with bplus_create_dictionary_file(): each distinct string of an
+** attribute is stored once, in the dictionary blocks of that attribute, and the data blocks store its code instead.
+** - The code of a string is its position in the dictionary of its attribute (0 for the first string added); a code
+**   takes 2 bytes in the PAX minipages of the data blocks (see bplus_datanode.h) instead of the length of the attribute
+** - The dictionary of an attribute is a chain of dictionary blocks that starts at dictionary_blocks in BPlusMeta:
+**   (START)[int][DictionaryNodeHeader][entry][entry]...[entry][possibly unused space](END)
+**   - int is BLOCK_TYPE_DICTIONARY
+**   - an entry is a string of the width of the attribute in the data blocks of a PAX file (see
+**     data_block_value_width()), padded with '\0'; the entries of the blocks of a chain are the codes in order
+** - The dictionaries are read when the file is opened, and kept in memory with a hash table from string to code;
+**   an insert gives the strings it has that are not in them yet pending codes and stores the record with its codes;
+**   only if that succeeds are the pending strings written to the dictionary blocks (appending a dictionary block to
+**   the file when the last one of the attribute is full), else they are dropped, so a failed insert (e.g. of a
+**   duplicate key) leaves the dictionaries as they were
+** - The records that lookups, scans and the other read paths return have their strings again: codes are decoded as
+**   the records are copied out of the data blocks; filtered scans (see bplus_filter.h) compare the codes of a CHAR
+**   predicate with a table of the codes whose strings satisfy it, and decode only the projected values
+** - Strings are never removed, as records are never deleted; an attribute has at most BPLUS_DICTIONARY_MAX_CODES
+**   distinct strings, and an insert with a new string past that fails
+*/
+
+#define BLOCK_TYPE_DICTIONARY 7 // after the data and index block types (see bplus_datanode.h, bplus_index_node.h)
+#define BPLUS_DICTIONARY_MAX_CODES 65536 // codes of an attribute, as they are stored in 2 bytes
+
+typedef struct {
+    int attribute; // position in the schema of the attribute of the dictionary
+    int entry_count; // number of entries in the block
+    int next_index; // next dictionary block of the attribute, -1 for the last one
+} DictionaryNodeHeader;
+
+struct bplus_dictionary_column {
+    int width; // bytes of an entry
+    char *strings; // the entries of all codes, back to back
+    int count; // number of codes
+    int kept_count; // codes that stored records may refer to; the ones after them are pending
+    int saved_count; // codes whose entries are in the dictionary blocks (at most kept_count)
+    int capacity; // entries that strings fits
+    int *table; // code of each string in the hash table (-1 for an empty entry); table_size is a power of 2
+    int table_size;
+    int last_block_index; // last dictionary block of the attribute, -1 if it has none
+    int last_block_entries; // entries of that block
+};
+
+struct bplus_dictionary {
+    struct bplus_dictionary_column columns[MAX_ATTRIBUTES]; // width is 0 for the attributes that are not coded
+};
+
+/**
+ * @brief Gets the number of distinct strings of an attribute in the dictionary of an open B+ tree file.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_name Name of the CHAR attribute.
+ * @return The number of codes, or -1 if the file has no dictionary for that attribute.
+ */
+int bplus_dictionary_size(int file_desc, const BPlusMeta *metadata, const char *attr_name);
+
+// returns 1 if the values of the attribute at position attribute are stored as dictionary codes in the file of
+// metadata (its CHAR attributes, in a file with dictionaries), 0 otherwise
+int bplus_dictionary_is_coded(const BPlusMeta *metadata, int attribute);
+
+// reads the dictionaries of the file of metadata into the runtime state of file_desc (nothing happens if the file has
+// none); the file must be opened, and its blocks readable through bplus_mmap_block() if it is memory-mapped
+// returns 0 on success, -1 otherwise
+int bplus_dictionary_load(int file_desc, const BPlusMeta *metadata);
+
+// copies record to stored, with the code of each of its coded strings instead; strings that are not in the
+// dictionaries yet get pending codes, which bplus_dictionary_save() writes to the file once stored is in the tree, or
+// bplus_dictionary_discard() drops if it could not be stored (also if this fails)
+// returns 0 on success, -1 otherwise (e.g. a new string in a memory-mapped file, or too many codes)
+int bplus_dictionary_encode(int file_desc, const BPlusMeta *metadata, const Record *record, Record *stored);
+
+// keeps the pending codes of the dictionaries of file_desc, and writes the codes that are not in its dictionary blocks
+// yet to them, appending blocks as needed; block 0 and metadata (the caller's copy) get the new block count and
+// dictionary_blocks
+// returns 0 on success, -1 otherwise (the codes that were not written are written by the next call)
+int bplus_dictionary_save(int file_desc, BPlusMeta *metadata);
+
+// drops the pending codes of the dictionaries of file_desc
+void bplus_dictionary_discard(int file_desc);
+
+// replaces the codes of record, which was copied out of a data block of the file of handle, with their strings
+// (nothing happens if the file has no dictionaries); a code that is not in the dictionary gets an empty string
+void bplus_dictionary_decode(const BPlusHandle *handle, const BPlusMeta *metadata, Record *record);
+
+// returns the entry of code in the dictionary of the attribute at position attribute of the file of handle (of the
+// width of the attribute, not always '\0' terminated), or NULL if there is no such code
+const char *bplus_dictionary_string(const BPlusHandle *handle, int attribute, int code);
+
+// returns the number of codes of the attribute at position attribute of the file of handle (0 if it is not coded)
+int bplus_dictionary_code_count(const BPlusHandle *handle, int attribute);
+
+// prints a dictionary block (requires pointer to block data)
+void dictionary_block_print(const char *block_start, const BPlusMeta *metadata);
+
+// frees the dictionaries of handle (if any)
+void bplus_dictionary_close(BPlusHandle *handle);
+
+#endif
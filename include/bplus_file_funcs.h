@@ -7,15 +7,83 @@
 #include "bplus_index_node.h"
 #include "bplus_datanode.h"
 #include "bf.h"
+#include "bplus_handle.h"
+#include "bplus_async.h"
+#include "bplus_batch.h"
+#include "bplus_io.h"
+#include "bplus_mmap.h"
+#include "bplus_warm.h"
+#include "bplus_pool.h"
+#include "bplus_scan.h"
+#include "bplus_bloom.h"
+#include "bplus_cache.h"
+#include "bplus_finger.h"
+#include "bplus_key.h"
+#include "bplus_secondary.h"
+#include "bplus_order.h"
+#include "bplus_aggregate.h"
+#include "bplus_filter.h"
+#include "bplus_parallel.h"
+#include "bplus_dictionary.h"
+#include "bplus_keyed.h"
 
 /**
  * @brief Creates a new empty B+ tree file with the given schema.
+ *        If the key attribute of the schema is a LONG, the file is a LONG key file: a keyed file (see bplus_keyed.h)
+ *        whose index blocks have fixed size entries of 64-bit keys.
  * @param schema Pointer to the TableSchema describing the table.
  * @param fileName Name of the file to create.
  * @return 0 on success, -1 on failure.
  */
 int bplus_create_file(const TableSchema *schema, const char *fileName);
 
+/**
+ * @brief Creates a new empty B+ tree file whose index blocks keep subtree record counts, so that bplus_rank(),
+ *        bplus_count_range() and bplus_select() take one descent instead of a scan (see bplus_order.h).
+ * @param schema Pointer to the TableSchema describing the table.
+ * @param fileName Name of the file to create.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_create_counted_file(const TableSchema *schema, const char *fileName);
+
+/**
+ * @brief Creates a new empty B+ tree file that keeps range aggregates of an attribute (see bplus_aggregate.h).
+ * @param schema Pointer to the TableSchema describing the table.
+ * @param fileName Name of the file to create.
+ * @param attr_name Name of the INT, LONG or FLOAT attribute to aggregate.
+ * @return 0 on success, -1 on failure (e.g. no numeric attribute with that name).
+ */
+int bplus_create_aggregated_file(const TableSchema *schema, const char *fileName, const char *attr_name);
+
+/**
+ * @brief Creates a new empty B+ tree file whose data blocks store each attribute of their records in a minipage of its
+ *        own (PAX, see bplus_datanode.h), so that scans of one attribute read only its values.
+ * @param schema Pointer to the TableSchema describing the table.
+ * @param fileName Name of the file to create.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_create_pax_file(const TableSchema *schema, const char *fileName);
+
+/**
+ * @brief Creates a new empty B+ tree file with PAX data blocks (as bplus_create_pax_file()) that stores the values of
+ *        its CHAR attributes as codes into per-file dictionaries (see bplus_dictionary.h), for attributes with few
+ *        distinct values.
+ * @param schema Pointer to the TableSchema describing the table.
+ * @param fileName Name of the file to create.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_create_dictionary_file(const TableSchema *schema, const char *fileName);
+
+/**
+ * @brief Creates a new empty keyed B+ tree file, whose primary key is a list of attributes of any types, ordered by
+ *        their normalized key (see bplus_keyed.h); its records are read with bplus_keyed_get() and keyed scans.
+ * @param schema Pointer to the TableSchema describing the table.
+ * @param fileName Name of the file to create.
+ * @param key_names Names of the key attributes, in key order, separated by commas (e.g. "code" or "surname,name").
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_create_keyed_file(const TableSchema *schema, const char *fileName, const char *key_names);
+
 /**
  * @brief Opens a B+ tree file and loads its metadata.
  * @param fileName Name of the file to open.
@@ -36,7 +104,7 @@ int bplus_close_file(int file_desc, BPlusMeta* metadata);
 
 
 /**
- * @brief Inserts a record into the B+ tree.
+ * @brief Inserts a record into the B+ tree (of any kind, including keyed files).
  * @param file_desc File descriptor of the B+ tree file.
  * @param metadata Pointer to the BPlusMeta structure of the tree.
  * @param record Record to insert.
@@ -54,4 +122,68 @@ int bplus_record_insert(int file_desc, BPlusMeta* metadata, const Record *record
  */
 int bplus_record_find(int file_desc, const BPlusMeta *metadata, int key, Record** out_record);
 
+/**
+ * @brief Finds a record in the B+ tree by key, and copies it to a buffer of the caller (no memory is allocated).
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param key Key value to search for.
+ * @param out_record Buffer that gets a copy of the found record (left unchanged if not found).
+ * @return 1 if found, 0 if not found, -1 on failure.
+ */
+int bplus_record_get(int file_desc, const BPlusMeta *metadata, int key, Record *out_record);
+
+/**
+ * @brief Checks whether the B+ tree has a record with a key (no memory is allocated).
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param key Key value to search for.
+ * @return 1 if found, 0 if not found, -1 on failure.
+ */
+int bplus_record_contains(int file_desc, const BPlusMeta *metadata, int key);
+
+// tree helpers shared by the bplus modules (defined in bplus_file_funcs.c)
+
+// replaces the record with the key of record in place, for the modules that rewrite their own entries (the secondary
+// indexes rewrite the entry of a value when its postings change); it is not part of the API, as it does not update
+// secondary indexes: it fails on a file with open ones, and on a memory-mapped file
+// the aggregates on the path of the record, the dictionaries and the cache follow the new values
+// returns 1 if the record was replaced, 0 if the tree has no record with its key, -1 on failure
+int bplus_record_update(int file_desc, BPlusMeta *metadata, const Record *record);
+
+extern const char BF_MAGIC_NUM[4]; // this identifies the file format (stored at the start of block 0)
+extern const char BF_MAGIC_NUM_COUNTED[4]; // the same, for files whose index blocks have subtree counts
+extern const char BF_MAGIC_NUM_AGGREGATED[4]; // the same, for files whose index blocks also have subtree aggregates
+extern const char BF_MAGIC_NUM_PAX[4]; // the same, for files with subtree counts and PAX data blocks
+extern const char BF_MAGIC_NUM_DICTIONARY[4]; // the same, for PAX files with dictionaries
+extern const char BF_MAGIC_NUM_KEYED[4]; // for files with keyed data and index blocks
+extern const char BF_MAGIC_NUM_LONG[4]; // for keyed files with a LONG key and fixed size index entries
+
+// returns 1 if metadata has either magic number, 0 otherwise
+int bplus_magic_num_is_valid(const BPlusMeta *metadata);
+
+// returns 1 if the index blocks of the file of metadata are counted (see bplus_index_node.h), 0 otherwise
+int bplus_file_has_counts(const BPlusMeta *metadata);
+
+// returns 1 if the data blocks of the file of metadata store their records in PAX minipages, 0 otherwise
+int bplus_file_has_pax_layout(const BPlusMeta *metadata);
+
+// returns 1 if the file of metadata stores its CHAR values as dictionary codes (see bplus_dictionary.h), 0 otherwise
+int bplus_file_has_dictionaries(const BPlusMeta *metadata);
+
+// returns 1 if the file of metadata is a keyed file (see bplus_keyed.h), whose keys are not ints, 0 otherwise
+int bplus_file_is_keyed(const BPlusMeta *metadata);
+
+// returns 1 if the file of metadata is a LONG key file (a keyed file with 64-bit keys, see bplus_keyed.h), 0 otherwise
+int bplus_file_has_long_keys(const BPlusMeta *metadata);
+
+// returns the block type of new index blocks of the file of metadata (BLOCK_TYPE_INDEX, BLOCK_TYPE_INDEX_COUNTED or
+// BLOCK_TYPE_INDEX_AGGREGATED)
+int bplus_file_index_block_type(const BPlusMeta *metadata);
+
+// starting from the root block (with root_index), searches for the data block that could contain a record with key as PK
+// found_block must be already initialized, and gets the found block's handle (the block remains pinned)
+// found_block_index gets the found block's index
+// returns 0 on success, -1 otherwise
+int tree_search_data_block(int root_index, int key, int file_desc, BF_Block *found_block, int *found_block_index);
+
 #endif 
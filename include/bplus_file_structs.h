@@ -12,6 +12,7 @@
 
 #include "bf.h"
 #include "record.h"
+#include "bplus_key.h"
 
 /* The structure of a B+ Tree file is the following:
 ** (START)[Block0][Block1][Block2]...[BlockN](END) where N is block_count - 1
@@ -32,6 +33,13 @@ typedef struct {
     int max_indexes_per_block; // maximum number of indexes in an index block to its children
     int root_index; // index of the B+ root (index block)
     TableSchema schema; // info for the stored schema (includes record size)
+    int aggregate_attribute; // position of the aggregated attribute in schema (only set in files with aggregates)
+    int dictionary_blocks[MAX_ATTRIBUTES]; // first dictionary block of each attribute, -1 for none (only set in files
+                                           // with dictionaries, see bplus_dictionary.h)
+    int modification_count; // inserts and updates of records so far, which tell if a secondary index is up to date
+    int indexed_modification_count; // in the file of a secondary index: the modification_count of its tree that
+                                    // the index has the records of (see bplus_secondary.h)
+    BPlusKeyFormat key_format; // key attributes of a keyed file (see bplus_keyed.h)
 } BPlusMeta;
 
 #endif // BPLUS_BPLUS_FILE_STRUCTS_H
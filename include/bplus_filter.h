@@ -0,0 +1,111 @@
+#ifndef BP_FILTER_H
+#define BP_FILTER_H
+
+#include "bplus_file_structs.h"
+#include "record.h"
+
+/* Filtered scans: a scan over the leaf chain that evaluates compiled predicates on the records where they are stored
+** in the data blocks, and returns only the requested attributes of the matching records, as columns.
+** - A predicate is compiled once (bplus_predicate_compile()): the attribute name is resolved to its position in the
+**   schema, so evaluating it does no strcmp over attribute names and copies no record (unlike record_get_value())
+** - The records of each data block are evaluated together: a predicate reads its attribute of the rows still selected
+**   into an array, compares the whole array with its constant, and compacts the selection; the loops have no branch
+**   on the operator or the type inside them, so the compiler can vectorize the comparisons
+** - The selected rows are projected straight from the block into the columns of a BPlusColumnBatch, which collects the
+**   matching rows of as many data blocks as it fits
+** - Predicates on the key attribute also bound the scan: it starts at the data block of the smallest key they allow,
+**   and stops after the largest one
+** - A data block is pinned only while it is evaluated, as in a BPlusScan (see bplus_scan.h), and the same access hints
+**   apply; a memory-mapped file is read in the mapping
+** - In a file with dictionaries (see bplus_dictionary.h), a predicate on a CHAR attribute is evaluated once for each
+**   string of the dictionary when the scan is opened; the rows then look their code up in the resulting table, and
+**   only the projected CHAR values are decoded into strings
+*/
+
+#define BPLUS_FILTER_MAX_PREDICATES 8
+#define BPLUS_FILTER_BATCH_ROWS 256 // at most this many rows per batch
+
+typedef enum {
+    BPLUS_COMPARE_EQ,
+    BPLUS_COMPARE_NE,
+    BPLUS_COMPARE_LT,
+    BPLUS_COMPARE_LE,
+    BPLUS_COMPARE_GT,
+    BPLUS_COMPARE_GE
+} BPlusCompareOp;
+
+typedef struct {
+    int attribute; // position of the attribute in the schema
+    DataType type;
+    int length; // compared characters of a CHAR attribute
+    BPlusCompareOp op;
+    FieldValue constant; // the attribute is compared with it as attribute op constant
+} BPlusPredicate;
+
+typedef struct {
+    int row_count;
+    int column_count;
+    int attributes[MAX_ATTRIBUTES]; // position in the schema of the attribute of each column
+    FieldValue columns[MAX_ATTRIBUTES][BPLUS_FILTER_BATCH_ROWS]; // the rows of each column, in ascending key order
+} BPlusColumnBatch;
+
+typedef struct {
+    int file_desc;
+    const BPlusMeta *metadata;
+    int access_hint; // BPLUS_ACCESS_SCAN or BPLUS_ACCESS_NORMAL
+    int next_block_index; // next data block in the leaf chain, -1 after the last one
+    long long low_key; // the keys that the predicates on the key attribute allow
+    long long high_key;
+    BPlusPredicate predicates[BPLUS_FILTER_MAX_PREDICATES];
+    int predicate_count;
+    int *code_matches[BPLUS_FILTER_MAX_PREDICATES]; // for a predicate on a coded attribute, 1 for each code that
+                                                    // satisfies it and 0 for the others; NULL for the other predicates
+    int code_count[BPLUS_FILTER_MAX_PREDICATES]; // codes in each table (codes added later never match)
+    int columns[MAX_ATTRIBUTES]; // position in the schema of the projected attributes
+    int column_count;
+} BPlusFilterScan;
+
+/**
+ * @brief Compiles a predicate "attribute op constant" for the records of a schema.
+ * @param predicate Pointer to store the compiled predicate.
+ * @param schema Pointer to the TableSchema of the records.
+ * @param attr_name Name of the compared attribute.
+ * @param op The comparison; CHAR attributes compare as strncmp() does, up to their length.
+ * @param constant Pointer to the constant, as an int, float, long long or string for an INT, FLOAT, LONG or CHAR
+ *        attribute respectively (the same as the output of record_get_value()).
+ * @return 0 on success, -1 on failure (e.g. no attribute with that name).
+ */
+int bplus_predicate_compile(BPlusPredicate *predicate, const TableSchema *schema, const char *attr_name,
+                            BPlusCompareOp op, const void *constant);
+
+/**
+ * @brief Opens a filtered scan over all records of the tree that satisfy every one of a set of predicates.
+ * @param scan Pointer to the scan to open; it must be closed with bplus_filter_close() even if opening fails.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param predicates The compiled predicates (none for all records); they are copied into the scan.
+ * @param predicate_count Number of predicates (at most BPLUS_FILTER_MAX_PREDICATES).
+ * @param column_names Names of the attributes to return for each matching record, in the order of the columns.
+ * @param column_count Number of attributes to return (at most MAX_ATTRIBUTES).
+ * @param access_hint BPLUS_ACCESS_SCAN or BPLUS_ACCESS_NORMAL, as for bplus_scan_open().
+ * @return 0 on success, -1 on failure (e.g. an unknown attribute name).
+ */
+int bplus_filter_open(BPlusFilterScan *scan, int file_desc, const BPlusMeta *metadata, const BPlusPredicate *predicates,
+                      int predicate_count, const char *const *column_names, int column_count, int access_hint);
+
+/**
+ * @brief Gets the next batch of matching records of a filtered scan, in ascending key order.
+ * @param scan Pointer to an open scan.
+ * @param batch Pointer to store the projected attributes of the records, one column per requested attribute.
+ * @return The number of records in the batch (at most BPLUS_FILTER_BATCH_ROWS), 0 at the end of the scan, -1 on
+ *         failure.
+ */
+int bplus_filter_next(BPlusFilterScan *scan, BPlusColumnBatch *batch);
+
+/**
+ * @brief Closes a filtered scan.
+ * @param scan Pointer to the scan.
+ */
+void bplus_filter_close(BPlusFilterScan *scan);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef BP_FINGER_H
+#define BP_FINGER_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Finger search: point lookups and inserts start from the data block that the previous one on the file ended in,
+** instead of descending from the root, when the key is in that data block's key range.
+** - A descent from the root remembers (in the file's handle) the data block it reached, the range of keys that the
+**   index blocks route to it (bounded by the entry keys on either side of it, on every level), its next data block,
+**   and the block count of the tree
+** - Entry keys of index blocks only change when blocks are split, and a split always allocates a block, so while the
+**   block count is unchanged the range is exact: a key in it is looked for in that data block with one block fetch
+** - A key past the range is tried in the next data block, whose range starts where this one ends, if the previous
+**   operation used the finger (keys that move forward, as in sorted batches or ascending ids); it is accepted if
+**   it is not past the last key of that block (or that block is the last one)
+** - After a split the remembered range may be stale; a key in it is then accepted only if the data block's current
+**   records show the block still holds it (between its smallest and largest key, or past the smallest key of the last
+**   data block), else the operation descends from the root as before
+** - The path of index blocks above the data block is not kept: the index blocks above are only needed when the data
+**   block is split, and the insert reads them through the parent_index links of the blocks then
+** - Memory-mapped files do not use the finger, as their descents need no block fetches
+*/
+
+typedef struct {
+    long hits; // operations that started from the finger
+    long misses; // operations that descended from the root
+} BPlusFingerStats;
+
+/**
+ * @brief Gets the counters of the finger search of an open B+ tree file.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param stats Pointer to store the counters.
+ * @return 0 on success, -1 if the file is not open.
+ */
+int bplus_finger_stats(int file_desc, BPlusFingerStats *stats);
+
+// searches for the data block that could contain a record with key as PK, as tree_search_data_block() does, but
+// starting from the finger of file_desc when the key is in its range; the finger is moved to the found block
+// found_block must be already initialized, and gets the found block's handle (the block remains pinned)
+// found_block_index gets the found block's index
+// returns 0 on success, -1 otherwise
+int bplus_finger_search_data_block(int file_desc, const BPlusMeta *metadata, int key, BF_Block *found_block,
+                                   int *found_block_index);
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef BP_HANDLE_H
+#define BP_HANDLE_H
+
+#include "bplus_file_structs.h"
+#include "bplus_arena.h"
+
+/* Runtime state that is kept for each open B+ tree file, between bplus_open_file() and bplus_close_file().
+** - It is never written to the file, so it does not change the file format
+** - It is looked up with the file descriptor that BF_OpenFile() returned, which is always in [0, BF_MAX_OPEN_FILES)
+** - Files opened with bplus_open_file_mmap() are not opened by BF; they get descriptors in
+**   [BF_MAX_OPEN_FILES, BPLUS_MAX_HANDLES) instead, so that both kinds can be told apart by the descriptor
+** - Each feature that needs per-file state adds its members here, and frees them in bplus_handle_close()
+*/
+
+#define BPLUS_MAX_HANDLES (2 * BF_MAX_OPEN_FILES) // BF files, then memory-mapped files
+#define BPLUS_INSERT_BLOCK_COUNT 8 // BF block handles an insert uses at most at once (see bplus_record_insert())
+#define BPLUS_MAX_SECONDARY_INDEXES 8 // secondary indexes of a file that can be open at once
+
+// access hints of block fetches, see bplus_handle_touch()
+#define BPLUS_ACCESS_NORMAL 0 // the block may be needed again soon (lookups, inserts)
+#define BPLUS_ACCESS_SCAN 1 // the block is read once, by a pass over many blocks (see bplus_scan.h)
+
+struct bplus_async_request; // defined in bplus_async.h
+struct bplus_warm_entry; // defined in bplus_warm.h
+struct bplus_bloom; // defined in bplus_bloom.h
+struct bplus_cache; // defined in bplus_cache.h
+struct bplus_secondary; // defined in bplus_secondary.h
+struct bplus_dictionary; // defined in bplus_dictionary.h
+
+typedef struct {
+    int is_open; // 1 between bplus_handle_open() and bplus_handle_close(), 0 otherwise
+    char *file_name; // name the file was opened with
+
+    // read-only mapping of the whole file, for files opened with bplus_open_file_mmap() or bplus_open_file_arena();
+    // NULL otherwise
+    char *map;
+    size_t map_size; // size of the file
+    size_t map_length; // length of the mapping (an arena is rounded up to whole huge pages)
+
+    // lookups submitted with bplus_record_find_async() that are not yet completed, in submission order
+    struct bplus_async_request *async_queue;
+    int async_count;
+    int async_capacity;
+    long async_sequence; // submission counter, used to order lookups with equal keys
+
+    // kernel page cache handling, see bplus_io.h
+    int io_mode;
+    int io_fd; // own descriptor of the file, only used for posix_fadvise(); -1 if not opened
+    int io_operations; // operations since the kernel copies of the file's blocks were last dropped
+
+    // working set of the BF frames, see bplus_warm.h; allocated by bplus_warm_enable(), NULL while tracking is off
+    struct bplus_warm_entry *warm_blocks; // BPLUS_WARM_TABLE_SIZE slots
+    int warm_count; // slots in use
+    long warm_clock; // access counter, gives the recency of the tracked blocks
+
+    // frame quota in the BF pool, see bplus_pool.h; 0 for none
+    int pool_min_frames;
+    int pool_max_frames;
+
+    // Bloom filter of the keys, see bplus_bloom.h; NULL if not enabled
+    struct bplus_bloom *bloom;
+
+    // record cache of the point lookups, see bplus_cache.h; NULL if not enabled
+    struct bplus_cache *cache;
+
+    // finger of the point lookups and inserts, see bplus_finger.h; finger_block_index is -1 if there is none
+    int finger_block_index; // data block that the last descent reached
+    int finger_next_index; // its next data block
+    long long finger_lower_key; // keys in [finger_lower_key, finger_upper_key) are routed to it
+    long long finger_upper_key;
+    int finger_upper_is_exact; // 1 if the next data block's keys start at finger_upper_key
+    int finger_block_count; // block count of the tree when the finger was moved
+    int finger_last_was_hit; // 1 if the last operation started from the finger
+    long finger_hits;
+    long finger_misses;
+
+    // open secondary indexes, see bplus_secondary.h; NULL for a free slot
+    struct bplus_secondary *secondary[BPLUS_MAX_SECONDARY_INDEXES];
+
+    // strings of the dictionaries of the file, see bplus_dictionary.h; NULL if the file has none
+    struct bplus_dictionary *dictionary;
+
+    // buffers and BF block handles of bplus_record_insert(), made when a BF file is opened and reused by every insert
+    // (bplus_record_get() borrows one of the block handles as well)
+    BPlusArena insert_arena;
+    BF_Block *insert_blocks[BPLUS_INSERT_BLOCK_COUNT]; // the handles that are not in use by the running insert
+    int insert_block_count;
+} BPlusHandle;
+
+// initializes the runtime state of file_desc, which was opened with file_name; any previous state is discarded
+// returns 0 on success, -1 if file_desc is out of range or if unsuccessful
+int bplus_handle_open(int file_desc, const char *file_name);
+
+// returns the first descriptor in [BF_MAX_OPEN_FILES, BPLUS_MAX_HANDLES) that is not open, or -1 if all are open
+int bplus_handle_free_mapped_desc();
+
+// frees the runtime state of file_desc (nothing happens if it is not open)
+// must be called after BF_CloseFile(), so that the blocks BF writes back on close are already in the file
+void bplus_handle_close(int file_desc);
+
+// records that the bplus layer got block_index of file_desc from BF, for the modules that follow the BF frames
+// (bplus_warm.h, bplus_pool.h); access_hint is BPLUS_ACCESS_NORMAL or BPLUS_ACCESS_SCAN
+void bplus_handle_touch(int file_desc, int block_index, int access_hint);
+
+// returns the runtime state of file_desc
+// returns NULL if file_desc is out of range or not opened with bplus_handle_open()
+BPlusHandle *bplus_handle_get(int file_desc);
+
+#endif
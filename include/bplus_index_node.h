@@ -2,8 +2,14 @@
 #define BP_INDEX_NODE_H
 
 #include "bplus_file_structs.h"
+#include "bplus_aggregate.h"
 
 #define BLOCK_TYPE_INDEX 1
+#define BLOCK_TYPE_INDEX_PACKED 2 // an index block whose entries are packed (see below)
+#define BLOCK_TYPE_INDEX_COUNTED 3 // a BLOCK_TYPE_INDEX block with subtree counts (see below)
+#define BLOCK_TYPE_INDEX_PACKED_COUNTED 4 // a BLOCK_TYPE_INDEX_PACKED block with subtree counts
+#define BLOCK_TYPE_INDEX_AGGREGATED 5 // a BLOCK_TYPE_INDEX_COUNTED block with subtree aggregates (see below)
+#define BLOCK_TYPE_INDEX_PACKED_AGGREGATED 6 // a BLOCK_TYPE_INDEX_PACKED_COUNTED block with subtree aggregates
 #define INDEX_BLOCK_SEARCH_ERROR -2 // this refers to runtime errors (malloc etc), not logical edge cases; should be less than -1
 
 /* Στο αντίστοιχο αρχείο .h μπορείτε να δηλώσετε τις συναρτήσεις
@@ -18,9 +24,55 @@
 ** - IndexNodeEntry (0) ... IndexNodeEntry (k) with k < max_indexes_per_block are key-index entries,
 **                                             such that for each key accessible via entry.index, key >= entry.key for any entry;
 **                                             when a new one is inserted, some others are shifted to maintain ordering
-** - possibly unused space is either space not yet used by future entries or a remainder < sizeof(IndexNodeEntry)
+** - possibly unused space is either space not yet used by future entries or a remainder < 2 * sizeof(int)
+** - each IndexNodeEntry is stored as its key and right_index (its count is only kept by counted blocks, see below)
+**
+** An index block with more entries than fit as plain entries (INDEX_BLOCK_PLAIN_CAPACITY) is packed instead:
+** (START)[int][IndexNodeHeader][int][IndexNodePacking][packed entry][packed entry]...[possibly unused space](END)
+** - int (first) is BLOCK_TYPE_INDEX_PACKED
+** - the key and the child index of each entry are stored as their differences from the key_base and child_base of
+**   IndexNodePacking, in key_width and child_width bytes (least significant first); key_base is the smallest entry
+**   key (entries are sorted by key) and child_base the smallest child index of the entries, so the common high
+**   order bytes of the keys and of the child indexes are stored once per block instead of once per entry
+** - the widths are the fewest bytes that hold the largest difference; the keys that an index block routes span a
+**   narrower range the lower the block is in the tree, so the entries of the lower levels take fewer than 8 bytes
+** - blocks are packed when their entries are written (index_block_write_array_as_entries()); the other functions
+**   below read both kinds, so the rest of the tree does not depend on how a block is stored
+** - max_indexes_per_block of a file allows up to twice INDEX_BLOCK_PLAIN_CAPACITY indexes (less one), so that both
+**   halves of a split always fit as plain entries; a block is full when either that count is reached or its packed
+**   entries would not fit (index_block_has_available_space())
+**
+** The index blocks of a file with subtree counts (see bplus_file_has_counts()) are counted blocks: either layout above,
+** and also the number of records under each child, as an int per index that is stored from the end of the block back
+** (START)[int][IndexNodeHeader][int][entries (plain or packed)][possibly unused space][int]...[int][int](END)
+** - the last int of the block is the count of the leftmost index, the one before it that of the first entry, etc.;
+**   as the counts do not move when entries are added, a count is updated in place (index_block_add_to_aggregate())
+** - the counts take 4 bytes each whatever their value, so that updating one never makes the entries not fit; so
+**   counted blocks have less room for entries (INDEX_BLOCK_COUNTED_PLAIN_CAPACITY plain ones), and the files with
+**   counts allow twice that many indexes (less one)
+**
+** The index blocks of a file with an aggregated attribute (see bplus_aggregate.h) are aggregated blocks: counted
+** blocks whose slot of each child at the end of the block (INDEX_BLOCK_AGGREGATE_SLOT_SIZE bytes) holds the count,
+** then the min, max and sum of the attribute over the records under the child, as 8 bytes each (a long long for INT
+** and LONG attributes, a double for FLOAT ones); these have room for INDEX_BLOCK_AGGREGATED_PLAIN_CAPACITY plain entries
 */
 
+// the most indexes (leftmost index included) that an index block holds as plain entries
+#define INDEX_BLOCK_PLAIN_CAPACITY \
+    (1 + (int)((BF_BLOCK_SIZE - sizeof(IndexNodeHeader) - 2 * sizeof(int)) / (2 * sizeof(int))))
+
+// the most indexes (leftmost index included) that a counted index block holds as plain entries
+#define INDEX_BLOCK_COUNTED_PLAIN_CAPACITY \
+    (1 + (int)((BF_BLOCK_SIZE - sizeof(IndexNodeHeader) - 3 * sizeof(int)) / (3 * sizeof(int))))
+
+// bytes of the slot of each child of an aggregated index block: count, min, max and sum
+#define INDEX_BLOCK_AGGREGATE_SLOT_SIZE ((int)(sizeof(int) + 3 * sizeof(BPlusAggregateValue)))
+
+// the most indexes (leftmost index included) that an aggregated index block holds as plain entries
+#define INDEX_BLOCK_AGGREGATED_PLAIN_CAPACITY \
+    (1 + (int)((BF_BLOCK_SIZE - sizeof(IndexNodeHeader) - 2 * sizeof(int) - INDEX_BLOCK_AGGREGATE_SLOT_SIZE) \
+               / (2 * sizeof(int) + INDEX_BLOCK_AGGREGATE_SLOT_SIZE)))
+
 typedef struct {
     // index_count is the number of children indexes currently stored
     // number of keys is always index_count - 1
@@ -36,13 +88,29 @@ typedef struct {
     // the leftmost index of an index node is defined separately of this struct
     int key;
     int right_index;
+    BPlusAggregate aggregate; // records under right_index: their count in counted blocks (0 in the others), and
+                              // also their min, max and sum in aggregated blocks
 } IndexNodeEntry;
 
-// returns 1 if this is an index block, 0 otherwise
+typedef struct {
+    int key_base; // key of the first entry
+    int child_base; // smallest right_index of the entries
+    unsigned char key_width; // bytes of each key difference, 1 to 4
+    unsigned char child_width; // bytes of each child index difference, 1 to 4
+} IndexNodePacking;
+
+// returns 1 if this is an index block (plain or packed, counted or not), 0 otherwise
 int is_index_block(const char *block_start);
 
-// sets the block type to index block
-void set_index_block(char *block_start);
+// returns 1 if this is a counted index block (aggregated or not), 0 otherwise
+int index_block_has_counts(const char *block_start);
+
+// returns 1 if this is an aggregated index block, 0 otherwise
+int index_block_has_aggregates(const char *block_start);
+
+// sets the block type to index block of block_type: BLOCK_TYPE_INDEX, BLOCK_TYPE_INDEX_COUNTED or
+// BLOCK_TYPE_INDEX_AGGREGATED (the packed variants are set when entries are written)
+void set_index_block(char *block_start, int block_type);
 
 // prints an index block (requires pointer to block data)
 void index_block_print(const char *block_start, const BPlusMeta* metadata);
@@ -52,6 +120,9 @@ void index_block_print(const char *block_start, const BPlusMeta* metadata);
 // caller is responsible for freeing the returned memory
 IndexNodeHeader *index_block_read_header(const char *block_start);
 
+// copies the index node header of a block to header (no memory is allocated)
+void index_block_copy_header(const char *block_start, IndexNodeHeader *header);
+
 // returns the leftmost index of a block
 int index_block_read_leftmost_index(const char *block_start);
 
@@ -66,8 +137,9 @@ IndexNodeEntry *index_block_read_entry(const char *block_start, const IndexNodeH
 // entry_array buffer is assumed to be large enough to fit the entries; if not, this is undefined behavior
 void index_block_read_entries_as_array(const char *block_start, const IndexNodeHeader *block_header, IndexNodeEntry *entry_array);
 
-// returns 1 if at least one more entry can be inserted, 0 otherwise
-int index_block_has_available_space(const IndexNodeHeader *block_header, const BPlusMeta *metadata);
+// returns 1 if one more entry (with new_key and new_right_index) can be inserted, 0 otherwise
+int index_block_has_available_space(const char *block_start, const IndexNodeHeader *block_header,
+                                    const BPlusMeta *metadata, int new_key, int new_right_index);
 
 // writes header in the IndexNodeHeader part of the block
 void index_block_write_header(char *block_start, const IndexNodeHeader *header);
@@ -77,7 +149,10 @@ void index_block_write_leftmost_index(char *block_start, int leftmost_index);
 
 // writes the first count entries of entry_array to the block's entries, **including leftmost index** which
 // is assigned the index of entry_array[0]; also the key of entry_array[0] becomes the block's minimum key
-// count is assumed to not exceed max index count; else, this is undefined behavior
+// the entries are packed if they do not fit as plain entries (this also sets the block type, which stays counted,
+// aggregated or neither), and counted blocks also get the counts (and aggregated ones the aggregates) of the entries
+// count is assumed to not exceed max index count, and the entries to fit (see index_block_has_available_space());
+// else, this is undefined behavior
 // if count < 1 it does nothing
 void index_block_write_array_as_entries(char *block_start, IndexNodeHeader *block_header,
                                         const IndexNodeEntry *entry_array, int count);
@@ -93,4 +168,32 @@ int index_block_search_insert_pos(const char *block_start, const IndexNodeHeader
 // returns INDEX_BLOCK_SEARCH_ERROR if unsuccessful
 int index_block_key_search(const char *block_start, const IndexNodeHeader *block_header, int key);
 
+// returns the index of the child block that can lead to the specified key (the leftmost index or an entry's right_index)
+// same search as index_block_key_search(), but entries are read in place, so no memory is allocated
+int index_block_find_child(const char *block_start, int key);
+
+// same as index_block_find_child(), and also narrows [*lower_key, *upper_key), which must hold the keys the index block
+// covers, to the keys the child covers (bounded by the keys of the entries on either side of it)
+int index_block_find_child_bounds(const char *block_start, int key, long long *lower_key, long long *upper_key);
+
+// returns the position of the child that can lead to the specified key: 0 for the leftmost index, i + 1 for entry i
+int index_block_find_child_position(const char *block_start, int key);
+
+// returns the index of the child at position (as in index_block_find_child_position()), read in place
+int index_block_read_child(const char *block_start, int position);
+
+// returns the count of the child at position (as in index_block_find_child_position()) of a counted block
+int index_block_read_count(const char *block_start, int position);
+
+// copies the count (and, in an aggregated block, the aggregate) of the child at position of a counted block to
+// aggregate
+void index_block_read_aggregate(const char *block_start, int position, BPlusAggregate *aggregate);
+
+// overwrites the count (and, in an aggregated block, the aggregate) of the child at position of a counted block
+void index_block_write_aggregate(char *block_start, int position, const BPlusAggregate *aggregate);
+
+// adds the records of delta to the count (and, in an aggregated block, the aggregate) of the child at position of a
+// counted block; type is that of the aggregated attribute
+void index_block_add_to_aggregate(char *block_start, int position, const BPlusAggregate *delta, DataType type);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef BP_IO_H
+#define BP_IO_H
+
+#include "bplus_handle.h"
+
+/* Kernel page cache handling of a B+ tree file.
+** The blocks of an open file are cached by the BF layer (BF_BUFFER_SIZE frames) and, because BF uses buffered
+** file I/O, a second time by the kernel page cache. In BPLUS_IO_UNCACHED mode the kernel copies of the file's
+** blocks are dropped regularly (posix_fadvise(POSIX_FADV_DONTNEED)) and when the file is closed, so that memory
+** use is bounded by the BF frames and a block that is not in a BF frame is always read from the device.
+** - The BF layer opens and reads the file itself, so O_DIRECT (and aligned frames) cannot be requested for its I/O;
+**   dropping the kernel copies is what bounds the memory instead
+** - Dirty blocks that BF wrote back but the kernel has not yet written to the device are not dropped until they are;
+**   they are flushed (fdatasync) before the final drop on close
+*/
+
+#define BPLUS_IO_BUFFERED 0 // default: the kernel caches the file's blocks as well
+#define BPLUS_IO_UNCACHED 1 // the kernel copies of the file's blocks are dropped regularly
+#define BPLUS_IO_DROP_INTERVAL 256 // operations (lookups, inserts) between two drops, in BPLUS_IO_UNCACHED mode
+
+/**
+ * @brief Sets the page cache mode of an open B+ tree file.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param mode BPLUS_IO_BUFFERED or BPLUS_IO_UNCACHED.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_set_io_mode(int file_desc, int mode);
+
+// counts operation_count operations (lookups, inserts) on file_desc; in BPLUS_IO_UNCACHED mode, drops the kernel
+// copies of the file's blocks every BPLUS_IO_DROP_INTERVAL operations
+void bplus_io_account(int file_desc, int operation_count);
+
+// releases the page cache state of a handle; in BPLUS_IO_UNCACHED mode the file is flushed and its kernel copies are dropped
+void bplus_io_close(BPlusHandle *handle);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef BP_KEY_H
+#define BP_KEY_H
+
+#include "record.h"
+
+/* Normalized keys: the values of a list of attributes of a record, encoded into a byte string whose memcmp() order
+** is the order of the values (compared attribute by attribute), so that keys of any types (INT, FLOAT, CHAR(n) and
+** composites of them) are compared by a single memcmp() instead of per type.
+** - INT: 4 bytes, big endian, with the sign bit flipped (so negative values come first)
+** - LONG: 8 bytes, as INT
+** - FLOAT: 4 bytes, big endian; the sign bit is flipped for positive values, and all bits are flipped for negative
+**   ones (so larger magnitudes come first); -0.0 is encoded as 0.0
+** - CHAR(n): the n bytes of the string, zero padded after its end; the characters are compared as unsigned bytes,
+**   and a string sorts before the longer strings that it is a prefix of
+** - Every attribute has a fixed width, so a composite key is the concatenation of its attributes' encodings, and all
+**   keys of a format have the same length
+*/
+
+#define BPLUS_KEY_MAX_LENGTH (MAX_ATTRIBUTES * MAX_STRING_LENGTH) // longest normalized key
+
+typedef struct {
+    int attribute_count;
+    int attributes[MAX_ATTRIBUTES]; // positions in the schema, in key order
+    int length; // bytes of a normalized key
+} BPlusKeyFormat;
+
+/**
+ * @brief Initializes a key format from a list of attribute names.
+ * @param format Format to initialize.
+ * @param schema Schema of the records the keys are made from.
+ * @param attr_names Names of the key attributes, in key order, separated by commas (e.g. "surname,name").
+ * @return 0 on success, -1 if a name is not in the schema, is repeated, or there are too many.
+ */
+int bplus_key_format_init(BPlusKeyFormat *format, const TableSchema *schema, const char *attr_names);
+
+/**
+ * @brief Encodes the normalized key of a record.
+ * @param format Key format (initialized with the schema of the record).
+ * @param schema Schema of the record.
+ * @param record The record.
+ * @param key Buffer of at least format->length bytes that gets the key.
+ */
+void bplus_key_encode(const BPlusKeyFormat *format, const TableSchema *schema, const Record *record,
+                      unsigned char *key);
+
+/**
+ * @brief Compares two normalized keys of a format.
+ * @param format Key format of both keys.
+ * @param key1 First key.
+ * @param key2 Second key.
+ * @return <0, 0 or >0, as memcmp(), if the values of key1 are less than, equal to or greater than those of key2.
+ */
+int bplus_key_compare(const BPlusKeyFormat *format, const unsigned char *key1, const unsigned char *key2);
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef BP_KEYED_H
+#define BP_KEYED_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+#include "bplus_key.h"
+
+/* Keyed files: B+ trees whose primary key is a list of attributes of any types (one CHAR or FLOAT attribute, or a
+** composite such as "surname,name"), made with bplus_create_keyed_file(). The tree orders its records by the
+** normalized keys of their key attributes (see bplus_key.h), so every node search is a memcmp() of byte strings.
+** - Block 0 has the key format of the file (key_format in BPlusMeta), and the other blocks are keyed data and index
+**   blocks; the records are inserted with bplus_record_insert(), and read with bplus_keyed_get() and keyed scans (the
+**   modules of the library also rewrite their own records in place with bplus_record_update())
+** - A keyed data block has the normalized keys of its records in ascending order, then the records in the same order:
+**   (START)[int][KeyedDataHeader][key][key]...[key][record][record]...[record][possibly unused space](END)
+**   - int is BLOCK_TYPE_KEYED_DATA
+**   - there is room for max_records_per_block keys and records (see BPlusMeta); a search is a binary search over
+**     the keys, with one memcmp() per step
+** - A keyed index block has the index of its first child, then entries of a separator and the child whose keys are
+**   at least that separator (and less than the next one):
+**   (START)[int][KeyedIndexHeader][prefix][entry][entry]...[entry][possibly unused space](END)
+**   - int is BLOCK_TYPE_KEYED_INDEX
+**   - a separator is the shortest prefix of the smallest key of its child that is greater than the largest key left
+**     of it (suffix truncation), so separators are often a byte or two even for long keys
+**   - the bytes that all the separators of the block start with are stored once, as prefix (prefix_length bytes),
+**     and an entry is [length (1 byte)][rest of the separator (length bytes)][child index (int)]; the keys under an
+**     index block deep in the tree share their first bytes (a surname, a date), so an index block has room for many
+**     entries; the prefix is recomputed whenever the block is written, and a split picks the middle entry so that
+**     both halves fit with their own prefixes
+**   - a key is at least a separator if its first bytes compare >= to it with memcmp() (the separator is a prefix of
+**     a key of the child, so an equal prefix means a key that is not less); the search compares the key with the
+**     prefix once (a key below or above it is below or above all the separators), then walks the entries with one
+**     memcmp() of the rest of the key each
+** - Data and index blocks have no parent index: an insert descends from the root, keeps the path in a stack, and a
+**   split adds the separator of its new block to the parent on the stack, splitting up to the root as needed
+** - The keys are unique: an insert of a record whose key is in the tree fails, and leaves the file unchanged
+**
+** LONG key files: keyed files made by bplus_create_file() for a schema whose key attribute is a LONG, for tables with
+** 64-bit ids (BF_MAGIC_NUM_LONG, see bplus_file_has_long_keys()). Their keys are the 8 byte normalized LONG values.
+** - The data blocks are keyed data blocks, with room for as many records as the int key data blocks
+** - The index block entries have a fixed size: [rest of the separator (8 - prefix_length bytes)][child index (int)],
+**   with no length byte, as the separators are whole keys; the search is a binary search over the entries, with one
+**   memcmp() per step
+** - So an index block has room for (BF_BLOCK_SIZE - 20) / 12 = 41 entries (42 children) with no common prefix, and
+**   for more as the ids under it share their high bytes (61 with 4 of them, as neighbouring ids of a dense range do),
+**   against 62 children as plain entries (and up to 123 packed) of an int key index block (see the bench)
+** - The block indexes (children, next data blocks, root) stay ints, as the BF layer numbers its blocks with ints
+** - The other B+ tree functions need int keys, and fail on keyed files (they check bplus_file_is_keyed())
+*/
+
+#define BLOCK_TYPE_KEYED_DATA 9 // after the postings block type (see bplus_secondary.h)
+#define BLOCK_TYPE_KEYED_INDEX 10 // with variable or fixed size entries, as the file has (see above)
+#define BPLUS_KEYED_MAX_RECORDS ((int)((BF_BLOCK_SIZE - sizeof(int) - sizeof(KeyedDataHeader)) / (sizeof(Record) + 1)))
+#define BPLUS_KEYED_MAX_DEPTH 32 // levels of a keyed tree (far more than the block count of a BF file allows)
+
+typedef struct {
+    int record_count; // number of records in the block
+    int next_index; // next data block in key order, -1 for the last one
+} KeyedDataHeader;
+
+typedef struct {
+    int entry_count; // number of entries in the block
+    int used; // bytes of the entries, after the prefix
+    int first_index; // child with the keys less than the first separator
+    int prefix_length; // bytes that all the separators start with, stored once before the entries
+} KeyedIndexHeader;
+
+typedef struct {
+    int file_desc;
+    const BPlusMeta *metadata;
+    int next_block_index; // next data block in key order, -1 after the last one
+    Record records[BPLUS_KEYED_MAX_RECORDS]; // copies of the records of the current data block, in key order
+    int record_count;
+    int position; // next record of records to return
+} BPlusKeyedScan;
+
+/**
+ * @brief Finds the record of a keyed file whose key attributes equal those of a probe record.
+ * @param file_desc File descriptor of the keyed B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param probe Record whose key attributes hold the key to look for (the others are ignored).
+ * @param out_record Buffer that gets a copy of the found record (left unchanged if not found; may be NULL).
+ * @return 1 if found, 0 if not found, -1 on failure (e.g. not a keyed file).
+ */
+int bplus_keyed_get(int file_desc, const BPlusMeta *metadata, const Record *probe, Record *out_record);
+
+/**
+ * @brief Starts a scan of the records of a keyed file with keys at least that of a record, in ascending key order.
+ * @param scan Scan to start (caller owned; release it with bplus_keyed_scan_close()).
+ * @param file_desc File descriptor of the keyed B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree; must stay valid until the scan is closed.
+ * @param start Record whose key attributes hold the smallest key to return, or NULL to start from the first record.
+ * @return 0 on success, -1 on failure (e.g. not a keyed file).
+ */
+int bplus_keyed_scan_open(BPlusKeyedScan *scan, int file_desc, const BPlusMeta *metadata, const Record *start);
+
+/**
+ * @brief Returns the next record of a keyed scan.
+ * @param scan An open scan.
+ * @param record Pointer to store a copy of the record.
+ * @return 1 if a record was returned, 0 at the end of the scan, -1 on failure.
+ */
+int bplus_keyed_scan_next(BPlusKeyedScan *scan, Record *record);
+
+/**
+ * @brief Releases the resources of a keyed scan.
+ * @param scan Scan started with bplus_keyed_scan_open().
+ */
+void bplus_keyed_scan_close(BPlusKeyedScan *scan);
+
+// returns the number of records that fit in a keyed data block of a file with keys of format
+int bplus_keyed_data_capacity(const BPlusKeyFormat *format);
+
+// inserts record into the keyed file of file_desc, for bplus_record_insert(); block 0 and metadata (the caller's copy)
+// get the new counts and root
+// returns the index of the data block that the record was stored in, or -1 if unsuccessful (e.g. a duplicate key)
+int bplus_keyed_insert(int file_desc, BPlusMeta *metadata, const Record *record);
+
+// replaces the record with the key of record in the keyed file of file_desc, in place, for bplus_record_update();
+// block 0 and metadata (the caller's copy) get the new modification_count
+// returns 1 if the record was replaced, 0 if the file has no record with its key, -1 if unsuccessful
+int bplus_keyed_update(int file_desc, BPlusMeta *metadata, const Record *record);
+
+// prints a keyed data or index block (requires pointer to block data)
+void keyed_block_print(const char *block_start, const BPlusMeta *metadata);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef BP_MMAP_H
+#define BP_MMAP_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Memory-mapped read-only mode, for processes that only look records up.
+** The whole file is mapped read-only and block i is found at map + i * BF_BLOCK_SIZE (the BF layer stores the
+** blocks of a file back to back, with no file header), so a lookup navigates the tree with pointer arithmetic and
+** the same node accessors as the BF path, without pinning, unpinning or copying blocks.
+** - The kernel pages the file in on demand; the mapping is advised MADV_RANDOM (no readahead for leaves) and the
+**   index blocks are advised MADV_WILLNEED when the file is opened, so the upper levels are read in early
+** - The mapping sees the file as it is on disk, so no process should be writing the file while it is mapped
+**   (BF keeps dirty blocks in its frames until they are evicted or the file is closed)
+** - bplus_open_file_arena() reads the whole file into one anonymous, 2 MiB aligned arena instead, advised
+**   MADV_HUGEPAGE, so that a large tree is held in few huge pages and lookups take far fewer TLB misses than with
+**   4 KiB pages; the file is read once when it is opened and later changes to it are not seen
+** - bplus_record_insert() fails on a mapped file; bplus_record_find(), bplus_record_find_batch(), the async
+**   lookups and bplus_close_file() work as usual
+*/
+
+/**
+ * @brief Opens a B+ tree file read-only by mapping it in memory, and loads its metadata.
+ * @param fileName Name of the file to open.
+ * @param file_desc Pointer to store the file descriptor (not a BF descriptor, see bplus_handle.h).
+ * @param metadata Pointer to store the metadata structure (allocated by the function).
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_open_file_mmap(const char *fileName, int *file_desc, BPlusMeta **metadata);
+
+#define BPLUS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// flags of bplus_open_file_arena()
+#define BPLUS_ARENA_SMALL_PAGES 0 // the arena is left to 4 KiB pages (for comparison)
+#define BPLUS_ARENA_HUGE_PAGES 1 // the arena is advised MADV_HUGEPAGE
+
+/**
+ * @brief Opens a B+ tree file read-only by reading it whole into a memory arena, and loads its metadata.
+ * @param fileName Name of the file to open.
+ * @param file_desc Pointer to store the file descriptor (not a BF descriptor, see bplus_handle.h).
+ * @param metadata Pointer to store the metadata structure (allocated by the function).
+ * @param flags BPLUS_ARENA_HUGE_PAGES or BPLUS_ARENA_SMALL_PAGES.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_open_file_arena(const char *fileName, int *file_desc, BPlusMeta **metadata, int flags);
+
+// returns 1 if handle is a file opened with bplus_open_file_mmap() or bplus_open_file_arena(), 0 otherwise
+int bplus_mmap_is_mapped(const BPlusHandle *handle);
+
+// searches the mapped file of handle for the record with key as PK, and copies it to record (with the strings of its
+// dictionary codes, see bplus_dictionary.h)
+// returns 1 if found, 0 if not found
+int bplus_mmap_find(const BPlusHandle *handle, const BPlusMeta *metadata, int key, Record *record);
+
+// returns the block with block_index in the mapped file of handle, or NULL if it is outside the file
+const char *bplus_mmap_block(const BPlusHandle *handle, int block_index);
+
+// searches the mapped file of handle for the data block that could contain a record with key as PK
+// returns its block index, or -1 if the tree is empty or the file is damaged
+int bplus_mmap_search_data_block(const BPlusHandle *handle, const BPlusMeta *metadata, int key);
+
+// unmaps the file of handle, if it is mapped
+void bplus_mmap_close(BPlusHandle *handle);
+
+#endif
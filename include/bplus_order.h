@@ -0,0 +1,49 @@
+#ifndef BP_ORDER_H
+#define BP_ORDER_H
+
+#include "bplus_file_structs.h"
+#include "record.h"
+
+/* Order statistics: the rank of a key, the number of keys in a range, and the record at a position of the key order
+** (an OFFSET), in one descent from the root instead of a scan over the leaf chain.
+** - Every index block of a file with subtree counts (made with bplus_create_counted_file(), or a PAX or aggregated
+**   file; see bplus_index_node.h) keeps, next to each child index, the number of records under that child; a
+**   descent adds up the counts of the children left of the one it follows, and in the data block it reaches counts
+**   the records below the key
+** - Inserts keep the counts exact: a split gives both halves the counts of their entries, and the insert adds 1 to
+**   the counts on the path above the level where it stops splitting; records are never deleted, so no count drops
+** - Files made with bplus_create_file() have no counts in their index blocks; on them the same functions scan the
+**   leaf chain instead, so they give the same results, in time linear in the records below the key
+*/
+
+/**
+ * @brief Counts the records whose key is less than a key.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param key The key (it does not need to be in the tree).
+ * @return The number of records with smaller keys (the rank of key, from 0), or -1 on failure.
+ */
+int bplus_rank(int file_desc, const BPlusMeta *metadata, int key);
+
+/**
+ * @brief Counts the records whose key is in a range.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param low_key Smallest key of the range.
+ * @param high_key Largest key of the range (included; INT_MAX for no upper bound).
+ * @return The number of records with low_key <= key <= high_key (0 if low_key > high_key), or -1 on failure.
+ */
+int bplus_count_range(int file_desc, const BPlusMeta *metadata, int low_key, int high_key);
+
+/**
+ * @brief Gets the record at a position of the key order.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param position Position of the record, from 0 for the record with the smallest key (as an OFFSET).
+ * @param record Pointer to store a copy of the record.
+ * @return 1 if the record was found, 0 if position is not less than the number of records (or negative), -1 on
+ *         failure.
+ */
+int bplus_select(int file_desc, const BPlusMeta *metadata, int position, Record *record);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef BP_PARALLEL_H
+#define BP_PARALLEL_H
+
+#include "bplus_file_structs.h"
+#include "record.h"
+
+/* Parallel full scans: the key space is split into partitions at separator keys of the upper index levels, and the
+** range of the leaf chain of each partition is scanned by a worker thread, with its own cursor.
+** - The separators are those of the root, or those of the second level if the root has fewer children than the
+**   threads; the partitions get about the same number of children of that level each
+** - Each worker descends to the data block of the first key of its partition and follows the next_index links from
+**   there, until the first key of the next partition, so the workers read disjoint parts of the leaf chain and on a
+**   cold cache up to one page read per worker is in flight instead of one in total
+** - The workers read the blocks in the memory mapping of a file opened with bplus_open_file_mmap() or
+**   bplus_open_file_arena(), which needs no lock; the BF layer is not thread-safe, so on a file opened with
+**   bplus_open_file() the partitions are scanned one after the other by the calling thread instead (with the
+**   BPLUS_ACCESS_SCAN hint, see bplus_scan.h)
+** - BPLUS_PARALLEL_ORDERED: each worker passes the records of its partition through a ring of
+**   BPLUS_PARALLEL_BUFFER_RECORDS records, and waits while the ring is full; the calling thread calls the callback for
+**   them in ascending key order, draining partition p before p + 1, so a scan buffers at most that many records per
+**   thread, however large the table is (the workers of the later partitions read ahead until their rings are full)
+** - BPLUS_PARALLEL_UNORDERED: the records are streamed, as each worker calls the callback for the records of its
+**   partition (in ascending key order) from its own thread, so the callback must be safe to call concurrently for
+**   different partitions
+*/
+
+#define BPLUS_PARALLEL_MAX_THREADS 64
+#define BPLUS_PARALLEL_BUFFER_RECORDS 1024 // records buffered for each partition of an ordered scan by threads
+
+// modes of bplus_parallel_scan()
+#define BPLUS_PARALLEL_ORDERED 0 // all records in ascending key order, from the calling thread
+#define BPLUS_PARALLEL_UNORDERED 1 // the records of each partition from its worker thread, as they are read
+
+/**
+ * @brief Callback of a parallel scan, called once for each record of the tree.
+ * @param user_data The pointer given to bplus_parallel_scan().
+ * @param partition The partition of the record, from 0 to the number of threads - 1; the partitions are in ascending
+ *        key order, so a callback can keep separate state for each one instead of locking shared state.
+ * @param record The record; it is only valid during the call, so copy it if needed.
+ */
+typedef void (*BPlusScanCallback)(void *user_data, int partition, const Record *record);
+
+/**
+ * @brief Scans all records of a tree with worker threads, each over a partition of the key space.
+ * @param file_desc File descriptor of the B+ tree file (scanned by threads only if it is memory-mapped).
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param thread_count Number of partitions and worker threads (at most BPLUS_PARALLEL_MAX_THREADS); fewer are used
+ *        if the upper index levels have fewer children.
+ * @param mode BPLUS_PARALLEL_ORDERED or BPLUS_PARALLEL_UNORDERED.
+ * @param callback Function called for each record.
+ * @param user_data Pointer passed as is to callback.
+ * @return The number of records scanned, or -1 on failure (the callback may have been called for part of the records).
+ */
+int bplus_parallel_scan(int file_desc, const BPlusMeta *metadata, int thread_count, int mode,
+                        BPlusScanCallback callback, void *user_data);
+
+#endif
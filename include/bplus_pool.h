@@ -0,0 +1,79 @@
+#ifndef BP_POOL_H
+#define BP_POOL_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Per-file frame quotas over the shared BF buffer pool.
+** The BF_BUFFER_SIZE frames are shared by all open files and replaced in LRU order, so one file that reads many
+** blocks evicts the working set of every other file. The BF layer cannot be told which block to keep or evict, so
+** the quotas are enforced above it:
+** - The bplus layer keeps a mirror of the BF frames (the BF_BUFFER_SIZE most recently accessed blocks of all open
+**   files), from which it estimates how many frames each file holds; blocks that BF reads without the bplus layer
+**   knowing (e.g. during splits) make the estimate approximate
+** - A file's min quota protects its min_frames most recently accessed blocks: when one of them gets close to the
+**   LRU end of the pool, it is refreshed (pinned and unpinned again, a hit that moves it to the MRU end)
+** - A file's max quota marks its blocks past the max_frames most recently accessed ones as excess; while some file
+**   has excess blocks, the other blocks close to the LRU end are refreshed instead, so that excess blocks are the
+**   ones BF evicts next
+** - The size of the BF pool is compiled into the BF layer and cannot be changed; bplus_pool_set_frames() only sets
+**   the frame budget of the quotas, not the number of frames: the min quotas of all open files must fit in the
+**   budget, leaving BPLUS_POOL_PINNED_FRAMES frames for the blocks that an operation pins at once, and the blocks of
+**   a file without a max quota past the budget count as excess
+** - Blocks fetched with the BPLUS_ACCESS_SCAN hint are kept to a ring of BPLUS_POOL_SCAN_RING_SIZE frames the same
+**   way: scanned blocks past the BPLUS_POOL_SCAN_RING_SIZE most recent ones are excess, so a scan over many blocks
+**   recycles a few frames instead of flushing the hot blocks of all files; a scanned block that is then fetched
+**   normally stops counting as scanned
+** - The quotas are checked at the start of the operations (lookups, inserts), when the operation has no blocks
+**   pinned, every BPLUS_POOL_CHECK_INTERVAL block accesses; a refresh unpins the block (BF pins are not counted),
+**   so no check runs while a block stays pinned across user code, as in bplus_poll() callbacks
+*/
+
+#define BPLUS_POOL_PINNED_FRAMES 8 // frames never given to min quotas, for the blocks an operation pins at once
+#define BPLUS_POOL_CHECK_INTERVAL 16 // block accesses between two quota checks
+#define BPLUS_POOL_REFRESH_MARGIN 20 // evictable frames that a check leaves at the LRU end of the pool
+#define BPLUS_POOL_SCAN_RING_SIZE 8 // frames that the scanned blocks of all files may hold
+
+/**
+ * @brief Sets the frame budget that the frame quotas divide; can be changed while files are open. This does not
+ *        resize the BF pool, which always has BF_BUFFER_SIZE frames.
+ * @param frames Budget in frames, from 1 to BF_BUFFER_SIZE (BF_BUFFER_SIZE by default).
+ * @return 0 on success, -1 on failure (out of range, or the min quotas of the open files would not fit).
+ */
+int bplus_pool_set_frames(int frames);
+
+/**
+ * @brief Returns the frame budget that the frame quotas divide.
+ * @return Budget in frames.
+ */
+int bplus_pool_get_frames();
+
+/**
+ * @brief Sets the frame quota of an open B+ tree file.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param min_frames Frames of the file that are kept in the pool (0 for none).
+ * @param max_frames Frames the file may keep in the pool before its blocks are evicted first (0 for no limit).
+ * @return 0 on success, -1 on failure (file not open, max_frames < min_frames, or the min quotas would not fit).
+ */
+int bplus_set_frame_quota(int file_desc, int min_frames, int max_frames);
+
+/**
+ * @brief Returns how many BF frames hold blocks of an open B+ tree file, as estimated by the bplus layer.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @return Number of frames, -1 if the file is not open.
+ */
+int bplus_pool_resident_frames(int file_desc);
+
+// records an access of block_index of file_desc, with access_hint (see bplus_handle.h), in the mirror of the BF frames
+void bplus_pool_touch(int file_desc, int block_index, int access_hint);
+
+// enforces the frame quotas of the open files if a check is due; called at the start of an operation on file_desc
+void bplus_pool_check(int file_desc);
+
+// delta 1 suspends the quota checks while a block is pinned across user code, delta -1 resumes them
+void bplus_pool_hold(int delta);
+
+// forgets the blocks of file_desc, which BF dropped from its frames when the file was closed
+void bplus_pool_close(int file_desc);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef BP_SCAN_H
+#define BP_SCAN_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Range scans over the leaf chain: the scan descends once to the data block of its start key, then follows the
+** next_index links of the data blocks, returning the records in ascending key order.
+** - A data block is pinned only while its records are copied into the scan, so no block stays pinned between
+**   calls and the scan can be left open while other operations run on the file
+** - With the BPLUS_ACCESS_SCAN hint the data blocks are fetched as scanned blocks (see bplus_pool.h): they are
+**   kept to a small ring of BF frames, and are not saved as part of the working set (see bplus_warm.h), so a full
+**   scan leaves the hot blocks of the open files in the pool; BPLUS_ACCESS_NORMAL caches them like lookups do
+** - Records inserted into the file while a scan is open may or may not be returned by it
+*/
+
+typedef struct {
+    int file_desc;
+    const BPlusMeta *metadata;
+    int access_hint; // BPLUS_ACCESS_SCAN or BPLUS_ACCESS_NORMAL
+    int next_block_index; // next data block in the leaf chain, -1 after the last one
+    Record *records; // copies of the records of the current data block, in ascending key order
+    int record_count;
+    int position; // next record of records to return
+} BPlusScan;
+
+/**
+ * @brief Starts a scan of the records with key >= start_key, in ascending key order.
+ * @param scan Scan to start (caller owned; release it with bplus_scan_close()).
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree; must stay valid until the scan is closed.
+ * @param start_key Smallest key to return.
+ * @param access_hint BPLUS_ACCESS_SCAN (recommended for long scans) or BPLUS_ACCESS_NORMAL.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_scan_open(BPlusScan *scan, int file_desc, const BPlusMeta *metadata, int start_key, int access_hint);
+
+/**
+ * @brief Returns the next record of a scan.
+ * @param scan An open scan.
+ * @param record Pointer to store a copy of the record.
+ * @return 1 if a record was returned, 0 at the end of the scan, -1 on failure.
+ */
+int bplus_scan_next(BPlusScan *scan, Record *record);
+
+/**
+ * @brief Releases the resources of a scan.
+ * @param scan Scan started with bplus_scan_open().
+ */
+void bplus_scan_close(BPlusScan *scan);
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef BP_SECONDARY_H
+#define BP_SECONDARY_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+#include "bplus_key.h"
+#include "bplus_keyed.h"
+
+/* Secondary indexes: lookups of the records whose values of a list of non-key attributes (one attribute, or a
+** composite such as "surname,name") equal given values, or fall in a range of them, without a scan over all data
+** blocks.
+** - The index of an attribute list is a keyed file of its own (see bplus_keyed.h), <file name>.<attribute names>.idx,
+**   ordered by the normalized key of the attributes (see bplus_key.h); inserts into the tree add their primary keys to
+**   all indexes of the file
+** - A value has one entry, a record of the index file with the attributes of the value (with their names and types),
+**   then the postings of the value: _first_key, its first primary key, and _postings, its first postings block (-1 if
+**   the value has one record), as INT attributes; so an index has at most MAX_ATTRIBUTES - 2 attributes
+** - The other primary keys of a value are in its postings blocks, a chain of blocks of the index file:
+**   (START)[int][PostingsNodeHeader][varint][varint]...[varint][possibly unused space](END)
+**   - int is BLOCK_TYPE_POSTINGS
+**   - each varint is the difference of a primary key from the one before it (from _first_key for the first one of the
+**     chain), zigzag encoded, so that differences of either sign are short; a build by a scan adds the keys of each
+**     value in ascending order, so they mostly take 1 or 2 bytes each, with no key of the value repeated
+**   - the first block of a chain keeps its last block, which new postings are appended to
+** - A lookup (bplus_secondary_scan_open()) is a keyed lookup of the entry of the value, and a range lookup
+**   (bplus_secondary_range_open()) a keyed scan of the entries from the lowest value; each entry returns its
+**   postings, then those of its postings blocks
+** - The indexes are kept open with the tree and closed with it; bplus_create_secondary_index() must be called after
+**   each open, and reuses the index file if it is up to date, else it rebuilds it: the tree counts its inserts and
+**   updates in modification_count (see bplus_file_structs.h), and an index file stores the count it was last in sync
+**   with, so a change made while the index was closed is noticed even if the number of records stays the same
+*/
+
+#define BPLUS_SECONDARY_SUFFIX ".idx" // appended to "<file name>.<attribute names>" to get the index file name
+#define BLOCK_TYPE_POSTINGS 8 // after the dictionary block type (see bplus_dictionary.h)
+
+typedef struct {
+    int count; // primary keys in the block
+    int last_key; // the last of them, which the next one is stored as a difference from
+    int used; // bytes of their varints
+    int next_index; // next postings block of the value, -1 for the last one
+    int last_index; // last postings block of the value (kept in the first block of the chain only)
+} PostingsNodeHeader;
+
+struct bplus_secondary {
+    BPlusKeyFormat format; // indexed attributes, in the schema of the tree
+    char *file_name; // of the index file
+    int file_desc; // the index file
+    BPlusMeta *metadata;
+};
+
+typedef struct {
+    const struct bplus_secondary *secondary; // the index that is scanned
+    BPlusKeyedScan entries; // over the entries of the index file, from the lowest values of the scan
+    unsigned char high_key[BPLUS_KEY_MAX_LENGTH]; // normalized key of the highest values of the scan
+    int is_at_end; // whether no more entries are returned
+    unsigned char block[BF_BLOCK_SIZE]; // copy of the postings block whose postings are returned
+    int next_block; // next postings block of the entry, -1 if none
+    int position; // byte of the next posting in block
+    int remaining; // postings of block not returned yet
+    int last_key; // the primary key returned last
+} BPlusSecondaryScan;
+
+typedef struct {
+    int entry_count; // entries in the index tree
+    int block_count; // blocks of the index file
+} BPlusSecondaryStats;
+
+/**
+ * @brief Creates (or reopens) the secondary index of a list of attributes of an open B+ tree file, and keeps it up
+ *        to date on inserts until the file is closed.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_names Names of the attributes to index, separated by commas (e.g. "city" or "surname,name"); the key
+ *        attribute alone cannot be indexed.
+ * @return 0 on success, -1 on failure.
+ */
+int bplus_create_secondary_index(int file_desc, const BPlusMeta *metadata, const char *attr_names);
+
+/**
+ * @brief Starts a scan of the primary keys of the records whose attributes equal those of a probe record, using the
+ *        secondary index of the attributes.
+ * @param scan Scan to start (caller owned; release it with bplus_secondary_scan_close(), also if this fails).
+ * @param file_desc File descriptor of the B+ tree file; no record may be inserted into it while the scan is open.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_names Names of the attributes of an index, as given to bplus_create_secondary_index().
+ * @param probe Record whose attributes in attr_names hold the values to look for (the others are ignored).
+ * @return 0 on success, -1 on failure (e.g. no index).
+ */
+int bplus_secondary_scan_open(BPlusSecondaryScan *scan, int file_desc, const BPlusMeta *metadata,
+                              const char *attr_names, const Record *probe);
+
+/**
+ * @brief Starts a scan of the primary keys of the records whose attributes are between those of two probe records
+ *        (in the order of their normalized keys, see bplus_key.h), using the secondary index of the attributes.
+ * @param scan Scan to start (caller owned; release it with bplus_secondary_scan_close(), also if this fails).
+ * @param file_desc File descriptor of the B+ tree file; no record may be inserted into it while the scan is open.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_names Names of the attributes of an index, as given to bplus_create_secondary_index().
+ * @param low Record whose attributes in attr_names hold the lowest values to look for.
+ * @param high Record whose attributes in attr_names hold the highest values to look for (inclusive).
+ * @return 0 on success, -1 on failure (e.g. no index).
+ */
+int bplus_secondary_range_open(BPlusSecondaryScan *scan, int file_desc, const BPlusMeta *metadata,
+                               const char *attr_names, const Record *low, const Record *high);
+
+/**
+ * @brief Returns the next primary key of a scan; the values come in ascending order, and the keys of a value in no
+ *        particular order.
+ * @param scan An open scan.
+ * @param primary_key Pointer to store the primary key.
+ * @return 1 if a key was returned, 0 at the end of the scan, -1 on failure.
+ */
+int bplus_secondary_scan_next(BPlusSecondaryScan *scan, int *primary_key);
+
+/**
+ * @brief Releases the resources of a scan.
+ * @param scan Scan started with bplus_secondary_scan_open().
+ */
+void bplus_secondary_scan_close(BPlusSecondaryScan *scan);
+
+/**
+ * @brief Finds the primary keys of the records whose attributes equal those of a probe record, using the secondary
+ *        index of the attributes.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_names Names of the attributes of an index, as given to bplus_create_secondary_index().
+ * @param probe Record whose attributes in attr_names hold the values to look for (the others are ignored).
+ * @param primary_keys Buffer that gets up to max_keys primary keys, in no particular order.
+ * @param max_keys Size of the buffer (may be 0, to only count the records).
+ * @return Number of matching records (which can be more than max_keys), or -1 on failure (e.g. no index).
+ */
+int bplus_secondary_find(int file_desc, const BPlusMeta *metadata, const char *attr_names, const Record *probe,
+                         int *primary_keys, int max_keys);
+
+/**
+ * @brief Finds the records whose attributes equal those of a probe record, using the secondary index of the
+ *        attributes.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_names Names of the attributes of an index, as given to bplus_create_secondary_index().
+ * @param probe Record whose attributes in attr_names hold the values to look for (the others are ignored).
+ * @param records Buffer that gets copies of up to max_records records, in no particular order.
+ * @param max_records Size of the buffer.
+ * @return Number of matching records (which can be more than max_records), or -1 on failure.
+ */
+int bplus_secondary_find_records(int file_desc, const BPlusMeta *metadata, const char *attr_names,
+                                 const Record *probe, Record *records, int max_records);
+
+/**
+ * @brief Reports the size of the secondary index of a list of attributes.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @param attr_names Names of the attributes of an index, as given to bplus_create_secondary_index().
+ * @param stats Pointer to store the sizes.
+ * @return 0 on success, -1 on failure (e.g. no index).
+ */
+int bplus_secondary_stats(int file_desc, const BPlusMeta *metadata, const char *attr_names,
+                          BPlusSecondaryStats *stats);
+
+// adds the primary key of record, which was just inserted into the tree of handle, to all its secondary indexes; an
+// index that cannot take it is dropped (with its file), so that it is rebuilt instead of missing the record
+void bplus_secondary_add(BPlusHandle *handle, const BPlusMeta *metadata, const Record *record);
+
+// prints a postings block (requires pointer to block data)
+void postings_block_print(const char *block_start);
+
+// closes the secondary indexes of handle (if any)
+void bplus_secondary_close(BPlusHandle *handle);
+
+#endif
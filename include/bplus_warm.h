@@ -0,0 +1,55 @@
+#ifndef BP_WARM_H
+#define BP_WARM_H
+
+#include "bplus_file_structs.h"
+#include "bplus_handle.h"
+
+/* Warm restart: the working set of the BF frames of a file is saved when it is closed and can be read back in when
+** it is opened again, so that lookups do not start against an empty buffer pool.
+** - Tracking is off unless bplus_warm_enable() is called on the open file; files that never enable it do not pay for
+**   the tracking and leave no sidecar file behind
+** - The BF layer does not expose which blocks are in its frames, so the working set is tracked above it: every
+**   block that a lookup or an insert descends through is recorded, together with a clock of its last access, in a
+**   table of BPLUS_WARM_TABLE_SIZE slots; a block goes in slot block_index % BPLUS_WARM_TABLE_SIZE, replacing the
+**   block that was there, so an access costs one slot update
+** - On close the BPLUS_WARM_MAX_BLOCKS most recently accessed blocks of the table are written to a sidecar file,
+**   <file name>.warm, most recently accessed block first; a file that was not accessed leaves an existing sidecar
+**   untouched
+** - bplus_warm_preload() reads the sidecar, has the kernel read the blocks in ascending block order (adjacent
+**   blocks are merged into one larger read), then pins and unpins them from least to most recently accessed, so
+**   that the BF LRU order matches the saved one
+** - A stale sidecar is harmless: block indexes past the end of the file are skipped, the rest only cost a read
+*/
+
+#define BPLUS_WARM_MAX_BLOCKS BF_BUFFER_SIZE // blocks saved (and preloaded) per file; more would not fit the frames
+#define BPLUS_WARM_TABLE_SIZE 256 // slots of the tracking table, a power of 2 above BPLUS_WARM_MAX_BLOCKS
+#define BPLUS_WARM_SUFFIX ".warm" // appended to the file name to get the sidecar file name
+
+struct bplus_warm_entry {
+    int block_index; // -1 for an empty slot
+    long last_access; // value of the file's access clock at the last access of the block
+};
+
+/**
+ * @brief Starts tracking the working set of an open B+ tree file, which is then saved to its sidecar file on close.
+ * @param file_desc File descriptor of the B+ tree file.
+ * @return 0 on success, -1 on failure (e.g. the file is not open).
+ */
+int bplus_warm_enable(int file_desc);
+
+/**
+ * @brief Reads the saved working set of a B+ tree file into the BF frames; call it right after bplus_open_file().
+ * @param file_desc File descriptor of the B+ tree file.
+ * @param metadata Pointer to the BPlusMeta structure of the tree.
+ * @return Number of preloaded blocks (0 if there is no saved working set), -1 on failure.
+ */
+int bplus_warm_preload(int file_desc, const BPlusMeta *metadata);
+
+// records an access of block_index of file_desc in the working set of the file (nothing happens if it is not open,
+// or tracking is not enabled)
+void bplus_warm_touch(int file_desc, int block_index);
+
+// writes the working set of handle to its sidecar file (if tracking is enabled and any block was accessed) and frees it
+void bplus_warm_close(BPlusHandle *handle);
+
+#endif
@@ -15,7 +15,9 @@ typedef enum {
     TYPE_INT,   /**< Integer type */
     TYPE_CHAR,  /**< Fixed-length string type */
     TYPE_FLOAT, /**< Floating-point type */
-    TYPE_NULL   /**< Null/unused type */
+    TYPE_NULL,  /**< Null/unused type */
+    TYPE_LONG   /**< 64-bit integer type; as the key attribute, it makes a LONG key file
+                     (see bplus_keyed.h) */
 } DataType;
 
 /**
@@ -44,7 +46,11 @@ typedef struct {
 typedef union {
     int int_value;                               /**< Integer value */
     float float_value;                           /**< Float value */
+    long long long_value __attribute__((packed, aligned(4))); /**< 64-bit integer value (4-byte aligned, so that
+                                                                   FieldValue keeps its size) */
     char string_value[MAX_STRING_LENGTH];        /**< String value */
+    unsigned short code_value;                   /**< Dictionary code of a string value, as stored in the data
+                                                      blocks of a file with dictionaries (see bplus_dictionary.h) */
 } FieldValue;
 
 /**
@@ -76,7 +82,7 @@ void schema_print(const TableSchema *schema);
  * @brief Creates a record based on the schema.
  * @param schema Pointer to the table schema.
  * @param record Pointer to the record to initialize.
- * @param ... Field values for each attribute in schema order.
+ * @param ... Field values for each attribute in schema order (LONG values as long long).
  */
 void record_create(const TableSchema *schema, Record* record, ...);
 
@@ -0,0 +1,227 @@
+#include <limits.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_aggregate.h"
+
+#define CALL_BF(call)         \
+{                             \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+        BF_PrintError(code);  \
+        return -1;            \
+    }                         \
+}
+
+int bplus_aggregate_attribute(const BPlusMeta *metadata)
+{
+    if (memcmp(metadata->magic_num, BF_MAGIC_NUM_AGGREGATED, sizeof(BF_MAGIC_NUM_AGGREGATED)) != 0)
+        return -1;
+    return metadata->aggregate_attribute;
+}
+
+void bplus_aggregate_init(BPlusAggregate *aggregate)
+{
+    memset(aggregate, 0, sizeof(BPlusAggregate));
+}
+
+void bplus_aggregate_add_record(BPlusAggregate *aggregate, const TableSchema *schema, int attribute,
+                                const Record *record)
+{
+    BPlusAggregate single;
+    bplus_aggregate_init(&single);
+    single.count = 1;
+    if (attribute == -1) {
+        bplus_aggregate_merge(aggregate, &single, TYPE_INT);
+        return;
+    }
+
+    DataType type = schema->attributes[attribute].type;
+    const FieldValue *value = &(record->values[attribute]);
+    if (type == TYPE_FLOAT)
+        single.min.float_value = value->float_value;
+    else if (type == TYPE_LONG)
+        single.min.long_value = value->long_value;
+    else
+        single.min.long_value = value->int_value;
+    single.max = single.min;
+    single.sum = single.min;
+    bplus_aggregate_merge(aggregate, &single, type);
+}
+
+void bplus_aggregate_merge(BPlusAggregate *aggregate, const BPlusAggregate *from, DataType type)
+{
+    if (from->count == 0)
+        return;
+    if (aggregate->count == 0) {
+        *aggregate = *from;
+        return;
+    }
+
+    aggregate->count += from->count;
+    if (type == TYPE_FLOAT) {
+        if (from->min.float_value < aggregate->min.float_value)
+            aggregate->min.float_value = from->min.float_value;
+        if (from->max.float_value > aggregate->max.float_value)
+            aggregate->max.float_value = from->max.float_value;
+        aggregate->sum.float_value += from->sum.float_value;
+    }
+    else {
+        if (from->min.long_value < aggregate->min.long_value)
+            aggregate->min.long_value = from->min.long_value;
+        if (from->max.long_value > aggregate->max.long_value)
+            aggregate->max.long_value = from->max.long_value;
+        aggregate->sum.long_value += from->sum.long_value;
+    }
+}
+
+void bplus_aggregate_data_block(const char *block_start, const BPlusMeta *metadata, int attribute,
+                                long long low_key, long long high_key, BPlusAggregate *aggregate)
+{
+    DataNodeHeader header;
+    int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+    data_block_copy_header(block_start, &header);
+    data_block_copy_index_array(block_start, metadata, index_array);
+
+    bplus_aggregate_init(aggregate);
+    Record record;
+    for (int i = 0; i < header.record_count; i++) {
+        if (data_block_copy_record(block_start, &header, index_array, metadata, i, &record) == -1)
+            break;
+
+        int key = record_get_key(&(metadata->schema), &record);
+        if (key > high_key)
+            break;
+        if (key >= low_key)
+            bplus_aggregate_add_record(aggregate, &(metadata->schema), attribute, &record);
+    }
+}
+
+// gets the block with block_index, pinned in block, or read in the mapping if the file of handle is memory-mapped
+// returns 0 on success, -1 otherwise
+static int get_block(const BPlusHandle *handle, int file_desc, int block_index, BF_Block *block,
+                     const char **block_start)
+{
+    if (bplus_mmap_is_mapped(handle)) {
+        *block_start = bplus_mmap_block(handle, block_index);
+        return *block_start ? 0 : -1;
+    }
+
+    CALL_BF(BF_GetBlock(file_desc, block_index, block));
+    *block_start = BF_Block_GetData(block);
+    bplus_handle_touch(file_desc, block_index, BPLUS_ACCESS_NORMAL);
+    return 0;
+}
+
+// unpins a block got with get_block() (mapped blocks are not pinned)
+static void release_block(const BPlusHandle *handle, BF_Block *block)
+{
+    if (!bplus_mmap_is_mapped(handle))
+        BF_UnpinBlock(block);
+}
+
+// adds to aggregate the records with keys in [low_key, high_key] under the block with block_index, whose keys are in
+// [block_low_key, block_high_key]; the kept aggregate of a child is taken whole if all its keys are in the range
+// returns 0 on success, -1 otherwise
+static int aggregate_subtree(const BPlusHandle *handle, int file_desc, const BPlusMeta *metadata, int block_index,
+                             long long block_low_key, long long block_high_key, int low_key, int high_key,
+                             BPlusAggregate *aggregate)
+{
+    int attribute = metadata->aggregate_attribute;
+    DataType type = metadata->schema.attributes[attribute].type;
+
+    BF_Block *block;
+    BF_Block_Init(&block);
+    const char *block_start;
+    if (get_block(handle, file_desc, block_index, block, &block_start) == -1) {
+        BF_Block_Destroy(&block);
+        return -1;
+    }
+
+    if (is_data_block(block_start)) {
+        BPlusAggregate block_aggregate;
+        bplus_aggregate_data_block(block_start, metadata, attribute, low_key, high_key, &block_aggregate);
+        bplus_aggregate_merge(aggregate, &block_aggregate, type);
+
+        release_block(handle, block);
+        BF_Block_Destroy(&block);
+        return 0;
+    }
+
+    // the entries are copied, so that the block is not pinned while its children are visited
+    IndexNodeHeader header;
+    IndexNodeEntry entry_array[BF_BLOCK_SIZE / sizeof(int)]; // more than any index block's indexes
+    index_block_copy_header(block_start, &header);
+    index_block_read_entries_as_array(block_start, &header, entry_array);
+    release_block(handle, block);
+    BF_Block_Destroy(&block);
+
+    for (int i = 0; i < header.index_count; i++) {
+        // the keys under child i are from its entry key (the block's lower bound for the leftmost one) to just
+        // before the next entry key
+        long long child_low_key = (i == 0) ? block_low_key : entry_array[i].key;
+        long long child_high_key = (i == header.index_count - 1) ? block_high_key : entry_array[i + 1].key - 1LL;
+        if (child_high_key < low_key || child_low_key > high_key)
+            continue;
+
+        if (child_low_key >= low_key && child_high_key <= high_key) {
+            bplus_aggregate_merge(aggregate, &(entry_array[i].aggregate), type);
+            continue;
+        }
+
+        if (aggregate_subtree(handle, file_desc, metadata, entry_array[i].right_index, child_low_key, child_high_key,
+                              low_key, high_key, aggregate) == -1)
+            return -1;
+    }
+
+    return 0;
+}
+
+// adds to aggregate the values of attribute of the records with keys in [low_key, high_key], by a scan (for the
+// attributes that the file keeps no aggregates of)
+// returns 0 on success, -1 otherwise
+static int scan_aggregate(int file_desc, const BPlusMeta *metadata, int attribute, int low_key, int high_key,
+                          BPlusAggregate *aggregate)
+{
+    BPlusScan scan;
+    if (bplus_scan_open(&scan, file_desc, metadata, low_key, BPLUS_ACCESS_SCAN) == -1) {
+        bplus_scan_close(&scan);
+        return -1;
+    }
+
+    int result;
+    Record record;
+    while ((result = bplus_scan_next(&scan, &record)) == 1 && record_get_key(&(metadata->schema), &record) <= high_key)
+        bplus_aggregate_add_record(aggregate, &(metadata->schema), attribute, &record);
+    bplus_scan_close(&scan);
+    return (result == -1) ? -1 : 0;
+}
+
+int bplus_aggregate_range(int file_desc, const BPlusMeta *metadata, const char *attr_name, int low_key, int high_key,
+                          BPlusAggregate *aggregate)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || bplus_file_is_keyed(metadata))
+        return -1;
+
+    int attribute = -1;
+    for (int i = 0; i < metadata->schema.count; i++) {
+        if (strcmp(metadata->schema.attributes[i].name, attr_name) == 0)
+            attribute = i;
+    }
+    if (attribute == -1)
+        return -1;
+
+    DataType type = metadata->schema.attributes[attribute].type;
+    if (type != TYPE_INT && type != TYPE_LONG && type != TYPE_FLOAT)
+        return -1;
+
+    bplus_aggregate_init(aggregate);
+    if (metadata->root_index == -1 || low_key > high_key)
+        return 0;
+
+    if (attribute != bplus_aggregate_attribute(metadata))
+        return scan_aggregate(file_desc, metadata, attribute, low_key, high_key, aggregate);
+
+    return aggregate_subtree(handle, file_desc, metadata, metadata->root_index, INT_MIN, INT_MAX, low_key, high_key,
+                             aggregate);
+}
@@ -0,0 +1,39 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/bplus_arena.h"
+
+int bplus_arena_init(BPlusArena *arena, size_t capacity)
+{
+    arena->base = malloc(capacity);
+    arena->capacity = arena->base ? capacity : 0;
+    arena->used = 0;
+    return arena->base ? 0 : -1;
+}
+
+size_t bplus_arena_space(size_t size)
+{
+    return (size + BPLUS_ARENA_ALIGNMENT - 1) / BPLUS_ARENA_ALIGNMENT * BPLUS_ARENA_ALIGNMENT;
+}
+
+void *bplus_arena_alloc(BPlusArena *arena, size_t size)
+{
+    size_t space = bplus_arena_space(size);
+    if (!arena->base || space > arena->capacity - arena->used)
+        return NULL;
+
+    void *result = arena->base + arena->used; // malloc() memory is aligned for any type, so every piece is too
+    arena->used += space;
+    return result;
+}
+
+void bplus_arena_reset(BPlusArena *arena)
+{
+    arena->used = 0;
+}
+
+void bplus_arena_free(BPlusArena *arena)
+{
+    free(arena->base);
+    memset(arena, 0, sizeof(BPlusArena));
+}
@@ -0,0 +1,184 @@
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_async.h"
+
+// orders requests by key, then by submission order
+static int compare_async_requests(const void *a, const void *b)
+{
+    const struct bplus_async_request *request_a = a;
+    const struct bplus_async_request *request_b = b;
+
+    if (request_a->key != request_b->key)
+        return (request_a->key < request_b->key) ? -1 : 1;
+
+    return (request_a->sequence < request_b->sequence) ? -1 : (request_a->sequence > request_b->sequence);
+}
+
+int bplus_record_find_async(const int file_desc, const BPlusMeta *metadata, const int key,
+                            BPlusFindCallback callback, void *user_data)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || !callback || bplus_file_is_keyed(metadata))
+        return -1;
+
+    // growing the queue if it is full
+    if (handle->async_count == handle->async_capacity) {
+        int new_capacity = (handle->async_capacity == 0) ? BPLUS_ASYNC_INITIAL_CAPACITY : 2 * handle->async_capacity;
+        struct bplus_async_request *new_queue = realloc(handle->async_queue, new_capacity * sizeof(struct bplus_async_request));
+        if (!new_queue)
+            return -1;
+
+        handle->async_queue = new_queue;
+        handle->async_capacity = new_capacity;
+    }
+
+    struct bplus_async_request *request = &(handle->async_queue[handle->async_count]);
+    request->key = key;
+    request->sequence = handle->async_sequence++;
+    request->metadata = metadata;
+    request->callback = callback;
+    request->user_data = user_data;
+
+    handle->async_count++;
+    return 0;
+}
+
+int bplus_pending_count(const int file_desc)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+
+    return handle->async_count;
+}
+
+int bplus_poll(const int file_desc, const int max_completions)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+
+    int batch_count = handle->async_count;
+    if (max_completions > 0 && max_completions < batch_count)
+        batch_count = max_completions;
+
+    if (batch_count == 0)
+        return 0;
+
+    bplus_io_account(file_desc, batch_count);
+    bplus_pool_check(file_desc);
+
+    // taking the oldest batch_count requests out of the queue before any callback runs,
+    // so that callbacks can safely submit new lookups
+    struct bplus_async_request *batch = malloc(batch_count * sizeof(struct bplus_async_request));
+    if (!batch)
+        return -1;
+
+    memcpy(batch, handle->async_queue, batch_count * sizeof(struct bplus_async_request));
+    memmove(handle->async_queue, &(handle->async_queue[batch_count]),
+            (handle->async_count - batch_count) * sizeof(struct bplus_async_request));
+    handle->async_count -= batch_count;
+
+    // serving the batch in key order, so that consecutive lookups that fall in the same data block share it
+    qsort(batch, batch_count, sizeof(struct bplus_async_request), compare_async_requests);
+
+    // a memory-mapped file is searched directly in the mapping
+    if (bplus_mmap_is_mapped(handle)) {
+        for (int i = 0; i < batch_count; i++) {
+            Record record;
+            int is_found = bplus_mmap_find(handle, batch[i].metadata, batch[i].key, &record);
+            batch[i].callback(batch[i].user_data, batch[i].key, is_found ? &record : NULL);
+        }
+        free(batch);
+        return batch_count;
+    }
+
+    BF_Block *leaf_block;
+    BF_Block_Init(&leaf_block);
+    bplus_pool_hold(1); // the data block stays pinned while the callbacks run
+
+    int leaf_is_pinned = 0;
+    char *leaf_start = NULL;
+    DataNodeHeader *leaf_header = NULL;
+    int *leaf_index_array = NULL;
+    int leaf_last_key = 0;
+    int result = batch_count;
+
+    for (int i = 0; i < batch_count; i++) {
+        const struct bplus_async_request *request = &batch[i];
+        const BPlusMeta *metadata = request->metadata;
+
+        // the pinned data block can serve the key only if the key is in its key range; else a new descent is needed
+        int leaf_can_serve = leaf_is_pinned && request->key >= leaf_header->min_record_key && request->key <= leaf_last_key;
+
+        if (!leaf_can_serve && result != -1) {
+            // releasing the previous data block, as no remaining (larger) key can be in it
+            if (leaf_is_pinned) {
+                BF_UnpinBlock(leaf_block);
+                free(leaf_header);
+                free(leaf_index_array);
+                leaf_header = NULL;
+                leaf_index_array = NULL;
+                leaf_is_pinned = 0;
+            }
+
+            if (metadata->root_index == -1) { // empty tree, nothing can be found
+                request->callback(request->user_data, request->key, NULL);
+                continue;
+            }
+
+            int leaf_index;
+            if (tree_search_data_block(metadata->root_index, request->key, file_desc, leaf_block, &leaf_index) == -1) {
+                result = -1;
+            }
+            else {
+                leaf_is_pinned = 1;
+                leaf_start = BF_Block_GetData(leaf_block);
+                leaf_header = data_block_read_header(leaf_start);
+                leaf_index_array = data_block_read_index_array(leaf_start, metadata);
+                if (!leaf_header || !leaf_index_array) {
+                    BF_UnpinBlock(leaf_block);
+                    leaf_is_pinned = 0;
+                    result = -1;
+                }
+                else {
+                    // the largest key of the block bounds the keys it can serve
+                    Record *last_record = data_block_read_record(leaf_start, leaf_header, leaf_index_array,
+                                                                 metadata, leaf_header->record_count - 1);
+                    leaf_last_key = last_record ? record_get_key(&(metadata->schema), last_record) : leaf_header->min_record_key;
+                    free(last_record);
+                }
+            }
+        }
+
+        // after a failure, the rest of the batch completes as not found
+        if (!leaf_is_pinned || result == -1) {
+            request->callback(request->user_data, request->key, NULL);
+            continue;
+        }
+
+        int position = data_block_key_search(leaf_start, leaf_header, leaf_index_array, metadata, request->key);
+        if (position < 0) {
+            request->callback(request->user_data, request->key, NULL);
+            continue;
+        }
+
+        // the record is a copy, so the callback never sees block memory
+        Record *record = data_block_read_record(leaf_start, leaf_header, leaf_index_array, metadata, position);
+        if (record)
+            bplus_dictionary_decode(handle, metadata, record);
+        request->callback(request->user_data, request->key, record);
+        free(record);
+    }
+
+    // the last completion that needed the data block has been delivered
+    if (leaf_is_pinned)
+        BF_UnpinBlock(leaf_block);
+
+    BF_Block_Destroy(&leaf_block);
+    bplus_pool_hold(-1);
+    free(leaf_header);
+    free(leaf_index_array);
+    free(batch);
+
+    return result;
+}
@@ -0,0 +1,129 @@
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_batch.h"
+
+// one lookup of the group
+struct lookup_state {
+    int position; // position of the lookup's key in the batch
+    int block_index; // index of the block to visit next
+    char *block_start; // data of that block, while it is pinned
+};
+
+// asks the CPU to start loading every cache line of a block, without waiting for it
+static void prefetch_block(const char *block_start)
+{
+    for (int offset = 0; offset < BF_BLOCK_SIZE; offset += BPLUS_CACHE_LINE_SIZE)
+        __builtin_prefetch(block_start + offset, 0, 3);
+}
+
+int bplus_record_find_batch(const int file_desc, const BPlusMeta *metadata, const int *keys, const int key_count,
+                            int group_size, Record *out_records, int *found)
+{
+    if (bplus_file_is_keyed(metadata))
+        return -1;
+    if (group_size <= 0)
+        group_size = BPLUS_BATCH_DEFAULT_GROUP_SIZE;
+    if (group_size > BPLUS_BATCH_MAX_GROUP_SIZE)
+        group_size = BPLUS_BATCH_MAX_GROUP_SIZE;
+
+    for (int i = 0; i < key_count; i++)
+        found[i] = 0;
+
+    bplus_io_account(file_desc, key_count);
+    bplus_pool_check(file_desc);
+
+    if (metadata->root_index == -1) // empty tree
+        return 0;
+
+    // a memory-mapped file has no block reads to overlap, so its lookups run one after the other
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (bplus_mmap_is_mapped(handle)) {
+        int found_count = 0;
+        for (int i = 0; i < key_count; i++) {
+            found[i] = bplus_mmap_find(handle, metadata, keys[i], &out_records[i]);
+            found_count += found[i];
+        }
+        return found_count;
+    }
+
+    // each group slot has its own block handle
+    BF_Block *blocks[BPLUS_BATCH_MAX_GROUP_SIZE];
+    for (int j = 0; j < group_size; j++)
+        BF_Block_Init(&blocks[j]);
+
+    struct lookup_state group[BPLUS_BATCH_MAX_GROUP_SIZE];
+    int active_count = 0;
+    int next_position = 0;
+    int found_count = 0;
+    int result = 0;
+
+    int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+    DataNodeHeader data_header;
+
+    while (active_count > 0 || next_position < key_count) {
+        // filling the free slots of the group with the next keys, which start from the root
+        while (active_count < group_size && next_position < key_count) {
+            group[active_count].position = next_position++;
+            group[active_count].block_index = metadata->root_index;
+            active_count++;
+        }
+
+        // first pass: pinning and prefetching the next block of every lookup, before searching any of them
+        for (int j = 0; j < active_count; j++) {
+            BF_ErrorCode code = BF_GetBlock(file_desc, group[j].block_index, blocks[j]);
+            if (code != BF_OK) {
+                BF_PrintError(code);
+                for (int k = 0; k < j; k++)
+                    BF_UnpinBlock(blocks[k]);
+                result = -1;
+                break;
+            }
+
+            group[j].block_start = BF_Block_GetData(blocks[j]);
+            prefetch_block(group[j].block_start);
+            bplus_handle_touch(file_desc, group[j].block_index, BPLUS_ACCESS_NORMAL);
+        }
+        if (result == -1)
+            break;
+
+        // second pass: moving every lookup one level down; no block is fetched during this pass, and each lookup
+        // keeps its own pin on its block until it unpins it below, so a block that two lookups share stays pinned
+        // until both are done with it
+        for (int j = 0; j < active_count; j++) {
+            const char *block_start = group[j].block_start;
+            int key = keys[group[j].position];
+
+            if (is_data_block(block_start)) {
+                data_block_copy_header(block_start, &data_header);
+                data_block_copy_index_array(block_start, metadata, index_array);
+
+                int position = data_block_key_search(block_start, &data_header, index_array, metadata, key);
+                if (position >= 0) {
+                    data_block_copy_record(block_start, &data_header, index_array, metadata, position,
+                                           &out_records[group[j].position]);
+                    bplus_dictionary_decode(handle, metadata, &out_records[group[j].position]);
+                    found[group[j].position] = 1;
+                    found_count++;
+                }
+                group[j].block_index = -1; // the lookup is finished
+            }
+            else {
+                group[j].block_index = index_block_find_child(block_start, key);
+            }
+
+            BF_UnpinBlock(blocks[j]);
+        }
+
+        // removing the finished lookups from the group, keeping the rest at the start of it
+        int kept_count = 0;
+        for (int j = 0; j < active_count; j++) {
+            if (group[j].block_index != -1)
+                group[kept_count++] = group[j];
+        }
+        active_count = kept_count;
+    }
+
+    for (int j = 0; j < group_size; j++)
+        BF_Block_Destroy(&blocks[j]);
+
+    return (result == -1) ? -1 : found_count;
+}
@@ -0,0 +1,300 @@
+#include <limits.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_bloom.h"
+
+static const char BLOOM_MAGIC_NUM[4] = { 'B', 'P', 'B', 'F' }; // this identifies a sidecar file
+
+#define LINE_WORDS (BPLUS_BLOOM_LINE_BITS / 64) // 64-bit words of a line
+
+// returns the sidecar file name of file_name (caller frees), or NULL if unsuccessful
+static char *bloom_file_name(const char *file_name)
+{
+    char *name = malloc(strlen(file_name) + sizeof(BPLUS_BLOOM_SUFFIX));
+    if (!name)
+        return NULL;
+
+    strcpy(name, file_name);
+    strcat(name, BPLUS_BLOOM_SUFFIX);
+    return name;
+}
+
+// returns a 64-bit hash of key (the splitmix64 finalizer), whose bits all depend on all bits of key
+static uint64_t hash_key(uint64_t key)
+{
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+// gets the bits per key and the number of hashes that give false_positive_rate
+// with the best number of hashes, each bit per key multiplies the rate by about 0.6185 (and there are about
+// 0.69 hashes per bit); computed by repeated multiplication, so that no math library is needed
+static void bloom_parameters(double false_positive_rate, int *bits_per_key, int *hash_count)
+{
+    int bits = 1;
+    double rate = 0.6185;
+    while (rate > false_positive_rate && bits < BPLUS_BLOOM_MAX_HASHES * 3 / 2) {
+        rate *= 0.6185;
+        bits++;
+    }
+
+    *bits_per_key = bits;
+    *hash_count = (bits * 69 + 50) / 100;
+    if (*hash_count < 1)
+        *hash_count = 1;
+    if (*hash_count > BPLUS_BLOOM_MAX_HASHES)
+        *hash_count = BPLUS_BLOOM_MAX_HASHES;
+}
+
+// returns the number of lines of a filter of capacity keys with bits_per_key bits per key
+static int bloom_line_count(int capacity, int bits_per_key)
+{
+    long bits = (long)capacity * bits_per_key;
+    return (int)((bits + BPLUS_BLOOM_LINE_BITS - 1) / BPLUS_BLOOM_LINE_BITS);
+}
+
+// returns a new empty filter for capacity keys, or NULL if unsuccessful
+static struct bplus_bloom *bloom_new(int capacity, int bits_per_key, int hash_count)
+{
+    struct bplus_bloom *bloom = calloc(1, sizeof(struct bplus_bloom));
+    if (!bloom)
+        return NULL;
+
+    bloom->capacity = capacity;
+    bloom->bits_per_key = bits_per_key;
+    bloom->hash_count = hash_count;
+    bloom->line_count = bloom_line_count(capacity, bits_per_key);
+    bloom->bits = calloc((size_t)bloom->line_count * LINE_WORDS, sizeof(uint64_t));
+    if (!(bloom->bits)) {
+        free(bloom);
+        return NULL;
+    }
+
+    return bloom;
+}
+
+static void bloom_free(struct bplus_bloom *bloom)
+{
+    if (!bloom)
+        return;
+
+    free(bloom->bits);
+    free(bloom);
+}
+
+// sets (set_bits 1) or tests (set_bits 0) the bits of key in bloom
+// returns 1 if all bits of key were set before the call, 0 otherwise
+static int bloom_probe(struct bplus_bloom *bloom, int key, int set_bits)
+{
+    uint64_t hash = hash_key((uint32_t)key);
+
+    // the high half picks the line, the low half and a second hash of it give the bit positions in the line
+    uint64_t *line = bloom->bits + ((hash >> 32) * (uint64_t)bloom->line_count >> 32) * LINE_WORDS;
+    uint32_t position = (uint32_t)hash;
+    uint32_t step = (uint32_t)hash_key(hash) | 1;
+
+    int all_set = 1;
+    for (int i = 0; i < bloom->hash_count; i++, position += step) {
+        uint32_t bit = position % BPLUS_BLOOM_LINE_BITS;
+        uint64_t mask = 1ULL << (bit % 64);
+
+        if (!(line[bit / 64] & mask)) {
+            all_set = 0;
+            if (!set_bits)
+                return 0;
+            line[bit / 64] |= mask;
+        }
+    }
+
+    return all_set;
+}
+
+// adds the keys of all records of the tree to bloom, by a scan over the leaf chain
+// returns 0 on success, -1 if unsuccessful
+static int bloom_fill(int file_desc, const BPlusMeta *metadata, struct bplus_bloom *bloom)
+{
+    BPlusScan scan;
+    if (bplus_scan_open(&scan, file_desc, metadata, INT_MIN, BPLUS_ACCESS_SCAN) == -1)
+        return -1;
+
+    Record record;
+    int result;
+    while ((result = bplus_scan_next(&scan, &record)) == 1)
+        bloom_probe(bloom, record_get_key(&(metadata->schema), &record), 1);
+
+    bplus_scan_close(&scan);
+    return result;
+}
+
+// sidecar layout:
+/* [char magic_num[4]][int capacity][int bits_per_key][int hash_count][int record_count][int block_count]
+** [uint64_t bits[line_count * LINE_WORDS]]
+*/
+// reads the sidecar file of file_name, if it holds a filter with the given parameters for the tree of metadata
+// returns the filter, or NULL if there is no matching sidecar file
+static struct bplus_bloom *read_bloom_file(const char *file_name, const BPlusMeta *metadata, int bits_per_key,
+                                           int hash_count)
+{
+    char *name = bloom_file_name(file_name);
+    if (!name)
+        return NULL;
+
+    FILE *file = fopen(name, "rb");
+    free(name);
+    if (!file)
+        return NULL;
+
+    char magic_num[4];
+    int header[5]; // capacity, bits_per_key, hash_count, record_count, block_count
+    if (fread(magic_num, sizeof(magic_num), 1, file) != 1 ||
+        memcmp(magic_num, BLOOM_MAGIC_NUM, sizeof(BLOOM_MAGIC_NUM)) != 0 ||
+        fread(header, sizeof(header), 1, file) != 1 ||
+        header[0] < metadata->record_count || header[1] != bits_per_key || header[2] != hash_count ||
+        header[3] != metadata->record_count || header[4] != metadata->block_count) {
+        fclose(file);
+        return NULL;
+    }
+
+    struct bplus_bloom *bloom = bloom_new(header[0], bits_per_key, hash_count);
+    if (!bloom || fread(bloom->bits, sizeof(uint64_t) * LINE_WORDS, bloom->line_count, file) != (size_t)bloom->line_count) {
+        bloom_free(bloom);
+        fclose(file);
+        return NULL;
+    }
+
+    bloom->record_count = header[3];
+    bloom->block_count = header[4];
+
+    fclose(file);
+    return bloom;
+}
+
+// builds a filter of the tree of metadata for capacity keys (at least twice the keys of the tree) by a scan
+// returns the filter, or NULL if unsuccessful
+static struct bplus_bloom *bloom_build(int file_desc, const BPlusMeta *metadata, int capacity, int bits_per_key,
+                                       int hash_count)
+{
+    if (capacity < 2 * metadata->record_count)
+        capacity = 2 * metadata->record_count;
+    if (capacity < BPLUS_BLOOM_MIN_KEYS)
+        capacity = BPLUS_BLOOM_MIN_KEYS;
+
+    struct bplus_bloom *bloom = bloom_new(capacity, bits_per_key, hash_count);
+    if (!bloom)
+        return NULL;
+
+    if (bloom_fill(file_desc, metadata, bloom) == -1) {
+        bloom_free(bloom);
+        return NULL;
+    }
+
+    bloom->record_count = metadata->record_count;
+    bloom->block_count = metadata->block_count;
+    bloom->is_dirty = 1;
+    return bloom;
+}
+
+int bplus_bloom_enable(int file_desc, const BPlusMeta *metadata, double false_positive_rate)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || false_positive_rate <= 0 || false_positive_rate >= 1 || bplus_file_is_keyed(metadata))
+        return -1;
+
+    int bits_per_key, hash_count;
+    bloom_parameters(false_positive_rate, &bits_per_key, &hash_count);
+
+    // an enabled filter with the same parameters is kept (with its counters)
+    if (handle->bloom && handle->bloom->bits_per_key == bits_per_key && handle->bloom->hash_count == hash_count)
+        return 0;
+
+    struct bplus_bloom *bloom = read_bloom_file(handle->file_name, metadata, bits_per_key, hash_count);
+    if (!bloom)
+        bloom = bloom_build(file_desc, metadata, 0, bits_per_key, hash_count);
+    if (!bloom)
+        return -1;
+
+    bloom_free(handle->bloom);
+    handle->bloom = bloom;
+    return 0;
+}
+
+int bplus_bloom_stats(int file_desc, BPlusBloomStats *stats)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !(handle->bloom))
+        return -1;
+
+    *stats = handle->bloom->stats;
+    return 0;
+}
+
+int bplus_bloom_may_contain(BPlusHandle *handle, int key)
+{
+    struct bplus_bloom *bloom = handle->bloom;
+    if (!bloom)
+        return 1;
+
+    bloom->stats.lookups++;
+    if (bloom_probe(bloom, key, 0))
+        return 1;
+
+    bloom->stats.negatives++;
+    return 0;
+}
+
+void bplus_bloom_count_false_positive(BPlusHandle *handle)
+{
+    if (handle->bloom)
+        handle->bloom->stats.false_positives++;
+}
+
+void bplus_bloom_add(int file_desc, const BPlusMeta *metadata, int key)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !(handle->bloom))
+        return;
+
+    struct bplus_bloom *bloom = handle->bloom;
+    bloom_probe(bloom, key, 1);
+    bloom->record_count = metadata->record_count;
+    bloom->block_count = metadata->block_count;
+    bloom->is_dirty = 1;
+
+    if (bloom->record_count <= bloom->capacity)
+        return;
+
+    // the tree outgrew the filter, so its false positive rate is no longer the requested one
+    struct bplus_bloom *larger = bloom_build(file_desc, metadata, 2 * bloom->capacity, bloom->bits_per_key,
+                                             bloom->hash_count);
+    if (!larger)
+        return; // the old filter still has all keys, only with more false positives
+
+    larger->stats = bloom->stats;
+    bloom_free(bloom);
+    handle->bloom = larger;
+}
+
+void bplus_bloom_close(BPlusHandle *handle)
+{
+    struct bplus_bloom *bloom = handle->bloom;
+    if (!bloom)
+        return;
+
+    char *name = bloom->is_dirty ? bloom_file_name(handle->file_name) : NULL;
+    if (name) {
+        FILE *file = fopen(name, "wb");
+        if (file) {
+            int header[5] = { bloom->capacity, bloom->bits_per_key, bloom->hash_count, bloom->record_count,
+                              bloom->block_count };
+            fwrite(BLOOM_MAGIC_NUM, sizeof(BLOOM_MAGIC_NUM), 1, file);
+            fwrite(header, sizeof(header), 1, file);
+            fwrite(bloom->bits, sizeof(uint64_t) * LINE_WORDS, bloom->line_count, file);
+            fclose(file);
+        }
+    }
+
+    free(name);
+    bloom_free(bloom);
+    handle->bloom = NULL;
+}
@@ -0,0 +1,184 @@
+#include <stdint.h>
+
+#include "../include/bplus_cache.h"
+
+// returns the position of key in a hash table of table_size entries (a power of 2)
+static int table_position(int key, int table_size)
+{
+    uint32_t hash = (uint32_t)key * 0x9e3779b1u; // Fibonacci hashing, the high bits are the best mixed
+    return (int)(hash >> 7) & (table_size - 1);
+}
+
+// returns the table position that holds the slot of key, or -1 if key is not cached
+static int find_position(const struct bplus_cache *cache, int key)
+{
+    int position = table_position(key, cache->table_size);
+    while (cache->table[position] != -1) {
+        if (cache->slots[cache->table[position]].key == key)
+            return position;
+        position = (position + 1) & (cache->table_size - 1);
+    }
+
+    return -1;
+}
+
+// empties the table entry at position; the entries after it in its probe run are moved back into the gap
+// (backward shift deletion), so that linear probing needs no tombstones
+static void remove_position(struct bplus_cache *cache, int position)
+{
+    int mask = cache->table_size - 1;
+    int gap = position;
+    int next = (gap + 1) & mask;
+
+    while (cache->table[next] != -1) {
+        int home = table_position(cache->slots[cache->table[next]].key, cache->table_size);
+
+        // the entry can fill the gap only if the gap lies between its home position and its current one
+        if (((next - home) & mask) >= ((next - gap) & mask)) {
+            cache->table[gap] = cache->table[next];
+            gap = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    cache->table[gap] = -1;
+}
+
+// returns a slot for a new record: a free one, or the one that the clock hand takes (evicting its record, if any)
+static int take_slot(struct bplus_cache *cache)
+{
+    if (cache->used_count < cache->slot_count)
+        return (cache->used_count)++;
+
+    // referenced slots get a second chance; after at most one full turn, an unreferenced slot is found
+    while (cache->slots[cache->hand].is_referenced) {
+        cache->slots[cache->hand].is_referenced = 0;
+        cache->hand = (cache->hand + 1) % cache->slot_count;
+    }
+
+    int slot = cache->hand;
+    cache->hand = (cache->hand + 1) % cache->slot_count;
+
+    if (cache->slots[slot].is_cached) {
+        remove_position(cache, find_position(cache, cache->slots[slot].key));
+        cache->stats.evictions++;
+    }
+    return slot;
+}
+
+void bplus_cache_close(BPlusHandle *handle)
+{
+    if (!(handle->cache))
+        return;
+
+    free(handle->cache->slots);
+    free(handle->cache->table);
+    free(handle->cache);
+    handle->cache = NULL;
+}
+
+int bplus_cache_enable(int file_desc, size_t capacity_bytes)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+
+    bplus_cache_close(handle);
+    if (capacity_bytes == 0)
+        return 0;
+
+    // each slot takes its record and two table entries (the table is kept at most half full)
+    size_t slot_bytes = sizeof(struct bplus_cache_slot) + 2 * sizeof(int);
+    size_t slot_count = capacity_bytes / slot_bytes;
+    if (slot_count == 0 || slot_count > INT32_MAX / 4)
+        return -1;
+
+    int table_size = 1;
+    while ((size_t)table_size < 2 * slot_count)
+        table_size *= 2;
+
+    struct bplus_cache *cache = calloc(1, sizeof(struct bplus_cache));
+    if (!cache)
+        return -1;
+
+    cache->slot_count = (int)slot_count;
+    cache->table_size = table_size;
+    cache->slots = malloc(slot_count * sizeof(struct bplus_cache_slot));
+    cache->table = malloc(table_size * sizeof(int));
+    if (!(cache->slots) || !(cache->table)) {
+        free(cache->slots);
+        free(cache->table);
+        free(cache);
+        return -1;
+    }
+
+    memset(cache->table, -1, table_size * sizeof(int)); // all bytes 0xff is -1
+    handle->cache = cache;
+    return 0;
+}
+
+int bplus_cache_stats(int file_desc, BPlusCacheStats *stats)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !(handle->cache))
+        return -1;
+
+    *stats = handle->cache->stats;
+    return 0;
+}
+
+int bplus_cache_get(BPlusHandle *handle, int key, Record *record)
+{
+    struct bplus_cache *cache = handle->cache;
+    if (!cache)
+        return 0;
+
+    int position = find_position(cache, key);
+    if (position == -1) {
+        cache->stats.misses++;
+        return 0;
+    }
+
+    struct bplus_cache_slot *slot = &(cache->slots[cache->table[position]]);
+    slot->is_referenced = 1;
+    if (record)
+        memcpy(record, &(slot->record), sizeof(Record));
+
+    cache->stats.hits++;
+    return 1;
+}
+
+void bplus_cache_put(BPlusHandle *handle, int key, const Record *record)
+{
+    struct bplus_cache *cache = handle->cache;
+    if (!cache || find_position(cache, key) != -1)
+        return;
+
+    int slot = take_slot(cache);
+    cache->slots[slot].key = key;
+    cache->slots[slot].is_cached = 1;
+    cache->slots[slot].is_referenced = 0; // a new record must be hit again to get a second chance
+    memcpy(&(cache->slots[slot].record), record, sizeof(Record));
+
+    int position = table_position(key, cache->table_size);
+    while (cache->table[position] != -1)
+        position = (position + 1) & (cache->table_size - 1);
+    cache->table[position] = slot;
+}
+
+void bplus_cache_invalidate(BPlusHandle *handle, int key)
+{
+    struct bplus_cache *cache = handle->cache;
+    if (!cache)
+        return;
+
+    int position = find_position(cache, key);
+    if (position == -1)
+        return;
+
+    // the slot stays in the clock, unreferenced, so the hand takes it on its next pass; its key can no longer be found
+    int slot = cache->table[position];
+    remove_position(cache, position);
+    cache->slots[slot].is_referenced = 0;
+    cache->slots[slot].is_cached = 0;
+}
@@ -2,6 +2,9 @@
 #include "../include/bplus_datanode.h"
 #include "../include/bplus_index_node.h"
 #include "../include/bplus_file_structs.h"
+#include "../include/bplus_handle.h"
+#include "../include/bplus_pool.h"
+#include "../include/bplus_file_funcs.h"
 // Μπορείτε να προσθέσετε εδώ βοηθητικές συναρτήσεις για την επεξεργασία Κόμβων toy Ευρετηρίου.
 
 #define CALL_BF(call)         \
@@ -61,14 +64,20 @@ void data_block_print(const char *block_start, const BPlusMeta *metadata)
     
     printf("Records:\n");
     for (int i = 0; i < header->record_count; i++) {
-        Record *rec = malloc(sizeof(Record));
-        memcpy(rec, block_ptr, sizeof(Record));
+        Record *rec = data_block_read_unordered_record(block_start, metadata, i);
+        if (!rec) break;
+        // the block only has the dictionary codes of a file with dictionaries, which are printed as #code
+        for (int j = 0; j < metadata->schema.count; j++) {
+            if (bplus_dictionary_is_coded(metadata, j))
+                snprintf(rec->values[j].string_value, MAX_STRING_LENGTH, "#%u", rec->values[j].code_value);
+        }
         printf("%d -> ", i);
         record_print(&(metadata->schema), rec);
         free(rec);
-        block_ptr += sizeof(Record);
     }
     printf("\n");
+    int record_size = bplus_file_has_pax_layout(metadata) ? data_block_pax_record_size(metadata) : (int)sizeof(Record);
+    block_ptr += record_size * header->record_count;
     free(header);
     
     printf("Unused space: %td Bytes\n", BF_BLOCK_SIZE - (block_ptr - block_start));
@@ -88,6 +97,11 @@ DataNodeHeader *data_block_read_header(const char *block_start)
     return result;
 }
 
+void data_block_copy_header(const char *block_start, DataNodeHeader *header)
+{
+    memcpy(header, block_start + sizeof(int), sizeof(DataNodeHeader));
+}
+
 int *data_block_read_index_array(const char *block_start, const BPlusMeta *metadata)
 {
     const char *target_start = block_start + sizeof(int) + sizeof(DataNodeHeader);
@@ -99,19 +113,94 @@ int *data_block_read_index_array(const char *block_start, const BPlusMeta *metad
     return result;
 }
 
+void data_block_copy_index_array(const char *block_start, const BPlusMeta *metadata, int *index_array)
+{
+    const char *target_start = block_start + sizeof(int) + sizeof(DataNodeHeader);
+    memcpy(index_array, target_start, metadata->max_records_per_block * sizeof(int));
+}
+
+int data_block_value_width(const BPlusMeta *metadata, int attribute)
+{
+    const AttributeSchema *attr = &(metadata->schema.attributes[attribute]);
+    if (bplus_dictionary_is_coded(metadata, attribute))
+        return sizeof(unsigned short);
+
+    switch (attr->type) {
+        case TYPE_INT: return sizeof(int);
+        case TYPE_FLOAT: return sizeof(float);
+        case TYPE_LONG: return sizeof(long long);
+        case TYPE_CHAR: return (attr->length < MAX_STRING_LENGTH) ? attr->length : MAX_STRING_LENGTH;
+        default: return 0;
+    }
+}
+
+int data_block_pax_record_size(const BPlusMeta *metadata)
+{
+    int size = 0;
+    for (int i = 0; i < metadata->schema.count; i++)
+        size += data_block_value_width(metadata, i);
+    return size;
+}
+
+// returns the start of the heap part of a block (after its index array)
+static const char *heap_start(const char *block_start, const BPlusMeta *metadata)
+{
+    return block_start + sizeof(int) + sizeof(DataNodeHeader) + metadata->max_records_per_block * sizeof(int);
+}
+
+// returns the offset of the minipage of attribute from the start of the heap part of a PAX data block; the minipage of
+// the key comes first, then those of the other attributes in schema order
+static int pax_minipage_offset(const BPlusMeta *metadata, int attribute)
+{
+    const TableSchema *schema = &(metadata->schema);
+    if (attribute == schema->key_index)
+        return 0;
+
+    int offset = data_block_value_width(metadata, schema->key_index);
+    for (int i = 0; i < attribute; i++) {
+        if (i != schema->key_index)
+            offset += data_block_value_width(metadata, i);
+    }
+    return offset * metadata->max_records_per_block;
+}
+
+const char *data_block_column_start(const char *block_start, const BPlusMeta *metadata, int attribute, int *stride)
+{
+    if (!bplus_file_has_pax_layout(metadata)) {
+        *stride = sizeof(Record);
+        return heap_start(block_start, metadata) + attribute * sizeof(FieldValue);
+    }
+
+    *stride = data_block_value_width(metadata, attribute);
+    return heap_start(block_start, metadata) + pax_minipage_offset(metadata, attribute);
+}
+
+// copies the record at heap_index of the heap part of a block to record; the values of a PAX data block are gathered
+// from their minipages, and the bytes of each FieldValue after its value are zero
+static void copy_heap_record(const char *block_start, const BPlusMeta *metadata, int heap_index, Record *record)
+{
+    if (!bplus_file_has_pax_layout(metadata)) {
+        memcpy(record, heap_start(block_start, metadata) + heap_index * sizeof(Record), sizeof(Record));
+        return;
+    }
+
+    memset(record, 0, sizeof(Record));
+    for (int i = 0; i < metadata->schema.count; i++) {
+        int width;
+        const char *column = data_block_column_start(block_start, metadata, i, &width);
+        memcpy(&(record->values[i]), column + heap_index * width, width);
+    }
+}
+
 Record *data_block_read_unordered_record(const char *block_start, const BPlusMeta *metadata, int index)
 {
     if (index >= metadata->max_records_per_block)
         return NULL;
 
-    int index_array_length = metadata->max_records_per_block;
-    const char *record0_start = block_start + sizeof(int) + sizeof(DataNodeHeader) + index_array_length * sizeof(int);
-    const char *target_start = record0_start + index * sizeof(Record);
-
     Record *result = malloc(sizeof(Record));
     if (!result) return NULL;
 
-    memcpy(result, target_start, sizeof(Record));
+    copy_heap_record(block_start, metadata, index, result);
     return result;
 }
 
@@ -121,27 +210,34 @@ Record *data_block_read_record(const char *block_start, const DataNodeHeader *bl
     if (index >= block_header->record_count)
         return NULL;
 
-    int index_array_length = metadata->max_records_per_block;
-    const char *record0_start = block_start + sizeof(int) + sizeof(DataNodeHeader) + index_array_length * sizeof(int);
-
-    // index of record in the unsorted "heap" of records
-    int heap_index = index_array[index];
-    const char *target_start = record0_start + heap_index * sizeof(Record);
-
     Record *result = malloc(sizeof(Record));
     if (!result) return NULL;
 
-    memcpy(result, target_start, sizeof(Record));
+    // index of record in the unsorted "heap" of records
+    copy_heap_record(block_start, metadata, index_array[index], result);
     return result;
 }
 
+int data_block_copy_record(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
+                           const BPlusMeta *metadata, int index, Record *record)
+{
+    if (index >= block_header->record_count)
+        return -1;
+
+    copy_heap_record(block_start, metadata, index_array[index], record);
+    return 0;
+}
+
 void data_block_read_heap_as_array(const char *block_start, const DataNodeHeader *block_header,
                                    const BPlusMeta *metadata, Record *record_array)
 {
-    int index_array_length = metadata->max_records_per_block;
-    const char *record0_start = block_start + sizeof(int) + sizeof(DataNodeHeader) + index_array_length * sizeof(int);
+    if (!bplus_file_has_pax_layout(metadata)) {
+        memcpy(record_array, heap_start(block_start, metadata), block_header->record_count * sizeof(Record));
+        return;
+    }
 
-    memcpy(record_array, record0_start, block_header->record_count * sizeof(Record));
+    for (int i = 0; i < block_header->record_count; i++)
+        copy_heap_record(block_start, metadata, i, &(record_array[i]));
 }
 
 int data_block_has_available_space(const DataNodeHeader *block_header, const BPlusMeta *metadata)
@@ -166,14 +262,33 @@ int data_block_write_unordered_record(char *block_start, const BPlusMeta *metada
     if (index >= metadata->max_records_per_block)
         return -1;
     
-    int index_array_length = metadata->max_records_per_block;
-    char *record0_start = block_start + sizeof(int) + sizeof(DataNodeHeader) + index_array_length * sizeof(int);
-    char *target_start = record0_start + index * sizeof(Record);
+    if (!bplus_file_has_pax_layout(metadata)) {
+        memcpy((char *)heap_start(block_start, metadata) + index * sizeof(Record), record, sizeof(Record));
+        return 0;
+    }
 
-    memcpy(target_start, record, sizeof(Record));
+    // each value is scattered to its minipage
+    for (int i = 0; i < metadata->schema.count; i++) {
+        int width;
+        char *column = (char *)data_block_column_start(block_start, metadata, i, &width);
+        memcpy(column + index * width, &(record->values[i]), width);
+    }
     return 0;
 }
 
+// returns the key of the record at index, where index i refers to the i-th smallest record (sorted)
+// only the key field is copied, instead of the whole record as in data_block_read_record()
+static int data_block_read_record_key(const char *block_start, const int *index_array, const BPlusMeta *metadata, int index)
+{
+    int stride;
+    const char *key_start = data_block_column_start(block_start, metadata, metadata->schema.key_index, &stride)
+                            + index_array[index] * stride;
+
+    int key;
+    memcpy(&key, key_start, sizeof(int));
+    return key;
+}
+
 // internal binary search to use inside data_block_search_insert_pos(); both start and end are inclusive
 // returns the same as data_block_search_insert_pos()
 int data_block_binary_search_insert_pos(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
@@ -183,44 +298,26 @@ int data_block_binary_search_insert_pos(const char *block_start, const DataNodeH
         return start; 
     
     if (start == end) { // there is only one "unsearched" record remaining
-        Record *remaining_record = data_block_read_record(block_start, block_header, index_array, metadata, start);
-        if (!remaining_record) return DATA_BLOCK_SEARCH_ERROR;
-
-        int remaining_record_key = record_get_key(&(metadata->schema), remaining_record);
-        if (remaining_record_key == new_key) { // key already exists
-            free(remaining_record);
+        int remaining_record_key = data_block_read_record_key(block_start, index_array, metadata, start);
+        if (remaining_record_key == new_key) // key already exists
             return -1;
-        }
-        else if (remaining_record_key > new_key) {
+        else if (remaining_record_key > new_key)
             // record must go in the current position, and the larger ones are to be shifted one place to the right
-            free(remaining_record);
             return start;
-        }
-        else {
+        else
             // record must go in the next position, and the larger ones are to be shifted one place to the right
-            free(remaining_record);
             return start + 1;
-        }
     }
 
     // more than one "unsearched" records
     int mid = (int)((start + end) / 2); // using the floor of the division
-    Record *record_at_mid = data_block_read_record(block_start, block_header, index_array, metadata, mid);
-    if (!record_at_mid) return DATA_BLOCK_SEARCH_ERROR;
-
-    int record_key_at_mid = record_get_key(&(metadata->schema), record_at_mid);
-    if (record_key_at_mid == new_key) { // key already exists
-        free(record_at_mid);
+    int record_key_at_mid = data_block_read_record_key(block_start, index_array, metadata, mid);
+    if (record_key_at_mid == new_key) // key already exists
         return -1;
-    }
-    else if (record_key_at_mid > new_key) {
-        free(record_at_mid);
+    else if (record_key_at_mid > new_key)
         return data_block_binary_search_insert_pos(block_start, block_header, index_array, metadata, start, mid - 1, new_key);
-    }
-    else {
-        free(record_at_mid);
+    else
         return data_block_binary_search_insert_pos(block_start, block_header, index_array, metadata, mid + 1, end, new_key);
-    }
 }
 
 int data_block_search_insert_pos(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
@@ -230,6 +327,37 @@ int data_block_search_insert_pos(const char *block_start, const DataNodeHeader *
                                                0, block_header->record_count - 1, new_key);
 }
 
+int data_block_key_search(const char *block_start, const DataNodeHeader *block_header, const int *index_array,
+                          const BPlusMeta *metadata, int key)
+{
+    int start = 0;
+    int end = block_header->record_count - 1; // both start and end are inclusive
+
+    while (start <= end) {
+        int mid = (start + end) / 2;
+        int key_at_mid = data_block_read_record_key(block_start, index_array, metadata, mid);
+
+        if (key_at_mid == key)
+            return mid;
+        else if (key_at_mid > key)
+            end = mid - 1;
+        else
+            start = mid + 1;
+    }
+
+    return -1; // key is not in the block
+}
+
+int data_block_last_key(const char *block_start, const DataNodeHeader *block_header, const BPlusMeta *metadata)
+{
+    // only the last element of the index array is needed
+    const char *index_array_start = block_start + sizeof(int) + sizeof(DataNodeHeader);
+    int last_index;
+    memcpy(&last_index, index_array_start + (block_header->record_count - 1) * sizeof(int), sizeof(int));
+
+    return data_block_read_record_key(block_start, &last_index, metadata, 0);
+}
+
 int print_all_blocks(int file_desc)
 {
     BF_Block *header_block;
@@ -239,6 +367,8 @@ int print_all_blocks(int file_desc)
 
     BPlusMeta metadata;
     memcpy(&metadata, header_block_start, sizeof(BPlusMeta));
+    CALL_BF(BF_UnpinBlock(header_block));
+    BF_Block_Destroy(&header_block);
 
     printf("\nMetadata:\n");
     printf("Magic number (4 bytes): ");
@@ -257,8 +387,13 @@ int print_all_blocks(int file_desc)
     BF_Block *block;
     BF_Block_Init(&block);
     for (int i = 1; i < metadata.block_count; i++) {
+        // every block is read once, so it goes through the scan ring instead of evicting the hot blocks
+        bplus_pool_check(file_desc);
         CALL_BF(BF_GetBlock(file_desc, i, block));
+        bplus_handle_touch(file_desc, i, BPLUS_ACCESS_SCAN);
         char *block_start = BF_Block_GetData(block);
+        int block_type;
+        memcpy(&block_type, block_start, sizeof(int));
 
         printf("( %d ) ", i);
         if (is_data_block(block_start)) {
@@ -266,6 +401,18 @@ int print_all_blocks(int file_desc)
             data_block_print(block_start, &metadata);
             printf("\n");
         }
+        else if (block_type == BLOCK_TYPE_DICTIONARY) {
+            printf("DICTIONARY BLOCK\n");
+            dictionary_block_print(block_start, &metadata);
+        }
+        else if (block_type == BLOCK_TYPE_POSTINGS) {
+            printf("POSTINGS BLOCK\n");
+            postings_block_print(block_start);
+        }
+        else if (block_type == BLOCK_TYPE_KEYED_DATA || block_type == BLOCK_TYPE_KEYED_INDEX) {
+            printf("KEYED %s BLOCK\n", block_type == BLOCK_TYPE_KEYED_DATA ? "DATA" : "INDEX");
+            keyed_block_print(block_start, &metadata);
+        }
         else {
             printf("INDEX BLOCK\n");
             index_block_print(block_start, &metadata);
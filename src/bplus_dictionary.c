@@ -0,0 +1,478 @@
+#include <stdint.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_dictionary.h"
+
+#define CALL_BF(call)         \
+{                             \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+        BF_PrintError(code);  \
+        return -1;            \
+    }                         \
+}
+
+#define DICTIONARY_BLOCK_ENTRIES_START (sizeof(int) + sizeof(DictionaryNodeHeader))
+
+// gets the block with block_index, pinned in block, or read in the mapping if the file of handle is memory-mapped
+// returns 0 on success, -1 otherwise
+static int get_block(const BPlusHandle *handle, int file_desc, int block_index, BF_Block *block,
+                     const char **block_start)
+{
+    if (bplus_mmap_is_mapped(handle)) {
+        *block_start = bplus_mmap_block(handle, block_index);
+        return *block_start ? 0 : -1;
+    }
+
+    CALL_BF(BF_GetBlock(file_desc, block_index, block));
+    *block_start = BF_Block_GetData(block);
+    bplus_handle_touch(file_desc, block_index, BPLUS_ACCESS_NORMAL);
+    return 0;
+}
+
+// unpins a block got with get_block() (mapped blocks are not pinned)
+static void release_block(const BPlusHandle *handle, BF_Block *block)
+{
+    if (!bplus_mmap_is_mapped(handle))
+        BF_UnpinBlock(block);
+}
+
+// returns the bytes of an entry of the dictionary of the attribute at position attribute of the file of metadata
+static int entry_width(const BPlusMeta *metadata, int attribute)
+{
+    int length = metadata->schema.attributes[attribute].length;
+    return (length < MAX_STRING_LENGTH) ? length : MAX_STRING_LENGTH;
+}
+
+// returns the number of entries that fit in a dictionary block with entries of width bytes
+static int block_capacity(int width)
+{
+    return (int)((BF_BLOCK_SIZE - DICTIONARY_BLOCK_ENTRIES_START) / width);
+}
+
+// returns the position of entry (of width bytes) in a hash table of table_size entries (a power of 2)
+static int table_position(const char *entry, int width, int table_size)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (int i = 0; i < width; i++)
+        hash = (hash ^ (unsigned char)entry[i]) * 16777619u;
+    return (int)hash & (table_size - 1);
+}
+
+// returns the code of entry in column, or -1 if it has no such string
+static int find_code(const struct bplus_dictionary_column *column, const char *entry)
+{
+    if (column->table_size == 0)
+        return -1;
+
+    int position = table_position(entry, column->width, column->table_size);
+    while (column->table[position] != -1) {
+        int code = column->table[position];
+        if (memcmp(column->strings + code * column->width, entry, column->width) == 0)
+            return code;
+        position = (position + 1) & (column->table_size - 1);
+    }
+
+    return -1;
+}
+
+// sets the hash table of column (of any size above its count) to its codes
+static void fill_table(struct bplus_dictionary_column *column)
+{
+    memset(column->table, -1, column->table_size * sizeof(int));
+
+    for (int code = 0; code < column->count; code++) {
+        int position = table_position(column->strings + code * column->width, column->width, column->table_size);
+        while (column->table[position] != -1)
+            position = (position + 1) & (column->table_size - 1);
+        column->table[position] = code;
+    }
+}
+
+// makes room in column for one more code: in its strings, and in its hash table, which is kept at most half full
+// returns 0 on success, -1 if unsuccessful (column is unchanged)
+static int reserve_code(struct bplus_dictionary_column *column)
+{
+    if (column->count == column->capacity) {
+        int capacity = column->capacity ? 2 * column->capacity : 16;
+        char *strings = realloc(column->strings, (size_t)capacity * column->width);
+        if (!strings)
+            return -1;
+        column->strings = strings;
+        column->capacity = capacity;
+    }
+
+    if (2 * (column->count + 1) <= column->table_size)
+        return 0;
+
+    // the table is rebuilt at twice its size
+    int table_size = column->table_size ? 2 * column->table_size : 32;
+    int *table = malloc(table_size * sizeof(int));
+    if (!table)
+        return -1;
+
+    free(column->table);
+    column->table = table;
+    column->table_size = table_size;
+    fill_table(column);
+    return 0;
+}
+
+// adds entry as the next code of column, which must have room for it (see reserve_code())
+// returns the code
+static int add_code(struct bplus_dictionary_column *column, const char *entry)
+{
+    int code = column->count++;
+    memcpy(column->strings + code * column->width, entry, column->width);
+
+    int position = table_position(entry, column->width, column->table_size);
+    while (column->table[position] != -1)
+        position = (position + 1) & (column->table_size - 1);
+    column->table[position] = code;
+    return code;
+}
+
+// allocates an empty dictionary block for the attribute at position attribute of the file, after the last one of
+// column (or as the first one, in the dictionary_blocks of block 0), and makes it the last one of column; metadata
+// gets the new block count and dictionary_blocks of block 0
+// block is an initialized BF block handle, which is pinned to the new block on success
+// returns 0 on success, -1 otherwise
+static int append_block(int file_desc, BPlusMeta *metadata, int attribute, struct bplus_dictionary_column *column,
+                        BF_Block *block)
+{
+    CALL_BF(BF_AllocateBlock(file_desc, block));
+    char *block_start = BF_Block_GetData(block);
+
+    int block_type = BLOCK_TYPE_DICTIONARY;
+    DictionaryNodeHeader header = { attribute, 0, -1 };
+    memcpy(block_start, &block_type, sizeof(int));
+    memcpy(block_start + sizeof(int), &header, sizeof(DictionaryNodeHeader));
+    BF_Block_SetDirty(block);
+
+    // the new block is counted in block 0, where the inserts read the block count from
+    BF_Block *other_block;
+    BF_Block_Init(&other_block);
+    if (BF_GetBlock(file_desc, 0, other_block) != BF_OK) {
+        BF_Block_Destroy(&other_block);
+        BF_UnpinBlock(block);
+        return -1;
+    }
+    char *header_block_start = BF_Block_GetData(other_block);
+
+    BPlusMeta header_metadata;
+    memcpy(&header_metadata, header_block_start, sizeof(BPlusMeta));
+    header_metadata.block_count++;
+    int block_index = header_metadata.block_count - 1;
+    if (column->last_block_index == -1)
+        header_metadata.dictionary_blocks[attribute] = block_index;
+    memcpy(header_block_start, &header_metadata, sizeof(BPlusMeta));
+    BF_Block_SetDirty(other_block);
+    BF_UnpinBlock(other_block);
+
+    metadata->block_count = header_metadata.block_count;
+    metadata->dictionary_blocks[attribute] = header_metadata.dictionary_blocks[attribute];
+
+    // linking the previous last block to it
+    if (column->last_block_index != -1) {
+        if (BF_GetBlock(file_desc, column->last_block_index, other_block) != BF_OK) {
+            BF_Block_Destroy(&other_block);
+            BF_UnpinBlock(block);
+            return -1;
+        }
+        char *last_block_start = BF_Block_GetData(other_block);
+
+        DictionaryNodeHeader last_header;
+        memcpy(&last_header, last_block_start + sizeof(int), sizeof(DictionaryNodeHeader));
+        last_header.next_index = block_index;
+        memcpy(last_block_start + sizeof(int), &last_header, sizeof(DictionaryNodeHeader));
+        BF_Block_SetDirty(other_block);
+        BF_UnpinBlock(other_block);
+    }
+    BF_Block_Destroy(&other_block);
+
+    column->last_block_index = block_index;
+    column->last_block_entries = 0;
+    return 0;
+}
+
+// writes entry after the last entry of the dictionary blocks of the attribute at position attribute of the file of
+// metadata (which gets the new block count if a block is appended)
+// returns 0 on success, -1 otherwise
+static int append_entry(int file_desc, BPlusMeta *metadata, int attribute, struct bplus_dictionary_column *column,
+                        const char *entry)
+{
+    BF_Block *block;
+    BF_Block_Init(&block);
+
+    int result;
+    if (column->last_block_index == -1 || column->last_block_entries == block_capacity(column->width))
+        result = append_block(file_desc, metadata, attribute, column, block);
+    else
+        result = (BF_GetBlock(file_desc, column->last_block_index, block) == BF_OK) ? 0 : -1;
+    if (result == -1) {
+        BF_Block_Destroy(&block);
+        return -1;
+    }
+    bplus_handle_touch(file_desc, column->last_block_index, BPLUS_ACCESS_NORMAL);
+
+    char *block_start = BF_Block_GetData(block);
+    DictionaryNodeHeader header;
+    memcpy(&header, block_start + sizeof(int), sizeof(DictionaryNodeHeader));
+    memcpy(block_start + DICTIONARY_BLOCK_ENTRIES_START + header.entry_count * column->width, entry, column->width);
+    header.entry_count++;
+    memcpy(block_start + sizeof(int), &header, sizeof(DictionaryNodeHeader));
+
+    BF_Block_SetDirty(block);
+    BF_UnpinBlock(block);
+    BF_Block_Destroy(&block);
+
+    column->last_block_entries = header.entry_count;
+    return 0;
+}
+
+// reads the chain of dictionary blocks of the attribute at position attribute, which starts at block_index, into
+// column
+// returns 0 on success, -1 otherwise
+static int load_column(const BPlusHandle *handle, int file_desc, int attribute, int block_index,
+                       struct bplus_dictionary_column *column)
+{
+    BF_Block *block;
+    BF_Block_Init(&block);
+
+    int result = 0;
+    while (block_index != -1 && result == 0) {
+        const char *block_start;
+        if (get_block(handle, file_desc, block_index, block, &block_start) == -1) {
+            result = -1;
+            break;
+        }
+
+        int block_type;
+        DictionaryNodeHeader header;
+        memcpy(&block_type, block_start, sizeof(int));
+        memcpy(&header, block_start + sizeof(int), sizeof(DictionaryNodeHeader));
+        if (block_type != BLOCK_TYPE_DICTIONARY || header.attribute != attribute
+            || header.entry_count < 0 || header.entry_count > block_capacity(column->width))
+            result = -1;
+
+        const char *entries = block_start + DICTIONARY_BLOCK_ENTRIES_START;
+        for (int i = 0; i < header.entry_count && result == 0; i++) {
+            if (column->count == BPLUS_DICTIONARY_MAX_CODES || reserve_code(column) == -1)
+                result = -1;
+            else
+                add_code(column, entries + i * column->width);
+        }
+
+        column->last_block_index = block_index;
+        column->last_block_entries = header.entry_count;
+        block_index = header.next_index;
+        release_block(handle, block);
+    }
+
+    BF_Block_Destroy(&block);
+    column->kept_count = column->count;
+    column->saved_count = column->count;
+    return result;
+}
+
+int bplus_dictionary_size(int file_desc, const BPlusMeta *metadata, const char *attr_name)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !(handle->dictionary))
+        return -1;
+
+    for (int i = 0; i < metadata->schema.count; i++) {
+        if (bplus_dictionary_is_coded(metadata, i) && strcmp(metadata->schema.attributes[i].name, attr_name) == 0)
+            return handle->dictionary->columns[i].count;
+    }
+
+    return -1;
+}
+
+int bplus_dictionary_is_coded(const BPlusMeta *metadata, int attribute)
+{
+    return bplus_file_has_dictionaries(metadata) && metadata->schema.attributes[attribute].type == TYPE_CHAR;
+}
+
+int bplus_dictionary_load(int file_desc, const BPlusMeta *metadata)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+    if (!bplus_file_has_dictionaries(metadata))
+        return 0;
+
+    // the dictionaries are kept by the handle as soon as they exist, so that bplus_handle_close() frees them
+    handle->dictionary = calloc(1, sizeof(struct bplus_dictionary));
+    if (!(handle->dictionary))
+        return -1;
+
+    for (int i = 0; i < metadata->schema.count; i++) {
+        if (!bplus_dictionary_is_coded(metadata, i))
+            continue;
+
+        struct bplus_dictionary_column *column = &(handle->dictionary->columns[i]);
+        column->width = entry_width(metadata, i);
+        column->last_block_index = -1;
+        if (column->width <= 0
+            || load_column(handle, file_desc, i, metadata->dictionary_blocks[i], column) == -1)
+            return -1;
+    }
+
+    return 0;
+}
+
+int bplus_dictionary_encode(int file_desc, const BPlusMeta *metadata, const Record *record, Record *stored)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+
+    memcpy(stored, record, sizeof(Record));
+    if (!(handle->dictionary))
+        return 0;
+
+    for (int i = 0; i < metadata->schema.count; i++) {
+        struct bplus_dictionary_column *column = &(handle->dictionary->columns[i]);
+        if (column->width == 0)
+            continue;
+
+        // the entry of a string has the characters up to its '\0' and is padded with '\0', so that equal strings
+        // have equal entries whatever follows their '\0' in the record
+        char entry[MAX_STRING_LENGTH];
+        memset(entry, 0, sizeof(entry));
+        for (int j = 0; j < column->width && record->values[i].string_value[j] != '\0'; j++)
+            entry[j] = record->values[i].string_value[j];
+
+        // a new string gets a pending code, which is only written to the file once the record is stored (see
+        // bplus_dictionary_save())
+        int code = find_code(column, entry);
+        if (code == -1) {
+            if (bplus_mmap_is_mapped(handle) || column->count == BPLUS_DICTIONARY_MAX_CODES
+                || reserve_code(column) == -1)
+                return -1;
+            code = add_code(column, entry);
+        }
+
+        memset(&(stored->values[i]), 0, sizeof(FieldValue));
+        stored->values[i].code_value = (unsigned short)code;
+    }
+
+    return 0;
+}
+
+int bplus_dictionary_save(int file_desc, BPlusMeta *metadata)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+    if (!(handle->dictionary))
+        return 0;
+
+    for (int i = 0; i < metadata->schema.count; i++) {
+        struct bplus_dictionary_column *column = &(handle->dictionary->columns[i]);
+        column->kept_count = column->count;
+        while (column->saved_count < column->kept_count) {
+            if (append_entry(file_desc, metadata, i, column, column->strings + column->saved_count * column->width)
+                == -1)
+                return -1;
+            column->saved_count++;
+        }
+    }
+
+    return 0;
+}
+
+void bplus_dictionary_discard(int file_desc)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !(handle->dictionary))
+        return;
+
+    for (int i = 0; i < MAX_ATTRIBUTES; i++) {
+        struct bplus_dictionary_column *column = &(handle->dictionary->columns[i]);
+        if (column->count > column->kept_count) {
+            column->count = column->kept_count;
+            fill_table(column);
+        }
+    }
+}
+
+void bplus_dictionary_decode(const BPlusHandle *handle, const BPlusMeta *metadata, Record *record)
+{
+    if (!(handle->dictionary))
+        return;
+
+    for (int i = 0; i < metadata->schema.count; i++) {
+        const struct bplus_dictionary_column *column = &(handle->dictionary->columns[i]);
+        if (column->width == 0)
+            continue;
+
+        int code = record->values[i].code_value;
+        memset(&(record->values[i]), 0, sizeof(FieldValue));
+        if (code < column->count)
+            memcpy(record->values[i].string_value, column->strings + code * column->width, column->width);
+    }
+}
+
+const char *bplus_dictionary_string(const BPlusHandle *handle, int attribute, int code)
+{
+    if (!(handle->dictionary) || attribute < 0 || attribute >= MAX_ATTRIBUTES)
+        return NULL;
+
+    const struct bplus_dictionary_column *column = &(handle->dictionary->columns[attribute]);
+    if (code < 0 || code >= column->count)
+        return NULL;
+    return column->strings + code * column->width;
+}
+
+int bplus_dictionary_code_count(const BPlusHandle *handle, int attribute)
+{
+    if (!(handle->dictionary) || attribute < 0 || attribute >= MAX_ATTRIBUTES)
+        return 0;
+    return handle->dictionary->columns[attribute].count;
+}
+
+void dictionary_block_print(const char *block_start, const BPlusMeta *metadata)
+{
+    int block_type;
+    memcpy(&block_type, block_start, sizeof(int));
+    if (block_type != BLOCK_TYPE_DICTIONARY) {
+        perror("Not a dictionary block\n");
+        return;
+    }
+
+    DictionaryNodeHeader header;
+    memcpy(&header, block_start + sizeof(int), sizeof(DictionaryNodeHeader));
+    if (header.attribute < 0 || header.attribute >= metadata->schema.count)
+        return;
+
+    for (int i = 0; i < 20; i++) printf("-");
+    printf("\n");
+    printf("attribute = %d\n", header.attribute);
+    printf("entry_count = %d\n", header.entry_count);
+    printf("next_index = %d\n\n", header.next_index);
+
+    const char *entries = block_start + DICTIONARY_BLOCK_ENTRIES_START;
+    int width = entry_width(metadata, header.attribute);
+    printf("Entries: ");
+    for (int i = 0; i < header.entry_count && i < block_capacity(width); i++)
+        printf("%.*s, ", width, entries + i * width);
+    printf("\n\n");
+
+    for (int i = 0; i < 20; i++) printf("-");
+    printf("\n");
+}
+
+void bplus_dictionary_close(BPlusHandle *handle)
+{
+    if (!(handle->dictionary))
+        return;
+
+    for (int i = 0; i < MAX_ATTRIBUTES; i++) {
+        free(handle->dictionary->columns[i].strings);
+        free(handle->dictionary->columns[i].table);
+    }
+    free(handle->dictionary);
+    handle->dictionary = NULL;
+}
@@ -1,4 +1,5 @@
 #include "bplus_file_funcs.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +25,53 @@
     }
 
 const char BF_MAGIC_NUM[4] = { 0x80, 0xAA, 'B', 'P' }; // this identifies the file format
+const char BF_MAGIC_NUM_COUNTED[4] = { 0x80, 0xAA, 'B', 'C' }; // the same format, with subtree counts
+const char BF_MAGIC_NUM_AGGREGATED[4] = { 0x80, 0xAA, 'B', 'A' }; // with subtree counts and aggregates
+const char BF_MAGIC_NUM_PAX[4] = { 0x80, 0xAA, 'B', 'X' }; // with subtree counts and PAX data blocks
+const char BF_MAGIC_NUM_DICTIONARY[4] = { 0x80, 0xAA, 'B', 'D' }; // with subtree counts, PAX and dictionaries
+const char BF_MAGIC_NUM_KEYED[4] = { 0x80, 0xAA, 'B', 'K' }; // keyed data and index blocks (see bplus_keyed.h)
+const char BF_MAGIC_NUM_LONG[4] = { 0x80, 0xAA, 'B', 'L' }; // keyed, with a LONG key and fixed size index entries
+
+int bplus_file_has_counts(const BPlusMeta *metadata)
+{
+    return memcmp(metadata->magic_num, BF_MAGIC_NUM_COUNTED, sizeof(BF_MAGIC_NUM_COUNTED)) == 0
+        || bplus_aggregate_attribute(metadata) != -1 || bplus_file_has_pax_layout(metadata);
+}
+
+int bplus_file_has_pax_layout(const BPlusMeta *metadata)
+{
+    return memcmp(metadata->magic_num, BF_MAGIC_NUM_PAX, sizeof(BF_MAGIC_NUM_PAX)) == 0
+        || bplus_file_has_dictionaries(metadata);
+}
+
+int bplus_file_has_dictionaries(const BPlusMeta *metadata)
+{
+    return memcmp(metadata->magic_num, BF_MAGIC_NUM_DICTIONARY, sizeof(BF_MAGIC_NUM_DICTIONARY)) == 0;
+}
+
+int bplus_file_is_keyed(const BPlusMeta *metadata)
+{
+    return memcmp(metadata->magic_num, BF_MAGIC_NUM_KEYED, sizeof(BF_MAGIC_NUM_KEYED)) == 0
+        || bplus_file_has_long_keys(metadata);
+}
+
+int bplus_file_has_long_keys(const BPlusMeta *metadata)
+{
+    return memcmp(metadata->magic_num, BF_MAGIC_NUM_LONG, sizeof(BF_MAGIC_NUM_LONG)) == 0;
+}
+
+int bplus_file_index_block_type(const BPlusMeta *metadata)
+{
+    if (bplus_aggregate_attribute(metadata) != -1)
+        return BLOCK_TYPE_INDEX_AGGREGATED;
+    return bplus_file_has_counts(metadata) ? BLOCK_TYPE_INDEX_COUNTED : BLOCK_TYPE_INDEX;
+}
+
+int bplus_magic_num_is_valid(const BPlusMeta *metadata)
+{
+    return memcmp(metadata->magic_num, BF_MAGIC_NUM, sizeof(BF_MAGIC_NUM)) == 0 || bplus_file_has_counts(metadata)
+        || bplus_file_is_keyed(metadata);
+}
 
 // helper functions (not defined in bplus_file_funcs.h)
 
@@ -43,59 +91,31 @@ int get_ceiling(float x)
 // returns 0 on success, -1 otherwise
 int tree_search_data_block(int root_index, int key, int file_desc, BF_Block *found_block, int *found_block_index)
 {
-    // the leaf-node found block index is the root index of the innermost call
-    *found_block_index = root_index;
-
-    // getting the root block and its data
-    CALL_BF(BF_GetBlock(file_desc, root_index, found_block));
-    char *block_start = BF_Block_GetData(found_block);
-
-    // if block is a data block, then it is found (remains pinned)
-    if (is_data_block(block_start))
-        return 0;
-
-    // else it is an index block and must be searched
-    IndexNodeHeader *block_header = index_block_read_header(block_start); // getting the header
-    if (!block_header) {
-        CALL_BF(BF_UnpinBlock(found_block));
-        return -1;
-    }
-
-    // determining the new_root_index to follow
-    int new_root_index;
-    int position = index_block_key_search(block_start, block_header, key);
-    if (position == INDEX_BLOCK_SEARCH_ERROR) {
-        CALL_BF(BF_UnpinBlock(found_block));
-        free(block_header);
-        return -1;
-    }
-
-    if (position == -1) {
-        // continue in leftmost index
-        new_root_index = index_block_read_leftmost_index(block_start);
-        free(block_header);
-    }
-    else {
-        // continue in the entry index at the given position
-        IndexNodeEntry *entry = index_block_read_entry(block_start, block_header, position);
-        if (!entry) {
-            CALL_BF(BF_UnpinBlock(found_block));
-            free(block_header);
-            return -1;
+    int block_index = root_index;
+
+    while (1) {
+        // getting the block and its data
+        CALL_BF(BF_GetBlock(file_desc, block_index, found_block));
+        char *block_start = BF_Block_GetData(found_block);
+        bplus_handle_touch(file_desc, block_index, BPLUS_ACCESS_NORMAL);
+
+        // if block is a data block, then it is found (remains pinned)
+        if (is_data_block(block_start)) {
+            *found_block_index = block_index;
+            return 0;
         }
 
-        new_root_index = entry->right_index;
-        free(block_header);
-        free(entry);
+        // else it is an index block, and the search continues in the child that can contain the key
+        // (searched in place, so that a descent allocates no memory)
+        block_index = index_block_find_child(block_start, key);
+        CALL_BF(BF_UnpinBlock(found_block));
     }
-
-    // continuing the search in new_root_index
-    CALL_BF(BF_UnpinBlock(found_block));
-    return tree_search_data_block(new_root_index, key, file_desc, found_block, found_block_index);
 }
 
 // starting from non leaf node block, which is an index block (with non_leaf_node_index), its min_record_key is updated
 // to new_min; then its parent is found and the parent's min_record_key is also updated; this is done recursively up to the root
+// the recursion stops early at the first block whose min_record_key is already <= new_min, as no block above it can change;
+// this way only the blocks that actually change are set dirty (and later written back by BF)
 // temp_block must be already initialized, and should be destroyed after the call
 // returns 0 on success, -1 otherwise
 int bubble_up_min_record_key(int non_leaf_node_index, int new_min, int file_desc, BF_Block *temp_block)
@@ -104,22 +124,24 @@ int bubble_up_min_record_key(int non_leaf_node_index, int new_min, int file_desc
     CALL_BF(BF_GetBlock(file_desc, non_leaf_node_index, temp_block));
     char *temp_block_start = BF_Block_GetData(temp_block);
 
-    IndexNodeHeader *temp_block_header = index_block_read_header(temp_block_start);
-    if (!temp_block_header) {
+    IndexNodeHeader temp_block_header;
+    index_block_copy_header(temp_block_start, &temp_block_header);
+
+    // nothing changes from here up to the root, so the block is left clean
+    if (temp_block_header.min_record_key <= new_min) {
         CALL_BF(BF_UnpinBlock(temp_block));
-        return -1;
+        return 0;
     }
 
-    temp_block_header->min_record_key = new_min; // updating min
-    int parent_index = temp_block_header->parent_index; // storing parent index to visit next
+    temp_block_header.min_record_key = new_min; // updating min
+    int parent_index = temp_block_header.parent_index; // storing parent index to visit next
 
     // writing back the header
-    index_block_write_header(temp_block_start, temp_block_header);
+    index_block_write_header(temp_block_start, &temp_block_header);
     BF_Block_SetDirty(temp_block);
 
-    // unpinning and cleanup
+    // unpinning
     CALL_BF(BF_UnpinBlock(temp_block));
-    free(temp_block_header);
 
     // checking if there is parent or this is root
     if (parent_index == -1)
@@ -130,7 +152,12 @@ int bubble_up_min_record_key(int non_leaf_node_index, int new_min, int file_desc
 
 // bplus functions
 
-int bplus_create_file(const TableSchema *schema, const char *fileName)
+// creates the file fileName of a B+ tree with schema and the format of magic_num; aggregate_attribute is the position
+// of its aggregated attribute in schema (see bplus_aggregate.h) for BF_MAGIC_NUM_AGGREGATED, -1 otherwise, and
+// key_format the key attributes for BF_MAGIC_NUM_KEYED (see bplus_keyed.h), NULL otherwise
+// returns 0 on success, -1 otherwise
+static int create_file(const TableSchema *schema, const char *fileName, const char *magic_num, int aggregate_attribute,
+                       const BPlusKeyFormat *key_format)
 {
     BF_Block *header_block; // block 0 that contains the file header
     BF_Block_Init(&header_block);
@@ -148,12 +175,32 @@ int bplus_create_file(const TableSchema *schema, const char *fileName)
     BPlusMeta *header_temp = malloc(sizeof(BPlusMeta));
     if (!header_temp) return -1;
 
-    memcpy(header_temp->magic_num, BF_MAGIC_NUM, sizeof(BF_MAGIC_NUM));
+    memset(header_temp, 0, sizeof(BPlusMeta));
+    memcpy(header_temp->magic_num, magic_num, sizeof(header_temp->magic_num));
+    header_temp->aggregate_attribute = aggregate_attribute;
+    for (int i = 0; i < MAX_ATTRIBUTES; i++)
+        header_temp->dictionary_blocks[i] = -1; // the dictionaries get their blocks with their first strings
     header_temp->block_count = 1; // including header_block
     header_temp->record_count = 0;
     memcpy(&(header_temp->schema), schema, sizeof(TableSchema));
-    header_temp->max_records_per_block = (int)((BF_BLOCK_SIZE - sizeof(DataNodeHeader) - sizeof(int)) / (sizeof(Record) + sizeof(int)));
-    header_temp->max_indexes_per_block = 1 + (int)((BF_BLOCK_SIZE - sizeof(IndexNodeHeader) - 2 * sizeof(int)) / sizeof(IndexNodeEntry));
+    int record_size = bplus_file_has_pax_layout(header_temp) ? data_block_pax_record_size(header_temp)
+                                                             : (int)sizeof(Record);
+    header_temp->max_records_per_block = (int)((BF_BLOCK_SIZE - sizeof(DataNodeHeader) - sizeof(int)) / (record_size + sizeof(int)));
+    // up to twice the indexes that fit as plain entries (see bplus_index_node.h), so that both halves of a split fit as plain
+    // entries (files made before packed index blocks have the plain capacity, so their index blocks are never packed);
+    // counted (or aggregated) index blocks leave room for fewer plain entries
+    if (aggregate_attribute != -1)
+        header_temp->max_indexes_per_block = 2 * INDEX_BLOCK_AGGREGATED_PLAIN_CAPACITY - 1;
+    else if (bplus_file_has_counts(header_temp))
+        header_temp->max_indexes_per_block = 2 * INDEX_BLOCK_COUNTED_PLAIN_CAPACITY - 1;
+    else
+        header_temp->max_indexes_per_block = 2 * INDEX_BLOCK_PLAIN_CAPACITY - 1;
+    if (key_format) {
+        // keyed index blocks hold as many separators as their bytes fit, so they have no fixed capacity
+        header_temp->key_format = *key_format;
+        header_temp->max_records_per_block = bplus_keyed_data_capacity(key_format);
+        header_temp->max_indexes_per_block = 0;
+    }
     header_temp->root_index = -1; // this means that the B+ tree has currenty no root
 
     memcpy(BF_Block_GetData(header_block), header_temp, sizeof(BPlusMeta)); // memcpy to avoid unaligned address problems
@@ -172,6 +219,82 @@ int bplus_create_file(const TableSchema *schema, const char *fileName)
     return 0;
 }
 
+int bplus_create_file(const TableSchema *schema, const char *fileName)
+{
+    // a LONG key cannot be stored in the int entries of the index blocks, so it makes a LONG key file
+    if (schema->key_index >= 0 && schema->attributes[schema->key_index].type == TYPE_LONG) {
+        BPlusKeyFormat key_format;
+        if (bplus_key_format_init(&key_format, schema, schema->attributes[schema->key_index].name) == -1)
+            return -1;
+        return create_file(schema, fileName, BF_MAGIC_NUM_LONG, -1, &key_format);
+    }
+
+    return create_file(schema, fileName, BF_MAGIC_NUM, -1, NULL);
+}
+
+int bplus_create_counted_file(const TableSchema *schema, const char *fileName)
+{
+    return create_file(schema, fileName, BF_MAGIC_NUM_COUNTED, -1, NULL);
+}
+
+int bplus_create_pax_file(const TableSchema *schema, const char *fileName)
+{
+    return create_file(schema, fileName, BF_MAGIC_NUM_PAX, -1, NULL);
+}
+
+int bplus_create_dictionary_file(const TableSchema *schema, const char *fileName)
+{
+    return create_file(schema, fileName, BF_MAGIC_NUM_DICTIONARY, -1, NULL);
+}
+
+int bplus_create_aggregated_file(const TableSchema *schema, const char *fileName, const char *attr_name)
+{
+    for (int i = 0; i < schema->count; i++) {
+        DataType type = schema->attributes[i].type;
+        if (strcmp(schema->attributes[i].name, attr_name) == 0
+            && (type == TYPE_INT || type == TYPE_LONG || type == TYPE_FLOAT))
+            return create_file(schema, fileName, BF_MAGIC_NUM_AGGREGATED, i, NULL);
+    }
+
+    return -1; // no numeric attribute with that name
+}
+
+int bplus_create_keyed_file(const TableSchema *schema, const char *fileName, const char *key_names)
+{
+    BPlusKeyFormat key_format;
+    if (bplus_key_format_init(&key_format, schema, key_names) == -1)
+        return -1;
+
+    return create_file(schema, fileName, BF_MAGIC_NUM_KEYED, -1, &key_format);
+}
+
+// makes the buffers and BF block handles that bplus_record_insert() uses on the file of handle, for its metadata
+// the arena holds every buffer of one insert: each buffer is taken once by an insert, and reused on every level that
+// a split climbs (see update_parent_index_blocks())
+// returns 0 on success, -1 if unsuccessful
+static int insert_state_init(BPlusHandle *handle, const BPlusMeta *metadata)
+{
+    int max_records = metadata->max_records_per_block;
+    int max_indexes = metadata->max_indexes_per_block;
+
+    size_t capacity = bplus_arena_space(sizeof(BPlusMeta))
+        + 2 * bplus_arena_space(sizeof(DataNodeHeader)) // found_block and new_data_block
+        + 2 * bplus_arena_space(max_records * sizeof(int)) // their index arrays
+        + bplus_arena_space((max_records + 1) * sizeof(Record)) // temp_heap
+        + bplus_arena_space((max_records + 1) * sizeof(int)) // temp_index_array
+        + 4 * bplus_arena_space(sizeof(IndexNodeHeader)) // parent, new parent, index and new index block
+        + 2 * bplus_arena_space((max_indexes + 1) * sizeof(IndexNodeEntry)); // entry arrays
+
+    if (bplus_arena_init(&(handle->insert_arena), capacity) == -1)
+        return -1;
+
+    for (int i = 0; i < BPLUS_INSERT_BLOCK_COUNT; i++)
+        BF_Block_Init(&(handle->insert_blocks[i]));
+    handle->insert_block_count = BPLUS_INSERT_BLOCK_COUNT;
+
+    return 0;
+}
+
 int bplus_open_file(const char *fileName, int *file_desc, BPlusMeta **metadata) {
 
     BF_Block *header_block;
@@ -187,7 +310,7 @@ int bplus_open_file(const char *fileName, int *file_desc, BPlusMeta **metadata)
     // checking magic number
     BPlusMeta *temp = malloc(sizeof(BPlusMeta));
     memcpy(temp, header_data, sizeof(BPlusMeta)); // memcpy to avoid alignment issues
-    int magic_num_is_valid = (memcmp(temp->magic_num, BF_MAGIC_NUM, sizeof(BF_MAGIC_NUM)) == 0);
+    int magic_num_is_valid = bplus_magic_num_is_valid(temp);
     free(temp);
     if (!magic_num_is_valid) return -1;
 
@@ -207,6 +330,21 @@ int bplus_open_file(const char *fileName, int *file_desc, BPlusMeta **metadata)
     BF_Block_Destroy(&header_block);
     header_block = NULL;
 
+    // Starting the runtime state of the file (async lookup queue etc), which is not stored in the file
+    if (bplus_handle_open(*file_desc, fileName) == -1) {
+        free(*metadata);
+        *metadata = NULL;
+        return -1;
+    }
+
+    if (insert_state_init(bplus_handle_get(*file_desc), *metadata) == -1
+        || bplus_dictionary_load(*file_desc, *metadata) == -1) {
+        bplus_handle_close(*file_desc);
+        free(*metadata);
+        *metadata = NULL;
+        return -1;
+    }
+
     // free(header_data);
     // header_data = NULL;
 
@@ -215,14 +353,30 @@ int bplus_open_file(const char *fileName, int *file_desc, BPlusMeta **metadata)
 
 int bplus_close_file(const int file_desc, BPlusMeta *metadata) {
 
-    CALL_BF(BF_CloseFile(file_desc));
+    // Completing any lookups that are still pending, so that no callback is lost
+    bplus_poll(file_desc, 0);
+
+    // A memory-mapped file is not open in BF; dropping its runtime state also unmaps it
+    if (bplus_mmap_is_mapped(bplus_handle_get(file_desc))) {
+        bplus_handle_close(file_desc);
+        free(metadata);
+        return 0;
+    }
+
+    BF_ErrorCode code = BF_CloseFile(file_desc);
+    if (code != BF_OK)
+        BF_PrintError(code);
+
+    // Dropping the runtime state, after BF has written back the file's blocks; this happens even if BF failed to close
+    // the file, so that the handle slot, its descriptors and the metadata copy are not leaked
+    bplus_handle_close(file_desc);
 
     // Since the metadata pointer was used with a *copy* of block 0, which was independent of the Block File Structure,
     // the pointer is freed and set to NULL to avoid issues with memory allocation and pointer dangling
     free(metadata);
     metadata = NULL;
 
-    return 0;
+    return (code == BF_OK) ? 0 : bplus_ERROR;
 }
 
 // helper functions specifically for bplus_record_insert
@@ -234,11 +388,17 @@ struct context {
     BPlusMeta *metadata;
     const Record *record;
 
+    // runtime state of file_desc; the buffers of the context are taken from its insert_arena, and the BF block
+    // handles from its insert_blocks, so that an insert needs no malloc() or free()
+    BPlusHandle *handle;
+
     // variables
     BF_Block *header_block;
     char *header_block_start;
     BPlusMeta *internal_metadata;
 
+    int blocks_modified; // set once the insert starts changing blocks; until then, the pinned blocks are left clean
+
     int inserted_key;
     int inserted_block_index;
 
@@ -283,91 +443,130 @@ struct context {
     IndexNodeHeader *new_index_block_header;
 
     IndexNodeEntry *temp_entry_array;
+    int temp_entry_count;
+
+    // records under the two blocks of the last split (the old one and the new one), which become the counts (and
+    // aggregates) of their entries in the parent index block
+    BPlusAggregate split_left;
+    BPlusAggregate split_right;
 };
 
+// returns a BF block handle for the insert of ctx, taken from the file's insert_blocks (instead of BF_Block_Init())
+// returns NULL if all are in use
+BF_Block *context_take_block(struct context *ctx)
+{
+    if (ctx->handle->insert_block_count == 0)
+        return NULL;
+
+    return ctx->handle->insert_blocks[--(ctx->handle->insert_block_count)];
+}
+
+// gives back a block handle taken with context_take_block() (instead of BF_Block_Destroy()), and sets *block to NULL
+void context_release_block(struct context *ctx, BF_Block **block)
+{
+    ctx->handle->insert_blocks[(ctx->handle->insert_block_count)++] = *block;
+    *block = NULL;
+}
+
+// returns size bytes for the insert of ctx, taken from the file's insert_arena (instead of malloc())
+// they are all freed at once by cleanup_context()
+// returns NULL if unsuccessful
+void *context_alloc(struct context *ctx, size_t size)
+{
+    return bplus_arena_alloc(&(ctx->handle->insert_arena), size);
+}
+
+// copies the header of the index block at block_start to *header, which is taken from the insert arena if it is NULL
+// (a header buffer is allocated once per insert, and reused on every level of a split)
+// returns 0 on success, -1 if unsuccessful
+int context_read_index_header(struct context *ctx, IndexNodeHeader **header, const char *block_start)
+{
+    if (!(*header))
+        *header = context_alloc(ctx, sizeof(IndexNodeHeader));
+    if (!(*header))
+        return -1;
+
+    index_block_copy_header(block_start, *header);
+    return 0;
+}
+
 void cleanup_context(struct context *ctx)
 {
     // setting dirty, unpinning and destroying (conditionally)
+    // blocks are set dirty only if the insert has modified any; an insert that fails early (e.g. duplicate key)
+    // has only read them, so it must not make BF write them back on eviction
     // all the following BF_Block pointers are initialized to NULL at the very start
-    // if any of them is not NULL, they have been changed by helper functions and it is safe to BF_Block_Destroy them
-    // else, destroying NULL block pointers is undefined, so it is avoided
+    // if any of them is not NULL, it was taken by a helper function with context_take_block() and must be given back
     if (ctx->header_block) {
-        BF_Block_SetDirty(ctx->header_block);
+        if (ctx->blocks_modified)
+            BF_Block_SetDirty(ctx->header_block);
         BF_UnpinBlock(ctx->header_block);
-        BF_Block_Destroy(&(ctx->header_block));
+        context_release_block(ctx, &(ctx->header_block));
     }
 
     if (ctx->found_block) {
-        BF_Block_SetDirty(ctx->found_block);
+        if (ctx->blocks_modified)
+            BF_Block_SetDirty(ctx->found_block);
         BF_UnpinBlock(ctx->found_block);
-        BF_Block_Destroy(&(ctx->found_block));
+        context_release_block(ctx, &(ctx->found_block));
     }
 
     if (ctx->new_data_block) {
-        BF_Block_SetDirty(ctx->new_data_block);
+        if (ctx->blocks_modified)
+            BF_Block_SetDirty(ctx->new_data_block);
         BF_UnpinBlock(ctx->new_data_block);
-        BF_Block_Destroy(&(ctx->new_data_block));
+        context_release_block(ctx, &(ctx->new_data_block));
     }
 
     if (ctx->parent_index_block) {
-        BF_Block_SetDirty(ctx->parent_index_block);
+        if (ctx->blocks_modified)
+            BF_Block_SetDirty(ctx->parent_index_block);
         BF_UnpinBlock(ctx->parent_index_block);
-        BF_Block_Destroy(&(ctx->parent_index_block));
+        context_release_block(ctx, &(ctx->parent_index_block));
     }
 
     if (ctx->new_parent_index_block) {
-        BF_Block_SetDirty(ctx->new_parent_index_block);
+        if (ctx->blocks_modified)
+            BF_Block_SetDirty(ctx->new_parent_index_block);
         BF_UnpinBlock(ctx->new_parent_index_block);
-        BF_Block_Destroy(&(ctx->new_parent_index_block));
+        context_release_block(ctx, &(ctx->new_parent_index_block));
     }
 
     if (ctx->index_block) {
-        BF_Block_SetDirty(ctx->index_block);
+        if (ctx->blocks_modified)
+            BF_Block_SetDirty(ctx->index_block);
         BF_UnpinBlock(ctx->index_block);
-        BF_Block_Destroy(&(ctx->index_block));
+        context_release_block(ctx, &(ctx->index_block));
     }
 
     if (ctx->new_index_block) {
-        BF_Block_SetDirty(ctx->new_index_block);
+        if (ctx->blocks_modified)
+            BF_Block_SetDirty(ctx->new_index_block);
         BF_UnpinBlock(ctx->new_index_block);
-        BF_Block_Destroy(&(ctx->new_index_block));
+        context_release_block(ctx, &(ctx->new_index_block));
     }  
     
     // memory cleanup
-    // the following pointers are all initialized to NULL at the very start
-    // if any is not NULL, it has been changed by helper functions and free is safe with that
-    // else, free(NULL) is also safe
-    free(ctx->internal_metadata);
-
-    free(ctx->found_block_header);
-    free(ctx->found_block_index_array);
-
-    free(ctx->temp_heap);
-    free(ctx->temp_index_array);
-
-    free(ctx->new_data_block_header);
-    free(ctx->new_data_block_index_array);
-
-    free(ctx->parent_index_block_header);
-    free(ctx->parent_index_block_entry_array);
-
-    free(ctx->new_parent_index_block_header);
+    // every buffer of the context was taken from the insert arena, so they are all freed at once
+    bplus_arena_reset(&(ctx->handle->insert_arena));
 
-    free(ctx->index_block_header);
-
-    free(ctx->new_index_block_header);
-
-    free(ctx->temp_entry_array);
+    // a helper that failed in a BF call may have returned without giving back a block handle of its own; it is
+    // replaced, so that the next insert has all of them (this only happens on errors)
+    while (ctx->handle->insert_block_count < BPLUS_INSERT_BLOCK_COUNT)
+        BF_Block_Init(&(ctx->handle->insert_blocks[(ctx->handle->insert_block_count)++]));
 }
 
 int load_internal_metadata(struct context *ctx)
 {
     // getting block 0 and the internal_metadata
-    BF_Block_Init(&(ctx->header_block));
+    ctx->header_block = context_take_block(ctx);
+    if (!(ctx->header_block))
+        return -1;
 
     CALL_BF(BF_GetBlock(ctx->file_desc, 0, ctx->header_block));
     ctx->header_block_start = BF_Block_GetData(ctx->header_block);
-    ctx->internal_metadata = malloc(sizeof(BPlusMeta));
+    bplus_handle_touch(ctx->file_desc, 0, BPLUS_ACCESS_NORMAL);
+    ctx->internal_metadata = context_alloc(ctx, sizeof(BPlusMeta));
     if (!(ctx->internal_metadata))
         return -1;
 
@@ -378,8 +577,9 @@ int load_internal_metadata(struct context *ctx)
 int create_data_block_root(struct context *ctx)
 {
     // there is no root, so it must be made as a data block, which will store the record directly
-    BF_Block *root_block;
-    BF_Block_Init(&root_block);
+    BF_Block *root_block = context_take_block(ctx);
+    if (!root_block)
+        return -1;
 
     // allocating the new block
     CALL_BF(BF_AllocateBlock(ctx->file_desc, root_block));
@@ -388,6 +588,7 @@ int create_data_block_root(struct context *ctx)
     // updating internal_metadata
     ctx->internal_metadata->block_count++;
     ctx->internal_metadata->record_count++;
+    ctx->internal_metadata->modification_count++;
     ctx->internal_metadata->root_index = ctx->internal_metadata->block_count - 1;
     memcpy(ctx->header_block_start, ctx->internal_metadata, sizeof(BPlusMeta));
     memcpy(ctx->metadata, ctx->internal_metadata, sizeof(BPlusMeta)); // updating the external metadata
@@ -398,30 +599,25 @@ int create_data_block_root(struct context *ctx)
     // writing the block's header
     set_data_block(root_block_start);
 
-    DataNodeHeader *root_block_header = malloc(sizeof(DataNodeHeader));
-    if (!root_block_header)
-        return -1;
-    
-    root_block_header->record_count = 1;
-    root_block_header->parent_index = -1; // root has no parent
-    root_block_header->next_index = -1; // no siblings
-    root_block_header->min_record_key = ctx->inserted_key;
+    DataNodeHeader root_block_header;
+    root_block_header.record_count = 1;
+    root_block_header.parent_index = -1; // root has no parent
+    root_block_header.next_index = -1; // no siblings
+    root_block_header.min_record_key = ctx->inserted_key;
 
-    data_block_write_header(root_block_start, root_block_header);
+    data_block_write_header(root_block_start, &root_block_header);
 
     // writing the block's first record (in heap and index array)
     if (data_block_write_unordered_record(root_block_start, ctx->internal_metadata, 0, ctx->record) == -1) {
         CALL_BF(BF_UnpinBlock(root_block));
-        BF_Block_Destroy(&root_block);
-        free(root_block_header);
+        context_release_block(ctx, &root_block);
         return -1;
     }
 
-    int *root_index_array = malloc(ctx->internal_metadata->max_records_per_block * sizeof(int));
+    int *root_index_array = context_alloc(ctx, ctx->internal_metadata->max_records_per_block * sizeof(int));
     if (!root_index_array) {
         CALL_BF(BF_UnpinBlock(root_block));
-        BF_Block_Destroy(&root_block);
-        free(root_block_header);
+        context_release_block(ctx, &root_block);
         return -1;
     }
     
@@ -430,19 +626,19 @@ int create_data_block_root(struct context *ctx)
 
     BF_Block_SetDirty(root_block);
     CALL_BF(BF_UnpinBlock(root_block));
-    BF_Block_Destroy(&root_block);
-    free(root_block_header);
-    free(root_index_array);
+    context_release_block(ctx, &root_block);
     return 0;
 }
 
 int find_matching_data_block(struct context *ctx)
 {
     // searching for the data block that could contain a record with inserted_key as PK
-    BF_Block_Init(&(ctx->found_block)); // initializing the data block that the search will find
+    ctx->found_block = context_take_block(ctx); // the data block handle that the search will fill
+    if (!(ctx->found_block))
+        return -1;
 
-    if (tree_search_data_block(ctx->internal_metadata->root_index, ctx->inserted_key,
-            ctx->file_desc, ctx->found_block, &(ctx->found_block_index)) == -1
+    if (bplus_finger_search_data_block(ctx->file_desc, ctx->internal_metadata, ctx->inserted_key,
+            ctx->found_block, &(ctx->found_block_index)) == -1
     ) return -1;
 
     return 0;
@@ -451,11 +647,13 @@ int find_matching_data_block(struct context *ctx)
 int find_data_block_insert_pos(struct context *ctx)
 {
     ctx->found_block_start = BF_Block_GetData(ctx->found_block);
-    ctx->found_block_header = data_block_read_header(ctx->found_block_start);
+    ctx->found_block_header = context_alloc(ctx, sizeof(DataNodeHeader));
     if (!(ctx->found_block_header)) return -1;
+    data_block_copy_header(ctx->found_block_start, ctx->found_block_header);
 
-    ctx->found_block_index_array = data_block_read_index_array(ctx->found_block_start, ctx->internal_metadata);
+    ctx->found_block_index_array = context_alloc(ctx, ctx->internal_metadata->max_records_per_block * sizeof(int));
     if (!(ctx->found_block_index_array)) return -1;
+    data_block_copy_index_array(ctx->found_block_start, ctx->internal_metadata, ctx->found_block_index_array);
 
     // searching for the position that the record could be inserted at
     ctx->found_block_insert_pos = data_block_search_insert_pos(ctx->found_block_start, ctx->found_block_header,
@@ -467,10 +665,50 @@ int find_data_block_insert_pos(struct context *ctx)
     return 0;
 }
 
+// adds the inserted record to the counts (and aggregates) of the children that lead to it, in the index block with
+// index_block_index and in all its ancestors; this is how an insert that stops splitting updates the counts above it
+// it does nothing if the file has no subtree counts
+// returns 0 on success, -1 if unsuccessful
+int add_to_ancestor_aggregates(struct context *ctx, int index_block_index)
+{
+    if (!bplus_file_has_counts(ctx->internal_metadata) || index_block_index == -1)
+        return 0;
+
+    int attribute = bplus_aggregate_attribute(ctx->internal_metadata);
+    DataType type = (attribute == -1) ? TYPE_INT : ctx->internal_metadata->schema.attributes[attribute].type;
+    BPlusAggregate delta;
+    bplus_aggregate_init(&delta);
+    bplus_aggregate_add_record(&delta, &(ctx->internal_metadata->schema), attribute, ctx->record);
+
+    int key = record_get_key(&(ctx->internal_metadata->schema), ctx->record); // inserted_key may be a child's key now
+    BF_Block *temp_block = context_take_block(ctx);
+    if (!temp_block)
+        return -1;
+
+    while (index_block_index != -1) {
+        CALL_BF(BF_GetBlock(ctx->file_desc, index_block_index, temp_block));
+        char *temp_block_start = BF_Block_GetData(temp_block);
+
+        index_block_add_to_aggregate(temp_block_start, index_block_find_child_position(temp_block_start, key), &delta,
+                                     type);
+
+        IndexNodeHeader temp_block_header;
+        index_block_copy_header(temp_block_start, &temp_block_header);
+        index_block_index = temp_block_header.parent_index;
+
+        BF_Block_SetDirty(temp_block);
+        CALL_BF(BF_UnpinBlock(temp_block));
+    }
+
+    context_release_block(ctx, &temp_block);
+    return 0;
+}
+
 int insert_record_to_data_block(struct context *ctx)
 {
     ctx->found_block_header->record_count++;
     ctx->internal_metadata->record_count++;
+    ctx->internal_metadata->modification_count++;
     memcpy(ctx->header_block_start, ctx->internal_metadata, sizeof(BPlusMeta));
     memcpy(ctx->metadata, ctx->internal_metadata, sizeof(BPlusMeta)); // updating the external metadata
 
@@ -497,10 +735,11 @@ int insert_record_to_data_block(struct context *ctx)
         // if the data block has a parent (an index node), the parent's min key must also be updated
         // that update must "bubble up" from parent to parent, to the root
         if (ctx->found_block_header->parent_index != -1) {
-            BF_Block *temp_block;
-            BF_Block_Init(&temp_block);
+            BF_Block *temp_block = context_take_block(ctx);
+            if (!temp_block)
+                return -1;
             bubble_up_min_record_key(ctx->found_block_header->parent_index, ctx->inserted_key, ctx->file_desc, temp_block);
-            BF_Block_Destroy(&temp_block);
+            context_release_block(ctx, &temp_block);
         }
     }
 
@@ -517,7 +756,7 @@ int insert_record_to_data_block(struct context *ctx)
 int prepare_for_new_data_block(struct context *ctx)
 {
     // creating a temp_heap with one more space than found block's heap
-    ctx->temp_heap = malloc((ctx->internal_metadata->max_records_per_block + 1) * sizeof(Record));
+    ctx->temp_heap = context_alloc(ctx, (ctx->internal_metadata->max_records_per_block + 1) * sizeof(Record));
     if (!(ctx->temp_heap)) return -1;
 
     // copying found block's heap to temp_heap, leaving the last element empty
@@ -527,7 +766,7 @@ int prepare_for_new_data_block(struct context *ctx)
     memcpy(&(ctx->temp_heap[ctx->internal_metadata->max_records_per_block]), ctx->record, sizeof(Record));
 
     // creating a temp_index_array with one more space than found block's index array
-    ctx->temp_index_array = malloc((ctx->internal_metadata->max_records_per_block + 1) * sizeof(int));
+    ctx->temp_index_array = context_alloc(ctx, (ctx->internal_metadata->max_records_per_block + 1) * sizeof(int));
     if (!(ctx->temp_index_array)) return -1;
 
     // copying found block's index array to temp_index_array, leaving the last element empty
@@ -553,7 +792,9 @@ int prepare_for_new_data_block(struct context *ctx)
 
 int create_new_data_block(struct context *ctx)
 {
-    BF_Block_Init(&(ctx->new_data_block));
+    ctx->new_data_block = context_take_block(ctx);
+    if (!(ctx->new_data_block))
+        return -1;
 
     // allocating the new block and getting its data
     CALL_BF(BF_AllocateBlock(ctx->file_desc, ctx->new_data_block));
@@ -562,6 +803,7 @@ int create_new_data_block(struct context *ctx)
     // updating metadata
     ctx->internal_metadata->block_count++;
     ctx->internal_metadata->record_count++;
+    ctx->internal_metadata->modification_count++;
     memcpy(ctx->header_block_start, ctx->internal_metadata, sizeof(BPlusMeta));
     memcpy(ctx->metadata, ctx->internal_metadata, sizeof(BPlusMeta)); // updating the external metadata
 
@@ -571,11 +813,11 @@ int create_new_data_block(struct context *ctx)
     // setting to data block and allocating header and index array
     set_data_block(ctx->new_data_block_start);
 
-    ctx->new_data_block_header = malloc(sizeof(DataNodeHeader));
+    ctx->new_data_block_header = context_alloc(ctx, sizeof(DataNodeHeader));
     if (!(ctx->new_data_block_header))
         return -1;
 
-    ctx->new_data_block_index_array = malloc(ctx->internal_metadata->max_records_per_block * sizeof(int));
+    ctx->new_data_block_index_array = context_alloc(ctx, ctx->internal_metadata->max_records_per_block * sizeof(int));
     if (!(ctx->new_data_block_index_array))
         return -1;
 
@@ -589,6 +831,11 @@ int split_content_between_data_blocks(struct context *ctx)
     int first_half_count = ctx->second_half_start;
     int second_half_count = (ctx->internal_metadata->max_records_per_block + 1) - first_half_count;
 
+    // the counts (and aggregates) of the halves, for their entries in the parent
+    int attribute = bplus_aggregate_attribute(ctx->internal_metadata);
+    bplus_aggregate_init(&(ctx->split_left));
+    bplus_aggregate_init(&(ctx->split_right));
+
     // finding in which block index the inserted record is to go
     int first_key_in_second_half = record_get_key(&(ctx->internal_metadata->schema),
                                         &(ctx->temp_heap[ctx->temp_index_array[ctx->second_half_start]]));
@@ -604,6 +851,7 @@ int split_content_between_data_blocks(struct context *ctx)
         // overwriting the old heap
         if (data_block_write_unordered_record(ctx->found_block_start, ctx->internal_metadata, i, rec) == -1)
             return -1;
+        bplus_aggregate_add_record(&(ctx->split_left), &(ctx->internal_metadata->schema), attribute, rec);
 
         ctx->found_block_index_array[i] = i;
     }
@@ -618,6 +866,7 @@ int split_content_between_data_blocks(struct context *ctx)
         // writing to the new block's heap
         if (data_block_write_unordered_record(ctx->new_data_block_start, ctx->internal_metadata, local_i, rec) == -1)
             return -1;
+        bplus_aggregate_add_record(&(ctx->split_right), &(ctx->internal_metadata->schema), attribute, rec);
 
         ctx->new_data_block_index_array[local_i] = local_i;
     }
@@ -641,10 +890,11 @@ int split_content_between_data_blocks(struct context *ctx)
         ctx->found_block_header->min_record_key = found_block_new_min_record_key;
 
         if (ctx->found_block_header->parent_index != -1) {
-            BF_Block *temp_block;
-            BF_Block_Init(&temp_block);
+            BF_Block *temp_block = context_take_block(ctx);
+            if (!temp_block)
+                return -1;
             bubble_up_min_record_key(ctx->found_block_header->parent_index, found_block_new_min_record_key, ctx->file_desc, temp_block);
-            BF_Block_Destroy(&temp_block);
+            context_release_block(ctx, &temp_block);
         }
     }
 
@@ -654,9 +904,7 @@ int split_content_between_data_blocks(struct context *ctx)
     data_block_write_header(ctx->found_block_start, ctx->found_block_header);
     data_block_write_header(ctx->new_data_block_start, ctx->new_data_block_header);
 
-    // freeing temp_heap and temp_index_array because they have no more use
-    free(ctx->temp_heap);
-    free(ctx->temp_index_array);
+    // dropping temp_heap and temp_index_array because they have no more use (the arena frees them with the context)
     ctx->temp_heap = NULL;
     ctx->temp_index_array = NULL;
 
@@ -665,8 +913,9 @@ int split_content_between_data_blocks(struct context *ctx)
 
 int create_index_block_root_above_data_blocks(struct context *ctx)
 {
-    BF_Block *root_index_block;
-    BF_Block_Init(&root_index_block);
+    BF_Block *root_index_block = context_take_block(ctx);
+    if (!root_index_block)
+        return -1;
 
     CALL_BF(BF_AllocateBlock(ctx->file_desc, root_index_block));
     char *root_index_block_start = BF_Block_GetData(root_index_block);
@@ -678,33 +927,29 @@ int create_index_block_root_above_data_blocks(struct context *ctx)
     memcpy(ctx->metadata, ctx->internal_metadata, sizeof(BPlusMeta)); // updating the external metadata
 
     // updating the block's header
-    set_index_block(root_index_block_start);
+    set_index_block(root_index_block_start, bplus_file_index_block_type(ctx->internal_metadata));
 
-    IndexNodeHeader *root_index_block_header = malloc(sizeof(IndexNodeHeader));
-    if (!root_index_block_header) {
-        CALL_BF(BF_UnpinBlock(root_index_block));
-        BF_Block_Destroy(&root_index_block);
-        return -1;
-    }
-    
-    root_index_block_header->index_count = 2;
-    root_index_block_header->parent_index = -1; // root has no parent
-    // root_index_block_header->min_record_key is updated later **internally** by index_block_write_array_as_entries()
+    IndexNodeHeader root_index_block_header;
+    root_index_block_header.index_count = 2;
+    root_index_block_header.parent_index = -1; // root has no parent
+    // root_index_block_header.min_record_key is updated later **internally** by index_block_write_array_as_entries()
 
     // assigning the entries and lefmost index
     IndexNodeEntry entry_array[2];
 
     entry_array[0].key = ctx->found_block_header->min_record_key; // this will become min key of root_index_block
     entry_array[0].right_index = ctx->found_block_index; // this will become leftmost index of root_index_block
+    entry_array[0].aggregate = ctx->split_left;
 
     entry_array[1].key = ctx->new_data_block_header->min_record_key; // this will be the first key in root_index_block
     entry_array[1].right_index = ctx->new_data_block_index; // this will be the index in the right of the first key
+    entry_array[1].aggregate = ctx->split_right;
 
     // writing back both leftmost index and entries, which is done in this one call
-    index_block_write_array_as_entries(root_index_block_start, root_index_block_header, entry_array, 2);
+    index_block_write_array_as_entries(root_index_block_start, &root_index_block_header, entry_array, 2);
 
     // writing back the header
-    index_block_write_header(root_index_block_start, root_index_block_header);
+    index_block_write_header(root_index_block_start, &root_index_block_header);
 
     // updating the data block children to point to the new root
     ctx->found_block_header->parent_index = ctx->internal_metadata->root_index;
@@ -715,23 +960,23 @@ int create_index_block_root_above_data_blocks(struct context *ctx)
 
     BF_Block_SetDirty(root_index_block);
     CALL_BF(BF_UnpinBlock(root_index_block));
-    BF_Block_Destroy(&root_index_block);
-    free(root_index_block_header);
+    context_release_block(ctx, &root_index_block);
     return 0;
 }
 
 int initialize_parent_index_block(struct context *ctx)
 {
     // getting the parent of found block
-    BF_Block_Init(&(ctx->parent_index_block));
+    ctx->parent_index_block = context_take_block(ctx);
+    if (!(ctx->parent_index_block))
+        return -1;
     CALL_BF(BF_GetBlock(ctx->file_desc, ctx->found_block_header->parent_index, ctx->parent_index_block));
     ctx->parent_index_block_start = BF_Block_GetData(ctx->parent_index_block);
 
     ctx->parent_index_block_index = ctx->found_block_header->parent_index;
 
     // getting the header
-    ctx->parent_index_block_header = index_block_read_header(ctx->parent_index_block_start);
-    if (!(ctx->parent_index_block_header))
+    if (context_read_index_header(ctx, &(ctx->parent_index_block_header), ctx->parent_index_block_start) == -1)
         return -1;
 
     return 0;
@@ -759,15 +1004,16 @@ int find_index_block_insert_pos(struct context *ctx)
 
 int insert_index_to_index_block(struct context *ctx)
 {
-    ctx->parent_index_block_header->index_count++;
-    index_block_write_header(ctx->parent_index_block_start, ctx->parent_index_block_header);
-
-    // getting the entry array
-    ctx->parent_index_block_entry_array = malloc(ctx->parent_index_block_header->index_count * sizeof(IndexNodeEntry));
+    // getting the entry array, with space for the new entry
+    ctx->parent_index_block_entry_array = context_alloc(ctx, (ctx->parent_index_block_header->index_count + 1) * sizeof(IndexNodeEntry));
     if (!(ctx->parent_index_block_entry_array))
         return -1;
 
+    // the entries are read before the count is, as the block may grow out of the plain entry format
     index_block_read_entries_as_array(ctx->parent_index_block_start, ctx->parent_index_block_header, ctx->parent_index_block_entry_array);
+
+    ctx->parent_index_block_header->index_count++;
+    index_block_write_header(ctx->parent_index_block_start, ctx->parent_index_block_header);
     
     // shifting the entries of entry array starting from position parent_index_block_insert_pos, to make space for the new entry
     memmove(
@@ -776,13 +1022,15 @@ int insert_index_to_index_block(struct context *ctx)
         (ctx->parent_index_block_header->index_count - 1 - ctx->parent_index_block_insert_pos) * sizeof(IndexNodeEntry)
     );
 
-    // writing the new entry in entry array's insert position
+    // writing the new entry in entry array's insert position; the split child is the entry before it
     IndexNodeEntry inserted_entry;
     inserted_entry.key = ctx->inserted_key;
     if (ctx->parent_index_block_has_data_block_children)
         inserted_entry.right_index = ctx->new_data_block_index;
     else
         inserted_entry.right_index = ctx->new_index_block_index;
+    inserted_entry.aggregate = ctx->split_right;
+    ctx->parent_index_block_entry_array[ctx->parent_index_block_insert_pos - 1].aggregate = ctx->split_left;
 
     memcpy(&(ctx->parent_index_block_entry_array[ctx->parent_index_block_insert_pos]), &inserted_entry, sizeof(IndexNodeEntry));
 
@@ -807,8 +1055,9 @@ int prepare_for_new_parent_index_block(struct context *ctx)
 {
     // find start of second block
 
-    // allocating temp_entry_array to hold one more entry
-    ctx->temp_entry_array = malloc((ctx->internal_metadata->max_indexes_per_block + 1) * sizeof(IndexNodeEntry));
+    // allocating temp_entry_array to hold one more entry; it is allocated on the first level of a split and reused on the next ones
+    if (!(ctx->temp_entry_array))
+        ctx->temp_entry_array = context_alloc(ctx, (ctx->internal_metadata->max_indexes_per_block + 1) * sizeof(IndexNodeEntry));
     if (!(ctx->temp_entry_array))
         return -1;
 
@@ -823,27 +1072,34 @@ int prepare_for_new_parent_index_block(struct context *ctx)
         (ctx->parent_index_block_header->index_count - ctx->parent_index_block_insert_pos) * sizeof(IndexNodeEntry)
     );
 
-    // writing the new entry in temp_entry_array's insert position
+    // writing the new entry in temp_entry_array's insert position; the split child is the entry before it
     IndexNodeEntry inserted_entry;
     inserted_entry.key = ctx->inserted_key;
     if (ctx->parent_index_block_has_data_block_children)
         inserted_entry.right_index = ctx->new_data_block_index;
     else
         inserted_entry.right_index = ctx->new_index_block_index;
+    inserted_entry.aggregate = ctx->split_right;
+    ctx->temp_entry_array[ctx->parent_index_block_insert_pos - 1].aggregate = ctx->split_left;
 
     memcpy(&(ctx->temp_entry_array[ctx->parent_index_block_insert_pos]), &inserted_entry, sizeof(IndexNodeEntry));
 
+    // a packed block can be full before max_indexes_per_block, so the split is of the entries that it has
+    ctx->temp_entry_count = ctx->parent_index_block_header->index_count + 1;
+
     // defining the first position of temp_entry_array from which the new index block (to be made) will start
     // the first half will be larger by 1 or equal to the second half
-    ctx->second_half_start = get_ceiling((ctx->internal_metadata->max_indexes_per_block + 1) / 2.0f);
+    ctx->second_half_start = get_ceiling(ctx->temp_entry_count / 2.0f);
 
     return 0;
 }
 
 int create_new_parent_index_block(struct context *ctx)
 {
-    BF_Block_Init(&(ctx->new_parent_index_block));
-    
+    ctx->new_parent_index_block = context_take_block(ctx);
+    if (!(ctx->new_parent_index_block))
+        return -1;
+
     // allocating the new index block
     CALL_BF(BF_AllocateBlock(ctx->file_desc, ctx->new_parent_index_block));
     ctx->new_parent_index_block_start = BF_Block_GetData(ctx->new_parent_index_block);
@@ -857,9 +1113,10 @@ int create_new_parent_index_block(struct context *ctx)
     ctx->new_parent_index_block_index = ctx->internal_metadata->block_count - 1;
 
     // setting to index block and allocating header
-    set_index_block(ctx->new_parent_index_block_start);
+    set_index_block(ctx->new_parent_index_block_start, bplus_file_index_block_type(ctx->internal_metadata));
 
-    ctx->new_parent_index_block_header = malloc(sizeof(IndexNodeHeader));
+    if (!(ctx->new_parent_index_block_header)) // reused on the next levels of a split
+        ctx->new_parent_index_block_header = context_alloc(ctx, sizeof(IndexNodeHeader));
     if (!(ctx->new_parent_index_block_header))
         return -1;
 
@@ -868,12 +1125,10 @@ int create_new_parent_index_block(struct context *ctx)
 
 int split_content_between_index_blocks(struct context *ctx)
 {
-    // free temp_entry_array and don't forget to NULL it
-
     // the first (old) index block is parent_index_block and second (new) index block is new_parent_index_block
 
     int first_half_count = ctx->second_half_start;
-    int second_half_count = (ctx->internal_metadata->max_indexes_per_block + 1) - first_half_count;
+    int second_half_count = ctx->temp_entry_count - first_half_count;
 
     // finding in which index block index the inserted entry is to go
     int inserted_entry_block_index;
@@ -891,6 +1146,18 @@ int split_content_between_index_blocks(struct context *ctx)
     index_block_write_array_as_entries(ctx->new_parent_index_block_start, ctx->new_parent_index_block_header,
         &(ctx->temp_entry_array[ctx->second_half_start]), second_half_count);
 
+    // the records under each half, for their entries in the parent
+    int attribute = bplus_aggregate_attribute(ctx->internal_metadata);
+    DataType type = (attribute == -1) ? TYPE_INT : ctx->internal_metadata->schema.attributes[attribute].type;
+    bplus_aggregate_init(&(ctx->split_left));
+    bplus_aggregate_init(&(ctx->split_right));
+    for (int i = 0; i < ctx->temp_entry_count; i++) {
+        if (i < ctx->second_half_start)
+            bplus_aggregate_merge(&(ctx->split_left), &(ctx->temp_entry_array[i].aggregate), type);
+        else
+            bplus_aggregate_merge(&(ctx->split_right), &(ctx->temp_entry_array[i].aggregate), type);
+    }
+
     // updating headers for parent_index_block and new_parent_index_block
     ctx->parent_index_block_header->index_count = first_half_count;
     ctx->new_parent_index_block_header->index_count = second_half_count;
@@ -909,101 +1176,89 @@ int split_content_between_index_blocks(struct context *ctx)
         ctx->new_data_block_header->parent_index = inserted_entry_block_index;
         data_block_write_header(ctx->new_data_block_start, ctx->new_data_block_header);
 
-        // unpinning and destroying found_block and new_data_block, and freeing related data, as they are needed no more;
+        // unpinning and releasing found_block and new_data_block, and dropping related data, as they are needed no more;
         // this is also done to consistently pin and unpin all children of new_parent_index_block,
         // as "double pin" has unspecified behavior
         BF_Block_SetDirty(ctx->found_block);
         BF_UnpinBlock(ctx->found_block);
-        BF_Block_Destroy(&(ctx->found_block));
-        free(ctx->found_block_header);
-        free(ctx->found_block_index_array);
-        ctx->found_block = NULL;
+        context_release_block(ctx, &(ctx->found_block));
         ctx->found_block_header = NULL;
         ctx->found_block_index_array = NULL;
 
         BF_Block_SetDirty(ctx->new_data_block);
         BF_UnpinBlock(ctx->new_data_block);
-        BF_Block_Destroy(&(ctx->new_data_block));
-        free(ctx->new_data_block_header);
-        free(ctx->new_data_block_index_array);
-        ctx->new_data_block = NULL;
+        context_release_block(ctx, &(ctx->new_data_block));
         ctx->new_data_block_header = NULL;
         ctx->new_data_block_index_array = NULL;
 
         // updating header of all new_parent_index_block's children
-        BF_Block *temp_block;
-        BF_Block_Init(&temp_block);
+        BF_Block *temp_block = context_take_block(ctx);
+        if (!temp_block)
+            return -1;
 
-        for (int i = ctx->second_half_start; i < ctx->internal_metadata->max_indexes_per_block + 1; i++) {
+        for (int i = ctx->second_half_start; i < ctx->temp_entry_count; i++) {
             CALL_BF(BF_GetBlock(ctx->file_desc, ctx->temp_entry_array[i].right_index, temp_block));
             char *temp_block_start = BF_Block_GetData(temp_block);
 
-            DataNodeHeader *temp_block_header = data_block_read_header(temp_block_start);
-            if (!temp_block_header) return -1;
+            DataNodeHeader temp_block_header;
+            data_block_copy_header(temp_block_start, &temp_block_header);
 
-            temp_block_header->parent_index = ctx->new_parent_index_block_index;
-            data_block_write_header(temp_block_start, temp_block_header);
+            temp_block_header.parent_index = ctx->new_parent_index_block_index;
+            data_block_write_header(temp_block_start, &temp_block_header);
+            BF_Block_SetDirty(temp_block);
 
-            free(temp_block_header);
             CALL_BF(BF_UnpinBlock(temp_block));
         }
 
-        BF_Block_Destroy(&temp_block);
+        context_release_block(ctx, &temp_block);
     }
     else {
         // updating header of the inserted child
         ctx->new_index_block_header->parent_index = inserted_entry_block_index;
         index_block_write_header(ctx->new_index_block_start, ctx->new_index_block_header);
 
-        // unpinning and destroying index_block and new_index_block, and freeing related data, as they are needed no more;
+        // unpinning and releasing index_block and new_index_block, as they are needed no more (their header buffers are
+        // reused by update_parent_index_blocks());
         // this is also done to consistently pin and unpin all children of new_parent_index_block,
         // as "double pin" has unspecified behavior
         BF_Block_SetDirty(ctx->index_block);
         BF_UnpinBlock(ctx->index_block);
-        BF_Block_Destroy(&(ctx->index_block));
-        free(ctx->index_block_header);
-        ctx->index_block = NULL;
-        ctx->index_block_header = NULL;
+        context_release_block(ctx, &(ctx->index_block));
 
         BF_Block_SetDirty(ctx->new_index_block);
         BF_UnpinBlock(ctx->new_index_block);
-        BF_Block_Destroy(&(ctx->new_index_block));
-        free(ctx->new_index_block_header);
-        ctx->new_index_block = NULL;
-        ctx->new_index_block_header = NULL;
+        context_release_block(ctx, &(ctx->new_index_block));
 
         // updating header of all new_parent_index_block's children
-        BF_Block *temp_block;
-        BF_Block_Init(&temp_block);
+        BF_Block *temp_block = context_take_block(ctx);
+        if (!temp_block)
+            return -1;
 
-        for (int i = ctx->second_half_start; i < ctx->internal_metadata->max_indexes_per_block + 1; i++) {
+        for (int i = ctx->second_half_start; i < ctx->temp_entry_count; i++) {
             CALL_BF(BF_GetBlock(ctx->file_desc, ctx->temp_entry_array[i].right_index, temp_block));
             char *temp_block_start = BF_Block_GetData(temp_block);
 
-            IndexNodeHeader *temp_block_header = index_block_read_header(temp_block_start);
-            if (!temp_block_header) return -1;
+            IndexNodeHeader temp_block_header;
+            index_block_copy_header(temp_block_start, &temp_block_header);
 
-            temp_block_header->parent_index = ctx->new_parent_index_block_index;
-            index_block_write_header(temp_block_start, temp_block_header);
+            temp_block_header.parent_index = ctx->new_parent_index_block_index;
+            index_block_write_header(temp_block_start, &temp_block_header);
+            BF_Block_SetDirty(temp_block);
 
-            free(temp_block_header);
             CALL_BF(BF_UnpinBlock(temp_block));
         }
 
-        BF_Block_Destroy(&temp_block);
+        context_release_block(ctx, &temp_block);
     }
 
-    // freeing temp_entry_array as it is not needed anymore
-    free(ctx->temp_entry_array);
-    ctx->temp_entry_array = NULL;
-
     return 0;
 }
 
 int create_index_block_root_above_index_blocks(struct context *ctx)
 {
-    BF_Block *root_index_block;
-    BF_Block_Init(&root_index_block);
+    BF_Block *root_index_block = context_take_block(ctx);
+    if (!root_index_block)
+        return -1;
 
     CALL_BF(BF_AllocateBlock(ctx->file_desc, root_index_block));
     char *root_index_block_start = BF_Block_GetData(root_index_block);
@@ -1015,33 +1270,29 @@ int create_index_block_root_above_index_blocks(struct context *ctx)
     memcpy(ctx->metadata, ctx->internal_metadata, sizeof(BPlusMeta)); // updating the external metadata
 
     // updating the block's header
-    set_index_block(root_index_block_start);
+    set_index_block(root_index_block_start, bplus_file_index_block_type(ctx->internal_metadata));
 
-    IndexNodeHeader *root_index_block_header = malloc(sizeof(IndexNodeHeader));
-    if (!root_index_block_header) {
-        CALL_BF(BF_UnpinBlock(root_index_block));
-        BF_Block_Destroy(&root_index_block);
-        return -1;
-    }
-    
-    root_index_block_header->index_count = 2;
-    root_index_block_header->parent_index = -1; // root has no parent
-    // root_index_block_header->min_record_key is updated later **internally** by index_block_write_array_as_entries()
+    IndexNodeHeader root_index_block_header;
+    root_index_block_header.index_count = 2;
+    root_index_block_header.parent_index = -1; // root has no parent
+    // root_index_block_header.min_record_key is updated later **internally** by index_block_write_array_as_entries()
 
     // assigning the entries and lefmost index
     IndexNodeEntry entry_array[2];
 
     entry_array[0].key = ctx->parent_index_block_header->min_record_key; // this will become min key of root_index_block
     entry_array[0].right_index = ctx->parent_index_block_index; // this will become leftmost index of root_index_block
+    entry_array[0].aggregate = ctx->split_left;
 
     entry_array[1].key = ctx->new_parent_index_block_header->min_record_key; // this will be the first key in root_index_block
     entry_array[1].right_index = ctx->new_parent_index_block_index; // this will be the index in the right of the first key
+    entry_array[1].aggregate = ctx->split_right;
 
     // writing back both leftmost index and entries, which is done in this one call
-    index_block_write_array_as_entries(root_index_block_start, root_index_block_header, entry_array, 2);
+    index_block_write_array_as_entries(root_index_block_start, &root_index_block_header, entry_array, 2);
 
     // writing back the header
-    index_block_write_header(root_index_block_start, root_index_block_header);
+    index_block_write_header(root_index_block_start, &root_index_block_header);
     
     // updating the index block children to point to the new root
     ctx->parent_index_block_header->parent_index = ctx->internal_metadata->root_index;
@@ -1052,8 +1303,7 @@ int create_index_block_root_above_index_blocks(struct context *ctx)
 
     BF_Block_SetDirty(root_index_block);
     CALL_BF(BF_UnpinBlock(root_index_block));
-    BF_Block_Destroy(&root_index_block);
-    free(root_index_block_header);
+    context_release_block(ctx, &root_index_block);
     return 0;
 }
 
@@ -1066,79 +1316,63 @@ int update_parent_index_blocks(struct context *ctx)
     // updated version of new_parent_index_block isn't needed yet;
     // it is made by create_new_parent_index_block() when needed
 
-    // cleaning up all children and parent blocks
+    // cleaning up all children and parent blocks; the header buffers are kept, and reloaded below
     if (ctx->parent_index_block) {
         BF_Block_SetDirty(ctx->parent_index_block);
         BF_UnpinBlock(ctx->parent_index_block);
-        BF_Block_Destroy(&(ctx->parent_index_block));
+        context_release_block(ctx, &(ctx->parent_index_block));
     }
 
     if (ctx->new_parent_index_block) {
         BF_Block_SetDirty(ctx->new_parent_index_block);
         BF_UnpinBlock(ctx->new_parent_index_block);
-        BF_Block_Destroy(&(ctx->new_parent_index_block));
+        context_release_block(ctx, &(ctx->new_parent_index_block));
     }
 
     if (ctx->index_block) {
         BF_Block_SetDirty(ctx->index_block);
         BF_UnpinBlock(ctx->index_block);
-        BF_Block_Destroy(&(ctx->index_block));
+        context_release_block(ctx, &(ctx->index_block));
     }
 
     if (ctx->new_index_block) {
         BF_Block_SetDirty(ctx->new_index_block);
         BF_UnpinBlock(ctx->new_index_block);
-        BF_Block_Destroy(&(ctx->new_index_block));
+        context_release_block(ctx, &(ctx->new_index_block));
     }
 
-    free(ctx->parent_index_block_header);
-    free(ctx->parent_index_block_entry_array);
-    free(ctx->new_parent_index_block_header);
-    free(ctx->index_block_header);
-    free(ctx->new_index_block_header);
-
-    ctx->parent_index_block = NULL;
-    ctx->new_parent_index_block = NULL;
-    ctx->index_block = NULL;
-    ctx->new_index_block = NULL;
-
-    ctx->parent_index_block_header = NULL;
-    ctx->parent_index_block_entry_array = NULL;
-    ctx->new_parent_index_block_header = NULL;
-    ctx->index_block_header = NULL;
-    ctx->new_index_block_header = NULL;
-
     // loading index_block as defined
-    BF_Block_Init(&(ctx->index_block));
+    ctx->index_block = context_take_block(ctx);
+    if (!(ctx->index_block)) return -1;
     CALL_BF(BF_GetBlock(ctx->file_desc, updated_index_block_index, ctx->index_block));
     ctx->index_block_start = BF_Block_GetData(ctx->index_block);
     ctx->index_block_index = updated_index_block_index;
 
-    ctx->index_block_header = index_block_read_header(ctx->index_block_start);
-    if (!(ctx->index_block_header)) return -1;
+    if (context_read_index_header(ctx, &(ctx->index_block_header), ctx->index_block_start) == -1) return -1;
 
     // loading new_index_block as defined
-    BF_Block_Init(&(ctx->new_index_block));
+    ctx->new_index_block = context_take_block(ctx);
+    if (!(ctx->new_index_block)) return -1;
     CALL_BF(BF_GetBlock(ctx->file_desc, updated_new_index_block_index, ctx->new_index_block));
     ctx->new_index_block_start = BF_Block_GetData(ctx->new_index_block);
     ctx->new_index_block_index = updated_new_index_block_index;
 
-    ctx->new_index_block_header = index_block_read_header(ctx->new_index_block_start);
-    if (!(ctx->new_index_block_header)) return -1;
+    if (context_read_index_header(ctx, &(ctx->new_index_block_header), ctx->new_index_block_start) == -1) return -1;
 
     // loading parent_index_block as defined
-    BF_Block_Init(&(ctx->parent_index_block));
+    ctx->parent_index_block = context_take_block(ctx);
+    if (!(ctx->parent_index_block)) return -1;
     CALL_BF(BF_GetBlock(ctx->file_desc, updated_parent_index_block_index, ctx->parent_index_block));
     ctx->parent_index_block_start = BF_Block_GetData(ctx->parent_index_block);
     ctx->parent_index_block_index = updated_parent_index_block_index;
 
-    ctx->parent_index_block_header = index_block_read_header(ctx->parent_index_block_start);
-    if (!(ctx->parent_index_block_header)) return -1;
+    if (context_read_index_header(ctx, &(ctx->parent_index_block_header), ctx->parent_index_block_start) == -1) return -1;
 
     return 0;
 }
 
-int bplus_record_insert(const int file_desc, BPlusMeta *metadata, const Record *record)
+// inserts record into the tree of file_desc, see bplus_record_insert()
+static int record_insert(const int file_desc, BPlusMeta *metadata, const Record *record)
 {   
     // this contains the "context variables" needed by this function;
     // it is used to pass the whole context to each helper function;
@@ -1149,6 +1383,14 @@ int bplus_record_insert(const int file_desc, BPlusMeta *metadata, const Record *
     ctx.file_desc = file_desc;
     ctx.metadata = metadata;
     ctx.record = record;
+    ctx.handle = bplus_handle_get(file_desc);
+
+    // memory-mapped files are read-only
+    if (!ctx.handle || bplus_mmap_is_mapped(ctx.handle))
+        return -1;
+
+    bplus_io_account(file_desc, 1);
+    bplus_pool_check(file_desc);
 
     // getting the internal B+ tree metadata
     SAFE_CALL(load_internal_metadata(&ctx), ctx);
@@ -1156,6 +1398,7 @@ int bplus_record_insert(const int file_desc, BPlusMeta *metadata, const Record *
 
     // checking if there is a root
     if (ctx.internal_metadata->root_index == -1) { // there is no root yet
+        ctx.blocks_modified = 1;
         SAFE_CALL(create_data_block_root(&ctx), ctx);
         cleanup_context(&ctx);
         return ctx.inserted_block_index;
@@ -1169,10 +1412,14 @@ int bplus_record_insert(const int file_desc, BPlusMeta *metadata, const Record *
     // find the hypothetical insert position for the new record in the matching data block, even if it doesn't have free space
     SAFE_CALL(find_data_block_insert_pos(&ctx), ctx);
 
+    // the record is not a duplicate, so from now on blocks are modified
+    ctx.blocks_modified = 1;
+
     // checking if the matching data block actually has free space
     if (data_block_has_available_space(ctx.found_block_header, ctx.internal_metadata)) {
-        // inserting the record to the data block
+        // inserting the record to the data block, which is one more record under each of its ancestors
         SAFE_CALL(insert_record_to_data_block(&ctx), ctx);
+        SAFE_CALL(add_to_ancestor_aggregates(&ctx, ctx.found_block_header->parent_index), ctx);
         cleanup_context(&ctx);
         return ctx.inserted_block_index;
     }
@@ -1210,9 +1457,13 @@ int bplus_record_insert(const int file_desc, BPlusMeta *metadata, const Record *
         // find the hypothetical insert position for the new block's index in index block, even if it doesn't have free space
         SAFE_CALL(find_index_block_insert_pos(&ctx), ctx);
 
-        if (index_block_has_available_space(ctx.parent_index_block_header, ctx.internal_metadata)) {
-            // inserting the index to the parent index block
+        int inserted_child = ctx.parent_index_block_has_data_block_children ? ctx.new_data_block_index
+                                                                            : ctx.new_index_block_index;
+        if (index_block_has_available_space(ctx.parent_index_block_start, ctx.parent_index_block_header,
+                                            ctx.internal_metadata, ctx.inserted_key, inserted_child)) {
+            // inserting the index to the parent index block, which is one more record under each of its ancestors
             SAFE_CALL(insert_index_to_index_block(&ctx), ctx);
+            SAFE_CALL(add_to_ancestor_aggregates(&ctx, ctx.parent_index_block_header->parent_index), ctx);
             cleanup_context(&ctx);
             return ctx.inserted_block_index;
         }
@@ -1241,69 +1492,287 @@ int bplus_record_insert(const int file_desc, BPlusMeta *metadata, const Record *
     return ctx.inserted_block_index;
 }
 
-int bplus_record_find(const int file_desc, const BPlusMeta *metadata,
-                      const int key, Record **out_record) {
-  *out_record = NULL;
+int bplus_record_insert(const int file_desc, BPlusMeta *metadata, const Record *record)
+{
+    // a keyed file has its own blocks and insert (see bplus_keyed.h), and none of the other modules
+    if (bplus_file_is_keyed(metadata))
+        return bplus_keyed_insert(file_desc, metadata, record);
+
+    // the tree stores the codes of the strings of a file with dictionaries; the other modules get the strings
+    Record coded_record;
+    const Record *stored = record;
+    int has_dictionaries = bplus_file_has_dictionaries(metadata);
+    if (has_dictionaries) {
+        if (bplus_dictionary_encode(file_desc, metadata, record, &coded_record) == -1) {
+            bplus_dictionary_discard(file_desc);
+            return -1;
+        }
+        stored = &coded_record;
+    }
+
+    int inserted_block_index = record_insert(file_desc, metadata, stored);
+
+    // the new strings of the record are written to the dictionaries only once it is in the tree
+    if (has_dictionaries && inserted_block_index == -1)
+        bplus_dictionary_discard(file_desc);
+
+    // the key is in the tree now, so the Bloom filter of the file (if any) must have it too, no cached copy of
+    // its record may be older than the tree, and the secondary indexes need its entries
+    if (inserted_block_index != -1) {
+        int key = record_get_key(&(metadata->schema), record);
+        bplus_bloom_add(file_desc, metadata, key);
+
+        BPlusHandle *handle = bplus_handle_get(file_desc);
+        if (handle) {
+            bplus_cache_invalidate(handle, key);
+            bplus_secondary_add(handle, metadata, record);
+        }
+
+        if (has_dictionaries && bplus_dictionary_save(file_desc, metadata) == -1)
+            return -1;
+    }
 
-  BPlusMeta *tree_info;
-  BF_Block *info_block;
+    return inserted_block_index;
+}
 
-  // Receiving B+_Tree File metadata
-  BF_Block_Init(&info_block);
-  CALL_BF(BF_GetBlock(file_desc, 0, info_block));
+// adds 1 to the modification_count of the file, in block 0 and in metadata (the caller's copy), so that its secondary
+// indexes are rebuilt on the next open if they miss the change
+// block is an initialized BF block handle that is used for block 0
+// returns 0 on success, -1 if unsuccessful
+static int count_modification(int file_desc, BPlusMeta *metadata, BF_Block *block)
+{
+    CALL_BF(BF_GetBlock(file_desc, 0, block));
+    char *header_block_start = BF_Block_GetData(block);
 
-  tree_info = malloc(sizeof(BPlusMeta));
-  char *tree_info_start = BF_Block_GetData(info_block);
-  memcpy(tree_info, tree_info_start, sizeof(BPlusMeta));
+    BPlusMeta header_metadata;
+    memcpy(&header_metadata, header_block_start, sizeof(BPlusMeta));
+    header_metadata.modification_count++;
+    memcpy(header_block_start, &header_metadata, sizeof(BPlusMeta));
+    BF_Block_SetDirty(block);
+    CALL_BF(BF_UnpinBlock(block));
 
-  // Receiving the block index of the root from the metadata header
-  int root_pos = tree_info->root_index;
+    metadata->modification_count = header_metadata.modification_count;
+    return 0;
+}
 
-  // Receiving data block which potentially contains the key being searched
-  BF_Block *res_block;
-  BF_Block_Init(&res_block);
-  int *block_index = malloc(sizeof(int));
-  tree_search_data_block(root_pos, key, file_desc, res_block, block_index);
+// sets the aggregates that lead to key in the index block with index_block_index and its ancestors, starting from
+// child_aggregate (the aggregate of the records of the child below the block that leads to key), by recomputing each
+// block's aggregate from its children's; this is how an update in place refreshes them, as the updated value may have
+// been a minimum or maximum
+// block is an initialized BF block handle that is used for each of the blocks
+// returns 0 on success, -1 if unsuccessful
+static int refresh_ancestor_aggregates(int file_desc, const BPlusMeta *metadata, int index_block_index, int key,
+                                       BPlusAggregate child_aggregate, BF_Block *block)
+{
+    DataType type = metadata->schema.attributes[bplus_aggregate_attribute(metadata)].type;
+
+    while (index_block_index != -1) {
+        CALL_BF(BF_GetBlock(file_desc, index_block_index, block));
+        char *block_start = BF_Block_GetData(block);
+
+        IndexNodeHeader header;
+        index_block_copy_header(block_start, &header);
+        index_block_write_aggregate(block_start, index_block_find_child_position(block_start, key), &child_aggregate);
+
+        // the aggregate of this block, for its entry in its parent
+        bplus_aggregate_init(&child_aggregate);
+        for (int i = 0; i < header.index_count; i++) {
+            BPlusAggregate aggregate;
+            index_block_read_aggregate(block_start, i, &aggregate);
+            bplus_aggregate_merge(&child_aggregate, &aggregate, type);
+        }
 
-  // Accessing the acquired data block
-  char *data_block_start = BF_Block_GetData(res_block);
+        BF_Block_SetDirty(block);
+        CALL_BF(BF_UnpinBlock(block));
+        index_block_index = header.parent_index;
+    }
 
-  // Receiving the specific data block's header and metadata, specifically the
-  // number of records currently stored in the block
-  DataNodeHeader *data_block_header = data_block_read_header(data_block_start);
-  int number_of_records = data_block_header->record_count;
+    return 0;
+}
 
-  // Receiving a list of the available indexes, sorted from the lowest to
-  // highest key value
-  int *indices = malloc(number_of_records * sizeof(int));
-  indices = data_block_read_index_array(data_block_start, tree_info);
+int bplus_record_update(const int file_desc, BPlusMeta *metadata, const Record *record)
+{
+    if (bplus_file_is_keyed(metadata))
+        return bplus_keyed_update(file_desc, metadata, record);
 
-  // Iterating through the accessed data block for the record with the key value
-  // being searched for
-  Record *rec = malloc(sizeof(Record));
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || bplus_mmap_is_mapped(handle) || handle->insert_block_count == 0)
+        return -1;
+    for (int i = 0; i < BPLUS_MAX_SECONDARY_INDEXES; i++) {
+        if (handle->secondary[i])
+            return -1;
+    }
+
+    if (metadata->root_index == -1) // empty tree
+        return 0;
+
+    Record coded_record;
+    int has_dictionaries = bplus_file_has_dictionaries(metadata);
+    if (has_dictionaries) {
+        if (bplus_dictionary_encode(file_desc, metadata, record, &coded_record) == -1) {
+            bplus_dictionary_discard(file_desc);
+            return -1;
+        }
+        record = &coded_record;
+    }
 
-  for (int i = 0; i < number_of_records; i++) {
-    rec = data_block_read_record(data_block_start, data_block_header, indices,
-                                 tree_info, i);
-    int pk = record_get_key(&tree_info->schema, rec);
-    if (pk == key) {
-      *out_record = rec;
+    bplus_io_account(file_desc, 1);
+    bplus_pool_check(file_desc);
+
+    // the block handle is borrowed from the file's insert_blocks, as in tree_lookup()
+    int key = record_get_key(&(metadata->schema), record);
+    BF_Block *leaf_block = handle->insert_blocks[--(handle->insert_block_count)];
+
+    int result = -1;
+    int written = 0; // whether the leaf has the record (and so its codes) now
+    int leaf_index;
+    int attribute = bplus_aggregate_attribute(metadata);
+    BPlusAggregate leaf_aggregate;
+    int leaf_parent_index = -1;
+    if (bplus_finger_search_data_block(file_desc, metadata, key, leaf_block, &leaf_index) == 0) {
+        char *leaf_start = BF_Block_GetData(leaf_block);
+
+        DataNodeHeader header;
+        int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+        data_block_copy_header(leaf_start, &header);
+        data_block_copy_index_array(leaf_start, metadata, index_array);
+
+        // the record keeps its heap slot, so the index array stays sorted
+        int position = data_block_key_search(leaf_start, &header, index_array, metadata, key);
+        result = (position >= 0);
+        if (result == 1) {
+            data_block_write_unordered_record(leaf_start, metadata, index_array[position], record);
+            BF_Block_SetDirty(leaf_block);
+            written = 1;
+
+            // the aggregates above the leaf are recomputed from it up
+            if (attribute != -1) {
+                bplus_aggregate_data_block(leaf_start, metadata, attribute, INT_MIN, INT_MAX, &leaf_aggregate);
+                leaf_parent_index = header.parent_index;
+            }
+        }
+
+        BF_UnpinBlock(leaf_block);
+    }
+
+    if (leaf_parent_index != -1
+        && refresh_ancestor_aggregates(file_desc, metadata, leaf_parent_index, key, leaf_aggregate, leaf_block) == -1)
+        result = -1;
+    if (written && count_modification(file_desc, metadata, leaf_block) == -1)
+        result = -1;
+
+    handle->insert_blocks[(handle->insert_block_count)++] = leaf_block;
+    if (result == 1)
+        bplus_cache_invalidate(handle, key);
+
+    // as in bplus_record_insert(), the new strings are written only if the record was replaced
+    if (has_dictionaries && !written)
+        bplus_dictionary_discard(file_desc);
+    else if (has_dictionaries && bplus_dictionary_save(file_desc, metadata) == -1)
+        result = -1;
+    return result;
+}
 
-      // Clearing memory
-      BF_UnpinBlock(info_block);
-      BF_UnpinBlock(res_block);
-      free(indices);
+// searches the tree of file_desc (with runtime state handle) for the record with key as PK, and copies it to
+// out_record (unless it is NULL)
+// the data block is binary searched in place, and the block handle is borrowed from the file's insert_blocks, so a
+// lookup allocates no memory
+// returns 1 if found, 0 if not found, -1 on error
+static int tree_lookup(BPlusHandle *handle, const int file_desc, const BPlusMeta *metadata, const int key,
+                       Record *out_record)
+{
+    bplus_io_account(file_desc, 1);
+    bplus_pool_check(file_desc);
 
-      return 0;
+    // memory-mapped files are searched directly in the mapping, without the BF layer
+    if (bplus_mmap_is_mapped(handle)) {
+        Record record;
+        return bplus_mmap_find(handle, metadata, key, out_record ? out_record : &record);
     }
 
+    if (metadata->root_index == -1) // empty tree
+        return 0;
+
+    if (handle->insert_block_count == 0)
+        return -1;
+    BF_Block *leaf_block = handle->insert_blocks[--(handle->insert_block_count)];
+
+    int result = -1;
+    int leaf_index;
+    if (bplus_finger_search_data_block(file_desc, metadata, key, leaf_block, &leaf_index) == 0) {
+        const char *leaf_start = BF_Block_GetData(leaf_block);
+
+        DataNodeHeader header;
+        int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+        data_block_copy_header(leaf_start, &header);
+        data_block_copy_index_array(leaf_start, metadata, index_array);
+
+        int position = data_block_key_search(leaf_start, &header, index_array, metadata, key);
+        result = (position >= 0);
+        if (result == 1 && out_record) {
+            data_block_copy_record(leaf_start, &header, index_array, metadata, position, out_record);
+            bplus_dictionary_decode(handle, metadata, out_record);
+        }
+
+        BF_UnpinBlock(leaf_block);
+    }
+
+    handle->insert_blocks[(handle->insert_block_count)++] = leaf_block;
+    return result;
+}
+
+// looks key up for bplus_record_get(), bplus_record_contains() and bplus_record_find(): in the record cache of the
+// file, then in its Bloom filter, and only then in the tree (see tree_lookup())
+// returns 1 if found, 0 if not found, -1 on error
+static int record_lookup(const int file_desc, const BPlusMeta *metadata, const int key, Record *out_record)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || bplus_file_is_keyed(metadata)) // keyed files are read with bplus_keyed_get()
+        return -1;
+
+    if (bplus_cache_get(handle, key, out_record))
+        return 1;
+
+    // a key that the Bloom filter of the file rules out is not in the tree, and no block is needed to tell
+    if (!bplus_bloom_may_contain(handle, key))
+        return 0;
+
+    // a found record is copied out of its block even if the caller does not want it, when it is to be cached
+    Record record;
+    Record *copy = (out_record || !(handle->cache)) ? out_record : &record;
+
+    int result = tree_lookup(handle, file_desc, metadata, key, copy);
+    if (result == 1 && copy)
+        bplus_cache_put(handle, key, copy);
+    else if (result == 0)
+        bplus_bloom_count_false_positive(handle);
+
+    return result;
+}
+
+int bplus_record_get(const int file_desc, const BPlusMeta *metadata, const int key, Record *out_record)
+{
+    return record_lookup(file_desc, metadata, key, out_record);
+}
+
+int bplus_record_contains(const int file_desc, const BPlusMeta *metadata, const int key)
+{
+    return record_lookup(file_desc, metadata, key, NULL);
+}
+
+int bplus_record_find(const int file_desc, const BPlusMeta *metadata,
+                      const int key, Record **out_record) {
+  *out_record = NULL;
+
+  // The caller owns (and frees) the found record; the lookup itself is done by bplus_record_get()
+  Record *rec = malloc(sizeof(Record));
+  if (!rec) return -1;
+
+  if (bplus_record_get(file_desc, metadata, key, rec) != 1) {
     free(rec);
+    return -1;
   }
 
-  // Clearing memory
-  BF_UnpinBlock(info_block);
-  BF_UnpinBlock(res_block);
-  free(indices);
-
-  return -1;
-}
\ No newline at end of file
+  *out_record = rec;
+  return 0;
+}
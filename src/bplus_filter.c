@@ -0,0 +1,394 @@
+#include <limits.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_filter.h"
+
+#define FILTER_MAX_ROWS (BF_BLOCK_SIZE / sizeof(int)) // more than the records of any data block (as index array entries)
+
+int bplus_predicate_compile(BPlusPredicate *predicate, const TableSchema *schema, const char *attr_name,
+                            BPlusCompareOp op, const void *constant)
+{
+    int attribute = -1;
+    for (int i = 0; i < schema->count; i++) {
+        if (strcmp(schema->attributes[i].name, attr_name) == 0)
+            attribute = i;
+    }
+    if (attribute == -1 || op < BPLUS_COMPARE_EQ || op > BPLUS_COMPARE_GE || !constant)
+        return -1;
+
+    memset(predicate, 0, sizeof(BPlusPredicate));
+    predicate->attribute = attribute;
+    predicate->type = schema->attributes[attribute].type;
+    predicate->op = op;
+    switch (predicate->type) {
+        case TYPE_INT:
+        case TYPE_FLOAT:
+            memcpy(&(predicate->constant), constant, sizeof(int));
+            return 0;
+        case TYPE_LONG:
+            memcpy(&(predicate->constant), constant, sizeof(long long));
+            return 0;
+        case TYPE_CHAR:
+            predicate->length = schema->attributes[attribute].length;
+            if (predicate->length > MAX_STRING_LENGTH)
+                predicate->length = MAX_STRING_LENGTH;
+            strncpy(predicate->constant.string_value, constant, predicate->length);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+// sets order[i] to -1, 0 or 1 as the attribute of predicate in the row selection[i] of the data block is less than,
+// equal to or greater than the constant of predicate
+// the values are gathered into an array first, so that the comparison loops run over contiguous values (in a file with
+// PAX data blocks they are gathered from the minipage of the attribute only)
+static void compare_rows(const BPlusPredicate *predicate, const char *block_start, const int *index_array,
+                         const BPlusMeta *metadata, const int *selection, int row_count, int *order)
+{
+    int stride;
+    const char *column = data_block_column_start(block_start, metadata, predicate->attribute, &stride);
+
+    switch (predicate->type) {
+        case TYPE_INT: {
+            int values[FILTER_MAX_ROWS];
+            int constant = predicate->constant.int_value;
+            for (int i = 0; i < row_count; i++)
+                memcpy(&(values[i]), column + index_array[selection[i]] * stride, sizeof(int));
+            for (int i = 0; i < row_count; i++)
+                order[i] = (values[i] > constant) - (values[i] < constant);
+            break;
+        }
+        case TYPE_FLOAT: {
+            float values[FILTER_MAX_ROWS];
+            float constant = predicate->constant.float_value;
+            for (int i = 0; i < row_count; i++)
+                memcpy(&(values[i]), column + index_array[selection[i]] * stride, sizeof(float));
+            for (int i = 0; i < row_count; i++)
+                order[i] = (values[i] > constant) - (values[i] < constant);
+            break;
+        }
+        case TYPE_LONG: {
+            long long values[FILTER_MAX_ROWS];
+            long long constant = predicate->constant.long_value;
+            for (int i = 0; i < row_count; i++)
+                memcpy(&(values[i]), column + index_array[selection[i]] * stride, sizeof(long long));
+            for (int i = 0; i < row_count; i++)
+                order[i] = (values[i] > constant) - (values[i] < constant);
+            break;
+        }
+        case TYPE_CHAR:
+            for (int i = 0; i < row_count; i++) {
+                int result = strncmp(column + index_array[selection[i]] * stride,
+                                     predicate->constant.string_value, predicate->length);
+                order[i] = (result > 0) - (result < 0);
+            }
+            break;
+        default:
+            memset(order, 0, row_count * sizeof(int));
+            break;
+    }
+}
+
+// sets matches[i] to 1 if order[i] (see compare_rows()) satisfies op, else to 0, for the first count of them
+static void match_order(BPlusCompareOp op, const int *order, int *matches, int count)
+{
+    switch (op) {
+        case BPLUS_COMPARE_EQ:
+            for (int i = 0; i < count; i++) matches[i] = (order[i] == 0);
+            break;
+        case BPLUS_COMPARE_NE:
+            for (int i = 0; i < count; i++) matches[i] = (order[i] != 0);
+            break;
+        case BPLUS_COMPARE_LT:
+            for (int i = 0; i < count; i++) matches[i] = (order[i] < 0);
+            break;
+        case BPLUS_COMPARE_LE:
+            for (int i = 0; i < count; i++) matches[i] = (order[i] <= 0);
+            break;
+        case BPLUS_COMPARE_GT:
+            for (int i = 0; i < count; i++) matches[i] = (order[i] > 0);
+            break;
+        default:
+            for (int i = 0; i < count; i++) matches[i] = (order[i] >= 0);
+            break;
+    }
+}
+
+// keeps in selection (the positions of the rows of the data block still selected, in key order) only the rows that
+// satisfy the predicate at position p of the scan
+// returns the number of rows kept
+static int filter_rows(const BPlusFilterScan *scan, int p, const char *block_start, const int *index_array,
+                       int *selection, int row_count)
+{
+    const BPlusPredicate *predicate = &(scan->predicates[p]);
+    int matches[FILTER_MAX_ROWS];
+    if (scan->code_matches[p]) {
+        // the rows of a coded attribute look their code up in the table of the predicate
+        int stride;
+        const char *column = data_block_column_start(block_start, scan->metadata, predicate->attribute, &stride);
+        const int *code_matches = scan->code_matches[p];
+        int code_count = scan->code_count[p];
+        for (int i = 0; i < row_count; i++) {
+            unsigned short code;
+            memcpy(&code, column + index_array[selection[i]] * stride, sizeof(unsigned short));
+            matches[i] = (code < code_count) ? code_matches[code] : 0;
+        }
+    }
+    else {
+        int order[FILTER_MAX_ROWS];
+        compare_rows(predicate, block_start, index_array, scan->metadata, selection, row_count, order);
+        match_order(predicate->op, order, matches, row_count);
+    }
+
+    // the selection is compacted without branches: every row is written, and only the matching ones are kept
+    int kept = 0;
+    for (int i = 0; i < row_count; i++) {
+        selection[kept] = selection[i];
+        kept += matches[i];
+    }
+    return kept;
+}
+
+// evaluates the predicates of the scan on the records of the data block at block_start, and appends the projected
+// attributes of those that satisfy them to batch (handle is the runtime state of the file, for its dictionaries)
+static void filter_block(BPlusFilterScan *scan, const BPlusHandle *handle, const char *block_start,
+                         BPlusColumnBatch *batch)
+{
+    const BPlusMeta *metadata = scan->metadata;
+    DataNodeHeader header;
+    int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+    data_block_copy_header(block_start, &header);
+    data_block_copy_index_array(block_start, metadata, index_array);
+    scan->next_block_index = header.next_index;
+
+    // the rows are in key order, so the key bounds cut a prefix and a suffix of them
+    int row_count = header.record_count;
+    if (row_count > metadata->max_records_per_block)
+        row_count = metadata->max_records_per_block;
+    int first = 0;
+    int key_stride;
+    const char *keys = data_block_column_start(block_start, metadata, metadata->schema.key_index, &key_stride);
+    int key;
+    while (first < row_count) {
+        memcpy(&key, keys + index_array[first] * key_stride, sizeof(int));
+        if (key >= scan->low_key)
+            break;
+        first++;
+    }
+    while (row_count > first) {
+        memcpy(&key, keys + index_array[row_count - 1] * key_stride, sizeof(int));
+        if (key <= scan->high_key)
+            break;
+        row_count--;
+        scan->next_block_index = -1; // the next blocks only have larger keys
+    }
+
+    int selection[FILTER_MAX_ROWS];
+    int selected = 0;
+    for (int i = first; i < row_count; i++)
+        selection[selected++] = i;
+    for (int p = 0; p < scan->predicate_count && selected > 0; p++)
+        selected = filter_rows(scan, p, block_start, index_array, selection, selected);
+
+    // projected column by column, so that each column is written contiguously; only the bytes of each value are
+    // copied, the rest of its FieldValue is zero
+    for (int c = 0; c < scan->column_count; c++) {
+        int attribute = scan->columns[c];
+        int stride;
+        const char *values = data_block_column_start(block_start, metadata, attribute, &stride);
+        FieldValue *column = &(batch->columns[c][batch->row_count]);
+        memset(column, 0, selected * sizeof(FieldValue));
+
+        if (!bplus_dictionary_is_coded(metadata, attribute)) {
+            int width = data_block_value_width(metadata, attribute);
+            for (int i = 0; i < selected; i++)
+                memcpy(&(column[i]), values + index_array[selection[i]] * stride, width);
+            continue;
+        }
+
+        // the codes of the selected rows are decoded into their strings (an unknown code is left empty)
+        int width = metadata->schema.attributes[attribute].length;
+        if (width > MAX_STRING_LENGTH)
+            width = MAX_STRING_LENGTH;
+        for (int i = 0; i < selected; i++) {
+            unsigned short code;
+            memcpy(&code, values + index_array[selection[i]] * stride, sizeof(unsigned short));
+            const char *string = bplus_dictionary_string(handle, attribute, code);
+            if (string)
+                memcpy(column[i].string_value, string, width);
+        }
+    }
+    batch->row_count += selected;
+}
+
+// evaluates the data block with block_index (see filter_block())
+// returns 0 on success, -1 otherwise
+static int load_block(BPlusFilterScan *scan, int block_index, BPlusColumnBatch *batch)
+{
+    BPlusHandle *handle = bplus_handle_get(scan->file_desc);
+    if (!handle)
+        return -1;
+
+    // a memory-mapped file is read directly in the mapping
+    if (bplus_mmap_is_mapped(handle)) {
+        const char *block_start = bplus_mmap_block(handle, block_index);
+        if (!block_start || !is_data_block(block_start))
+            return -1;
+
+        filter_block(scan, handle, block_start, batch);
+        return 0;
+    }
+
+    // no block of the scan is pinned here, so the quotas and the scan ring can be enforced
+    bplus_pool_check(scan->file_desc);
+
+    BF_Block *block;
+    BF_Block_Init(&block);
+    if (BF_GetBlock(scan->file_desc, block_index, block) != BF_OK) {
+        BF_Block_Destroy(&block);
+        return -1;
+    }
+    bplus_handle_touch(scan->file_desc, block_index, scan->access_hint);
+
+    const char *block_start = BF_Block_GetData(block);
+    int result = 0;
+    if (is_data_block(block_start))
+        filter_block(scan, handle, block_start, batch);
+    else
+        result = -1;
+
+    BF_UnpinBlock(block);
+    BF_Block_Destroy(&block);
+    return result;
+}
+
+// fills the table of the codes of the dictionary of the file of handle that satisfy the predicate at position p of the
+// scan, whose attribute is coded; each string is compared once, as compare_rows() compares a value
+// returns 0 on success, -1 if unsuccessful
+static int compile_code_matches(BPlusFilterScan *scan, int p, const BPlusHandle *handle)
+{
+    const BPlusPredicate *predicate = &(scan->predicates[p]);
+    int code_count = bplus_dictionary_code_count(handle, predicate->attribute);
+
+    // one more entry than codes, so that an empty dictionary gets a table too
+    int *order = malloc((code_count + 1) * sizeof(int));
+    scan->code_matches[p] = malloc((code_count + 1) * sizeof(int));
+    if (!order || !(scan->code_matches[p])) {
+        free(order);
+        return -1;
+    }
+
+    for (int code = 0; code < code_count; code++) {
+        int result = strncmp(bplus_dictionary_string(handle, predicate->attribute, code),
+                             predicate->constant.string_value, predicate->length);
+        order[code] = (result > 0) - (result < 0);
+    }
+    match_order(predicate->op, order, scan->code_matches[p], code_count);
+    scan->code_count[p] = code_count;
+
+    free(order);
+    return 0;
+}
+
+int bplus_filter_open(BPlusFilterScan *scan, int file_desc, const BPlusMeta *metadata, const BPlusPredicate *predicates,
+                      int predicate_count, const char *const *column_names, int column_count, int access_hint)
+{
+    memset(scan, 0, sizeof(BPlusFilterScan));
+    scan->file_desc = file_desc;
+    scan->metadata = metadata;
+    scan->access_hint = access_hint;
+    scan->next_block_index = -1;
+    scan->low_key = INT_MIN;
+    scan->high_key = INT_MAX;
+
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || predicate_count < 0 || predicate_count > BPLUS_FILTER_MAX_PREDICATES
+        || column_count < 0 || column_count > MAX_ATTRIBUTES || bplus_file_is_keyed(metadata))
+        return -1;
+
+    for (int c = 0; c < column_count; c++) {
+        scan->columns[c] = -1;
+        for (int i = 0; i < metadata->schema.count; i++) {
+            if (strcmp(metadata->schema.attributes[i].name, column_names[c]) == 0)
+                scan->columns[c] = i;
+        }
+        if (scan->columns[c] == -1)
+            return -1;
+    }
+    scan->column_count = column_count;
+
+    // the predicates on the key (but !=) become the key bounds of the scan, the others are evaluated on every row
+    for (int p = 0; p < predicate_count; p++) {
+        const BPlusPredicate *predicate = &(predicates[p]);
+        if (predicate->attribute < 0 || predicate->attribute >= metadata->schema.count)
+            return -1;
+        if (predicate->attribute != metadata->schema.key_index || predicate->op == BPLUS_COMPARE_NE) {
+            scan->predicates[scan->predicate_count++] = *predicate;
+            if (predicate->type == TYPE_CHAR && bplus_dictionary_is_coded(metadata, predicate->attribute)
+                && compile_code_matches(scan, scan->predicate_count - 1, handle) == -1)
+                return -1;
+            continue;
+        }
+
+        long long key = predicate->constant.int_value;
+        if (predicate->op == BPLUS_COMPARE_LT)
+            key--;
+        else if (predicate->op == BPLUS_COMPARE_GT)
+            key++;
+        if (predicate->op != BPLUS_COMPARE_LT && predicate->op != BPLUS_COMPARE_LE && key > scan->low_key)
+            scan->low_key = key;
+        if (predicate->op != BPLUS_COMPARE_GT && predicate->op != BPLUS_COMPARE_GE && key < scan->high_key)
+            scan->high_key = key;
+    }
+
+    if (metadata->root_index == -1 || scan->low_key > scan->high_key) // no record can match, the scan is at its end
+        return 0;
+
+    // finding the data block of the smallest allowed key
+    int block_index;
+    if (bplus_mmap_is_mapped(handle)) {
+        block_index = bplus_mmap_search_data_block(handle, metadata, (int)scan->low_key);
+        if (block_index == -1)
+            return -1;
+    }
+    else {
+        bplus_pool_check(file_desc);
+
+        BF_Block *block;
+        BF_Block_Init(&block);
+        int result = tree_search_data_block(metadata->root_index, (int)scan->low_key, file_desc, block, &block_index);
+        if (result == 0)
+            BF_UnpinBlock(block);
+        BF_Block_Destroy(&block);
+        if (result == -1)
+            return -1;
+    }
+
+    scan->next_block_index = block_index;
+    return 0;
+}
+
+int bplus_filter_next(BPlusFilterScan *scan, BPlusColumnBatch *batch)
+{
+    batch->row_count = 0;
+    batch->column_count = scan->column_count;
+    memcpy(batch->attributes, scan->columns, sizeof(scan->columns));
+
+    // data blocks are evaluated until the next one might not fit in the batch
+    while (scan->next_block_index != -1
+           && batch->row_count + scan->metadata->max_records_per_block <= BPLUS_FILTER_BATCH_ROWS) {
+        if (load_block(scan, scan->next_block_index, batch) == -1)
+            return -1;
+    }
+
+    return batch->row_count;
+}
+
+void bplus_filter_close(BPlusFilterScan *scan)
+{
+    for (int p = 0; p < BPLUS_FILTER_MAX_PREDICATES; p++)
+        free(scan->code_matches[p]);
+    memset(scan, 0, sizeof(BPlusFilterScan));
+    scan->next_block_index = -1;
+}
@@ -0,0 +1,157 @@
+#include <limits.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_finger.h"
+
+#define CALL_BF(call)         \
+{                             \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+        BF_PrintError(code);  \
+        return -1;            \
+    }                         \
+}
+
+// moves the finger of handle to the data block with block_index, whose routed keys include [lower_key, upper_key)
+// upper_is_exact is 1 if upper_key is where the next data block's keys start, 0 if it only bounds the known keys
+static void move_finger(BPlusHandle *handle, const BPlusMeta *metadata, int block_index, int next_index,
+                        long long lower_key, long long upper_key, int upper_is_exact)
+{
+    handle->finger_block_index = block_index;
+    handle->finger_next_index = next_index;
+    handle->finger_lower_key = lower_key;
+    handle->finger_upper_key = upper_key;
+    handle->finger_upper_is_exact = upper_is_exact;
+    handle->finger_block_count = metadata->block_count;
+}
+
+// fetches the data block with block_index into block, and checks from its records that it holds key; lower_key is
+// where the keys routed to the block are known to start (LLONG_MAX if unknown)
+// returns 1 if it does (the block remains pinned and the finger is moved to it), 0 if not (the block is unpinned),
+// -1 on error
+static int try_finger_block(BPlusHandle *handle, int file_desc, const BPlusMeta *metadata, int key, int block_index,
+                            long long lower_key, BF_Block *block)
+{
+    if (block_index <= 0 || block_index >= metadata->block_count)
+        return 0;
+
+    CALL_BF(BF_GetBlock(file_desc, block_index, block));
+    const char *block_start = BF_Block_GetData(block);
+    bplus_handle_touch(file_desc, block_index, BPLUS_ACCESS_NORMAL);
+
+    DataNodeHeader header;
+    if (is_data_block(block_start))
+        data_block_copy_header(block_start, &header);
+    if (!is_data_block(block_start) || header.record_count < 1) {
+        CALL_BF(BF_UnpinBlock(block));
+        return 0;
+    }
+
+    // the block holds the keys from its smallest one (or from lower_key) to its largest one, and the last data block
+    // also every larger key
+    if (lower_key > header.min_record_key)
+        lower_key = header.min_record_key;
+    long long upper_key = (header.next_index == -1) ? LLONG_MAX : (long long)data_block_last_key(block_start, &header, metadata) + 1;
+    if (key < lower_key || key >= upper_key) {
+        CALL_BF(BF_UnpinBlock(block));
+        return 0;
+    }
+
+    move_finger(handle, metadata, block_index, header.next_index, lower_key, upper_key, header.next_index == -1);
+    return 1;
+}
+
+// returns the result of try_finger_block() for the block that the finger of handle points to key with, or 0 if the
+// finger does not cover key
+static int search_from_finger(BPlusHandle *handle, int file_desc, const BPlusMeta *metadata, int key, BF_Block *block,
+                              int *block_index)
+{
+    if (handle->finger_block_index == -1)
+        return 0;
+
+    int is_current = (handle->finger_block_count == metadata->block_count); // no split since the finger was moved
+    int in_range = (key >= handle->finger_lower_key && key < handle->finger_upper_key);
+
+    // the range is exact, so the block is fetched for the operation only
+    if (in_range && is_current) {
+        *block_index = handle->finger_block_index;
+        CALL_BF(BF_GetBlock(file_desc, *block_index, block));
+        bplus_handle_touch(file_desc, *block_index, BPLUS_ACCESS_NORMAL);
+        return 1;
+    }
+
+    // the range may be stale, so the block must show that it still holds the key
+    if (in_range) {
+        *block_index = handle->finger_block_index;
+        return try_finger_block(handle, file_desc, metadata, key, *block_index, LLONG_MAX, block);
+    }
+
+    // the next data block's keys start where this one's end (if that is known)
+    if (key >= handle->finger_upper_key && handle->finger_next_index != -1 && handle->finger_last_was_hit) {
+        long long lower_key = (is_current && handle->finger_upper_is_exact) ? handle->finger_upper_key : LLONG_MAX;
+        *block_index = handle->finger_next_index;
+        return try_finger_block(handle, file_desc, metadata, key, *block_index, lower_key, block);
+    }
+
+    return 0;
+}
+
+// descends from the root to the data block that could contain key, as tree_search_data_block() does, keeping the
+// range of keys that the index blocks route to each block on the way; the finger is moved to the found block
+// returns 0 on success, -1 otherwise
+static int search_from_root(BPlusHandle *handle, int file_desc, const BPlusMeta *metadata, int key, BF_Block *block,
+                            int *block_index)
+{
+    long long lower_key = LLONG_MIN, upper_key = LLONG_MAX;
+    int index = metadata->root_index;
+
+    while (1) {
+        CALL_BF(BF_GetBlock(file_desc, index, block));
+        const char *block_start = BF_Block_GetData(block);
+        bplus_handle_touch(file_desc, index, BPLUS_ACCESS_NORMAL);
+
+        if (is_data_block(block_start)) {
+            DataNodeHeader header;
+            data_block_copy_header(block_start, &header);
+            move_finger(handle, metadata, index, header.next_index, lower_key, upper_key, 1);
+
+            *block_index = index;
+            return 0;
+        }
+
+        index = index_block_find_child_bounds(block_start, key, &lower_key, &upper_key);
+        CALL_BF(BF_UnpinBlock(block));
+    }
+}
+
+int bplus_finger_search_data_block(int file_desc, const BPlusMeta *metadata, int key, BF_Block *found_block,
+                                   int *found_block_index)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return tree_search_data_block(metadata->root_index, key, file_desc, found_block, found_block_index);
+
+    int result = search_from_finger(handle, file_desc, metadata, key, found_block, found_block_index);
+    if (result == -1)
+        return -1;
+
+    handle->finger_last_was_hit = result;
+    if (result == 1) {
+        handle->finger_hits++;
+        return 0;
+    }
+
+    handle->finger_misses++;
+    return search_from_root(handle, file_desc, metadata, key, found_block, found_block_index);
+}
+
+int bplus_finger_stats(int file_desc, BPlusFingerStats *stats)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+
+    stats->hits = handle->finger_hits;
+    stats->misses = handle->finger_misses;
+    return 0;
+}
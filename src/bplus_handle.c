@@ -0,0 +1,88 @@
+#include "../include/bf.h"
+#include "../include/bplus_handle.h"
+#include "../include/bplus_async.h"
+#include "../include/bplus_io.h"
+#include "../include/bplus_mmap.h"
+#include "../include/bplus_warm.h"
+#include "../include/bplus_pool.h"
+#include "../include/bplus_bloom.h"
+#include "../include/bplus_cache.h"
+#include "../include/bplus_secondary.h"
+#include "../include/bplus_dictionary.h"
+
+// one slot per possible file descriptor; static storage, so every slot starts zeroed (closed)
+static BPlusHandle handle_table[BPLUS_MAX_HANDLES];
+
+int bplus_handle_open(int file_desc, const char *file_name)
+{
+    if (file_desc < 0 || file_desc >= BPLUS_MAX_HANDLES)
+        return -1;
+
+    BPlusHandle *handle = &handle_table[file_desc];
+    memset(handle, 0, sizeof(BPlusHandle));
+
+    handle->file_name = malloc(strlen(file_name) + 1);
+    if (!(handle->file_name))
+        return -1;
+    strcpy(handle->file_name, file_name);
+
+    handle->io_mode = BPLUS_IO_BUFFERED;
+    handle->io_fd = -1;
+    handle->finger_block_index = -1;
+
+    handle->is_open = 1;
+    return 0;
+}
+
+int bplus_handle_free_mapped_desc()
+{
+    for (int file_desc = BF_MAX_OPEN_FILES; file_desc < BPLUS_MAX_HANDLES; file_desc++) {
+        if (!handle_table[file_desc].is_open)
+            return file_desc;
+    }
+
+    return -1;
+}
+
+void bplus_handle_close(int file_desc)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle) return;
+
+    bplus_io_close(handle);
+    bplus_pool_close(file_desc);
+    bplus_mmap_close(handle);
+    bplus_warm_close(handle);
+    bplus_bloom_close(handle);
+    bplus_cache_close(handle);
+    bplus_secondary_close(handle);
+    bplus_dictionary_close(handle);
+    bplus_arena_free(&(handle->insert_arena));
+    for (int i = 0; i < handle->insert_block_count; i++)
+        BF_Block_Destroy(&(handle->insert_blocks[i]));
+
+    free(handle->file_name);
+    free(handle->async_queue);
+
+    memset(handle, 0, sizeof(BPlusHandle)); // also sets is_open to 0
+}
+
+void bplus_handle_touch(int file_desc, int block_index, int access_hint)
+{
+    // blocks read once by a scan are not part of the working set
+    if (access_hint == BPLUS_ACCESS_NORMAL)
+        bplus_warm_touch(file_desc, block_index);
+
+    bplus_pool_touch(file_desc, block_index, access_hint);
+}
+
+BPlusHandle *bplus_handle_get(int file_desc)
+{
+    if (file_desc < 0 || file_desc >= BPLUS_MAX_HANDLES)
+        return NULL;
+
+    if (!handle_table[file_desc].is_open)
+        return NULL;
+
+    return &handle_table[file_desc];
+}
@@ -1,3 +1,6 @@
+#include <limits.h>
+#include <stdint.h>
+
 #include "../include/bf.h"
 #include "../include/bplus_index_node.h"
 #include "../include/bplus_file_structs.h"
@@ -17,22 +20,131 @@ int is_index_block(const char *block_start)
 {
     int block_type;
     memcpy(&block_type, block_start, sizeof(int));
-    return (block_type == BLOCK_TYPE_INDEX);
+    return (block_type == BLOCK_TYPE_INDEX || block_type == BLOCK_TYPE_INDEX_PACKED
+            || block_type == BLOCK_TYPE_INDEX_COUNTED || block_type == BLOCK_TYPE_INDEX_PACKED_COUNTED
+            || block_type == BLOCK_TYPE_INDEX_AGGREGATED || block_type == BLOCK_TYPE_INDEX_PACKED_AGGREGATED);
+}
+
+int index_block_has_counts(const char *block_start)
+{
+    int block_type;
+    memcpy(&block_type, block_start, sizeof(int));
+    return (block_type == BLOCK_TYPE_INDEX_COUNTED || block_type == BLOCK_TYPE_INDEX_PACKED_COUNTED
+            || index_block_has_aggregates(block_start));
+}
+
+int index_block_has_aggregates(const char *block_start)
+{
+    int block_type;
+    memcpy(&block_type, block_start, sizeof(int));
+    return (block_type == BLOCK_TYPE_INDEX_AGGREGATED || block_type == BLOCK_TYPE_INDEX_PACKED_AGGREGATED);
+}
+
+// returns 1 if the entries of an index block are packed, 0 if they are IndexNodeEntry structs
+static int index_block_is_packed(const char *block_start)
+{
+    int block_type;
+    memcpy(&block_type, block_start, sizeof(int));
+    return (block_type == BLOCK_TYPE_INDEX_PACKED || block_type == BLOCK_TYPE_INDEX_PACKED_COUNTED
+            || block_type == BLOCK_TYPE_INDEX_PACKED_AGGREGATED);
+}
+
+// returns the bytes that an index block keeps for each child at its end (0 if it is not counted)
+static int index_block_slot_size(const char *block_start)
+{
+    if (index_block_has_aggregates(block_start))
+        return INDEX_BLOCK_AGGREGATE_SLOT_SIZE;
+    return index_block_has_counts(block_start) ? (int)sizeof(int) : 0;
+}
+
+// returns the most indexes that an index block of this kind holds as plain entries
+static int index_block_plain_capacity(const char *block_start)
+{
+    if (index_block_has_aggregates(block_start))
+        return INDEX_BLOCK_AGGREGATED_PLAIN_CAPACITY;
+    return index_block_has_counts(block_start) ? INDEX_BLOCK_COUNTED_PLAIN_CAPACITY : INDEX_BLOCK_PLAIN_CAPACITY;
+}
+
+// returns where the slot (count, then the aggregate if any) of the child at position (0 for the leftmost index) is
+// stored in a counted block
+static const char *index_block_slot_start(const char *block_start, int position)
+{
+    return block_start + BF_BLOCK_SIZE - (position + 1) * index_block_slot_size(block_start);
+}
+
+// returns the fewest bytes (at least 1) that hold difference
+static int packed_width(uint32_t difference)
+{
+    int width = 1;
+    while (width < 4 && (difference >> (8 * width)) != 0)
+        width++;
+    return width;
+}
+
+// returns the unsigned value stored in width bytes at bytes, least significant first
+static uint32_t read_packed(const unsigned char *bytes, int width)
+{
+    uint32_t value = 0;
+    for (int i = width - 1; i >= 0; i--)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+// stores value in width bytes at bytes, least significant first
+static void write_packed(unsigned char *bytes, uint32_t value, int width)
+{
+    for (int i = 0; i < width; i++) {
+        bytes[i] = (unsigned char)value;
+        value >>= 8;
+    }
 }
 
-void set_index_block(char *block_start)
+// sets packing for entries with keys in [min_key, max_key] and right indexes in [min_child, max_child]
+// returns the bytes of a packed block with entry_count entries and that packing
+static int index_block_packing(int min_key, int max_key, int min_child, int max_child, int entry_count,
+                               IndexNodePacking *packing)
 {
-    int block_type_index = BLOCK_TYPE_INDEX;
-    memcpy(block_start, &block_type_index, sizeof(int));
+    memset(packing, 0, sizeof(IndexNodePacking));
+    packing->key_base = min_key;
+    packing->child_base = min_child;
+    packing->key_width = (unsigned char)packed_width((uint32_t)max_key - (uint32_t)min_key);
+    packing->child_width = (unsigned char)packed_width((uint32_t)max_child - (uint32_t)min_child);
+
+    return (int)(sizeof(int) + sizeof(IndexNodeHeader) + sizeof(int) + sizeof(IndexNodePacking))
+        + entry_count * (packing->key_width + packing->child_width);
+}
+
+// reads the entry at index (the leftmost index is not an entry) of a plain or packed block to entry
+static void index_block_read_entry_at(const char *block_start, int index, IndexNodeEntry *entry)
+{
+    const char *entry0_start = block_start + sizeof(int) + sizeof(IndexNodeHeader) + sizeof(int);
+    index_block_read_aggregate(block_start, index + 1, &entry->aggregate);
+    if (!index_block_is_packed(block_start)) {
+        memcpy(&entry->key, entry0_start + index * 2 * sizeof(int), sizeof(int));
+        memcpy(&entry->right_index, entry0_start + index * 2 * sizeof(int) + sizeof(int), sizeof(int));
+        return;
+    }
+
+    IndexNodePacking packing;
+    memcpy(&packing, entry0_start, sizeof(IndexNodePacking));
+    const unsigned char *entry_start = (const unsigned char *)entry0_start + sizeof(IndexNodePacking)
+        + index * (packing.key_width + packing.child_width);
+
+    entry->key = (int)((uint32_t)packing.key_base + read_packed(entry_start, packing.key_width));
+    entry->right_index = (int)((uint32_t)packing.child_base + read_packed(entry_start + packing.key_width,
+                                                                          packing.child_width));
+}
+
+void set_index_block(char *block_start, int block_type)
+{
+    memcpy(block_start, &block_type, sizeof(int));
 }
 
 void index_block_print(const char *block_start, const BPlusMeta* metadata)
 {
     char *block_ptr = (char *)block_start; // block_ptr will be moving forward
 
-    int block_type;
-    memcpy(&block_type, block_ptr, sizeof(int));
-    if (block_type != BLOCK_TYPE_INDEX) {
+    if (!is_index_block(block_start)) {
         perror("Not an index block\n");
         return;
     }
@@ -53,18 +165,33 @@ void index_block_print(const char *block_start, const BPlusMeta* metadata)
     int leftmost_index;
     memcpy(&leftmost_index, block_ptr, sizeof(int));
     printf("index: %d\n", leftmost_index);
+    if (index_block_has_counts(block_start))
+        printf("count: %d\n", index_block_read_count(block_start, 0));
     block_ptr += sizeof(int);
     for (int i = 0; i < header->index_count - 1; i++) {
         IndexNodeEntry entry;
-        memcpy(&entry, block_ptr, sizeof(IndexNodeEntry));
+        index_block_read_entry_at(block_start, i, &entry);
         printf("key: %d\n", entry.key);
         printf("index: %d\n", entry.right_index);
-        block_ptr += sizeof(IndexNodeEntry);
+        if (index_block_has_counts(block_start))
+            printf("count: %d\n", entry.aggregate.count);
     }
     printf("\n");
+
+    // packed entries take key_width + child_width bytes each, after the packing
+    if (index_block_is_packed(block_start)) {
+        IndexNodePacking packing;
+        memcpy(&packing, block_ptr, sizeof(IndexNodePacking));
+        printf("Packed entries: %d + %d Bytes each\n", packing.key_width, packing.child_width);
+        block_ptr += sizeof(IndexNodePacking) + (header->index_count - 1) * (packing.key_width + packing.child_width);
+    }
+    else {
+        block_ptr += (header->index_count - 1) * 2 * sizeof(int);
+    }
+    int count_bytes = header->index_count * index_block_slot_size(block_start);
     free(header);
     
-    printf("Unused space: %td Bytes\n", BF_BLOCK_SIZE - (block_ptr - block_start));
+    printf("Unused space: %td Bytes\n", BF_BLOCK_SIZE - count_bytes - (block_ptr - block_start));
 
     for (int i = 0; i < 20; i++) printf("-");
     printf("\n");
@@ -81,6 +208,11 @@ IndexNodeHeader *index_block_read_header(const char *block_start)
     return result;
 }
 
+void index_block_copy_header(const char *block_start, IndexNodeHeader *header)
+{
+    memcpy(header, block_start + sizeof(int), sizeof(IndexNodeHeader));
+}
+
 int index_block_read_leftmost_index(const char *block_start)
 {
     const char *target_start = block_start + sizeof(int) + sizeof(IndexNodeHeader);
@@ -96,32 +228,57 @@ IndexNodeEntry *index_block_read_entry(const char *block_start, const IndexNodeH
     if (index >= entry_count)
         return NULL;
 
-    const char *entry0_start = block_start + sizeof(int) + sizeof(IndexNodeHeader) + sizeof(int);
-    const char *target_start = entry0_start + index * sizeof(IndexNodeEntry);
-
     IndexNodeEntry *result = malloc(sizeof(IndexNodeEntry));
     if (!result) return NULL;
 
-    memcpy(result, target_start, sizeof(IndexNodeEntry));
+    index_block_read_entry_at(block_start, index, result);
     return result;
 }
 
 void index_block_read_entries_as_array(const char *block_start, const IndexNodeHeader *block_header, IndexNodeEntry *entry_array)
 {
     const char *leftmost_index_start = block_start + sizeof(int) + sizeof(IndexNodeHeader);
-    const char *entry1_start = leftmost_index_start + sizeof(int);
 
     // entry_array[0] corresponds to the block's leftmost index
     entry_array[0].key = block_header->min_record_key;
     memcpy(&(entry_array[0].right_index), leftmost_index_start, sizeof(int));
+    index_block_read_aggregate(block_start, 0, &(entry_array[0].aggregate));
 
     // copying the rest of the entries
-    memcpy(&entry_array[1], entry1_start, (block_header->index_count - 1) * sizeof(IndexNodeEntry));
+    for (int i = 0; i < block_header->index_count - 1; i++)
+        index_block_read_entry_at(block_start, i, &entry_array[i + 1]);
 }
 
-int index_block_has_available_space(const IndexNodeHeader *block_header, const BPlusMeta *metadata)
+int index_block_has_available_space(const char *block_start, const IndexNodeHeader *block_header,
+                                    const BPlusMeta *metadata, int new_key, int new_right_index)
 {
-    return (block_header->index_count < metadata->max_indexes_per_block);
+    int index_count = block_header->index_count + 1; // with the new entry
+    if (index_count > metadata->max_indexes_per_block)
+        return 0;
+
+    // the counts of a counted block take the end of the block
+    int available_bytes = BF_BLOCK_SIZE - index_count * index_block_slot_size(block_start);
+    if (index_count <= index_block_plain_capacity(block_start))
+        return 1;
+
+    // the entries are sorted by key, so only the first and last key (and the new one) give the key range
+    int min_key = new_key, max_key = new_key;
+    int min_child = new_right_index, max_child = new_right_index;
+    for (int i = 0; i < block_header->index_count - 1; i++) {
+        IndexNodeEntry entry;
+        index_block_read_entry_at(block_start, i, &entry);
+        if (i == 0 && entry.key < min_key)
+            min_key = entry.key;
+        if (i == block_header->index_count - 2 && entry.key > max_key)
+            max_key = entry.key;
+        if (entry.right_index < min_child)
+            min_child = entry.right_index;
+        if (entry.right_index > max_child)
+            max_child = entry.right_index;
+    }
+
+    IndexNodePacking packing;
+    return index_block_packing(min_key, max_key, min_child, max_child, index_count - 1, &packing) <= available_bytes;
 }
 
 void index_block_write_header(char *block_start, const IndexNodeHeader *header)
@@ -148,8 +305,62 @@ void index_block_write_array_as_entries(char *block_start, IndexNodeHeader *bloc
     block_header->min_record_key = entry_array[0].key;
     memcpy(leftmost_index_start, &(entry_array[0].right_index), sizeof(int));
 
-    // copying the rest of the entries
-    memcpy(entry1_start, &entry_array[1], (count - 1) * sizeof(IndexNodeEntry));
+    // the counts (and aggregates) go at the end of the block, whatever the layout of the entries
+    if (index_block_has_counts(block_start)) {
+        for (int i = 0; i < count; i++)
+            index_block_write_aggregate(block_start, i, &entry_array[i].aggregate);
+    }
+
+    // copying the rest of the entries, as they are if they fit
+    int block_type;
+    if (index_block_has_aggregates(block_start))
+        block_type = BLOCK_TYPE_INDEX_AGGREGATED;
+    else if (index_block_has_counts(block_start))
+        block_type = BLOCK_TYPE_INDEX_COUNTED;
+    else
+        block_type = BLOCK_TYPE_INDEX;
+    if (count > index_block_plain_capacity(block_start)) // the packed kind of the same block type
+        block_type = (block_type == BLOCK_TYPE_INDEX_AGGREGATED) ? BLOCK_TYPE_INDEX_PACKED_AGGREGATED
+                   : (block_type == BLOCK_TYPE_INDEX_COUNTED) ? BLOCK_TYPE_INDEX_PACKED_COUNTED
+                   : BLOCK_TYPE_INDEX_PACKED;
+    memcpy(block_start, &block_type, sizeof(int));
+    if (!index_block_is_packed(block_start)) {
+        for (int i = 1; i < count; i++) {
+            memcpy(entry1_start + (i - 1) * 2 * sizeof(int), &entry_array[i].key, sizeof(int));
+            memcpy(entry1_start + (i - 1) * 2 * sizeof(int) + sizeof(int), &entry_array[i].right_index, sizeof(int));
+        }
+        return;
+    }
+
+    // else packed; the entries are sorted by key
+    int min_child = entry_array[1].right_index, max_child = entry_array[1].right_index;
+    for (int i = 2; i < count; i++) {
+        if (entry_array[i].right_index < min_child)
+            min_child = entry_array[i].right_index;
+        if (entry_array[i].right_index > max_child)
+            max_child = entry_array[i].right_index;
+    }
+
+    IndexNodePacking packing;
+    index_block_packing(entry_array[1].key, entry_array[count - 1].key, min_child, max_child, count - 1, &packing);
+    memcpy(entry1_start, &packing, sizeof(IndexNodePacking));
+
+    unsigned char *entry_start = (unsigned char *)entry1_start + sizeof(IndexNodePacking);
+    for (int i = 1; i < count; i++) {
+        write_packed(entry_start, (uint32_t)entry_array[i].key - (uint32_t)packing.key_base, packing.key_width);
+        entry_start += packing.key_width;
+        write_packed(entry_start, (uint32_t)entry_array[i].right_index - (uint32_t)packing.child_base,
+                     packing.child_width);
+        entry_start += packing.child_width;
+    }
+}
+
+// returns the key of the entry at index (the leftmost index is not an entry), without allocating the entry
+static int index_block_read_entry_key(const char *block_start, int index)
+{
+    IndexNodeEntry entry;
+    index_block_read_entry_at(block_start, index, &entry);
+    return entry.key;
 }
 
 // internal binary search to use inside index_block_search_insert_pos(); both start and end are inclusive
@@ -160,55 +371,39 @@ int index_block_binary_search_insert_pos(const char *block_start, const IndexNod
         return start; 
     
     if (start == end) { // there is only one "unsearched" entry remaining
-        IndexNodeEntry *remaining_entry = index_block_read_entry(block_start, block_header, start);
-        if (!remaining_entry) return INDEX_BLOCK_SEARCH_ERROR;
-
-        if (remaining_entry->key == new_key) { // key already exists
-            free(remaining_entry);
+        int remaining_entry_key = index_block_read_entry_key(block_start, start);
+        if (remaining_entry_key == new_key) // key already exists
             return -1;
-        }
-        else if (remaining_entry->key > new_key) {
+        else if (remaining_entry_key > new_key)
             // entry must go in the current position, and the larger ones are to be shifted one place to the right
-            free(remaining_entry);
             return start;
-        }
-        else {
+        else
             // entry must go in the next position, and the larger ones are to be shifted one place to the right
-            free(remaining_entry);
             return start + 1;
-        }
     }
 
     // more than one "unsearched" entries
     int mid = (int)((start + end) / 2); // using the floor of the division
-    IndexNodeEntry *entry_at_mid = index_block_read_entry(block_start, block_header, mid);
-    if (!entry_at_mid) return INDEX_BLOCK_SEARCH_ERROR;
-
-    if (entry_at_mid->key == new_key) { // key already exists
-        free(entry_at_mid);
+    int entry_key_at_mid = index_block_read_entry_key(block_start, mid);
+    if (entry_key_at_mid == new_key) // key already exists
         return -1;
-    }
-    else if (entry_at_mid->key > new_key) {
-        free(entry_at_mid);
+    else if (entry_key_at_mid > new_key)
         return index_block_binary_search_insert_pos(block_start, block_header, start, mid - 1, new_key);
-    }
-    else {
-        free(entry_at_mid);
+    else
         return index_block_binary_search_insert_pos(block_start, block_header, mid + 1, end, new_key);
-    }
 }
 
 int index_block_search_insert_pos(const char *block_start, const IndexNodeHeader *block_header, int new_key)
 {
-    return index_block_binary_search_insert_pos(block_start, block_header, 0, block_header->index_count - 1, new_key);
+    return index_block_binary_search_insert_pos(block_start, block_header, 0, block_header->index_count - 2, new_key);
 }
 
 // internal binary search to use inside index_block_key_search(); both start and end are inclusive
 // returns the same as index_block_key_search()
 int index_block_key_binary_search(const char *block_start, const IndexNodeHeader *block_header, int start, int end, int key)
 {
-    if (start > end) // key is in leftmost index
-        return -1;
+    if (start > end) // key is in the index at the left of start (the leftmost index if end is -1)
+        return end;
         
     if (start == end) { // there is only one "unsearched" entry remaining
         IndexNodeEntry *remaining_entry = index_block_read_entry(block_start, block_header, start);
@@ -251,4 +446,118 @@ int index_block_key_search(const char *block_start, const IndexNodeHeader *block
 {
     int current_entry_count = block_header->index_count - 1;
     return index_block_key_binary_search(block_start, block_header, 0, current_entry_count - 1, key);
+}
+
+int index_block_find_child(const char *block_start, int key)
+{
+    long long lower_key = LLONG_MIN, upper_key = LLONG_MAX;
+    return index_block_find_child_bounds(block_start, key, &lower_key, &upper_key);
+}
+
+int index_block_find_child_bounds(const char *block_start, int key, long long *lower_key, long long *upper_key)
+{
+    IndexNodeHeader block_header;
+    memcpy(&block_header, block_start + sizeof(int), sizeof(IndexNodeHeader));
+
+    const char *leftmost_index_start = block_start + sizeof(int) + sizeof(IndexNodeHeader);
+
+    // end is the index of the last entry with entry.key <= key, or -1 if the key is smaller than all entry keys
+    int end = index_block_find_child_position(block_start, key) - 1;
+
+    // the entry after that one (if any) bounds the child's keys from above
+    if (end + 1 <= block_header.index_count - 2) {
+        IndexNodeEntry next_entry;
+        index_block_read_entry_at(block_start, end + 1, &next_entry);
+        *upper_key = next_entry.key;
+    }
+
+    if (end == -1) {
+        int leftmost_index;
+        memcpy(&leftmost_index, leftmost_index_start, sizeof(int));
+        return leftmost_index;
+    }
+
+    IndexNodeEntry entry;
+    index_block_read_entry_at(block_start, end, &entry);
+    *lower_key = entry.key;
+    return entry.right_index;
+}
+
+int index_block_find_child_position(const char *block_start, int key)
+{
+    IndexNodeHeader block_header;
+    memcpy(&block_header, block_start + sizeof(int), sizeof(IndexNodeHeader));
+
+    // finding the last entry with entry.key <= key; both start and end are inclusive
+    int start = 0;
+    int end = block_header.index_count - 2;
+    while (start <= end) {
+        int mid = (start + end) / 2;
+
+        IndexNodeEntry entry_at_mid;
+        index_block_read_entry_at(block_start, mid, &entry_at_mid);
+
+        if (entry_at_mid.key <= key)
+            start = mid + 1;
+        else
+            end = mid - 1;
+    }
+
+    // end is now the entry's index, or -1 if the key is smaller than all entry keys (the leftmost index)
+    return end + 1;
+}
+
+int index_block_read_child(const char *block_start, int position)
+{
+    if (position == 0)
+        return index_block_read_leftmost_index(block_start);
+
+    IndexNodeEntry entry;
+    index_block_read_entry_at(block_start, position - 1, &entry);
+    return entry.right_index;
+}
+
+int index_block_read_count(const char *block_start, int position)
+{
+    int count;
+    memcpy(&count, index_block_slot_start(block_start, position), sizeof(int));
+    return count;
+}
+
+void index_block_read_aggregate(const char *block_start, int position, BPlusAggregate *aggregate)
+{
+    bplus_aggregate_init(aggregate);
+    if (!index_block_has_counts(block_start))
+        return;
+
+    const char *slot_start = index_block_slot_start(block_start, position);
+    memcpy(&(aggregate->count), slot_start, sizeof(int));
+    if (!index_block_has_aggregates(block_start))
+        return;
+
+    slot_start += sizeof(int);
+    memcpy(&(aggregate->min), slot_start, sizeof(BPlusAggregateValue));
+    memcpy(&(aggregate->max), slot_start + sizeof(BPlusAggregateValue), sizeof(BPlusAggregateValue));
+    memcpy(&(aggregate->sum), slot_start + 2 * sizeof(BPlusAggregateValue), sizeof(BPlusAggregateValue));
+}
+
+void index_block_write_aggregate(char *block_start, int position, const BPlusAggregate *aggregate)
+{
+    char *slot_start = (char *)index_block_slot_start(block_start, position);
+    memcpy(slot_start, &(aggregate->count), sizeof(int));
+    if (!index_block_has_aggregates(block_start))
+        return;
+
+    slot_start += sizeof(int);
+    memcpy(slot_start, &(aggregate->min), sizeof(BPlusAggregateValue));
+    memcpy(slot_start + sizeof(BPlusAggregateValue), &(aggregate->max), sizeof(BPlusAggregateValue));
+    memcpy(slot_start + 2 * sizeof(BPlusAggregateValue), &(aggregate->sum), sizeof(BPlusAggregateValue));
+}
+
+void index_block_add_to_aggregate(char *block_start, int position, const BPlusAggregate *delta, DataType type)
+{
+    BPlusAggregate aggregate;
+    index_block_read_aggregate(block_start, position, &aggregate);
+    bplus_aggregate_merge(&aggregate, delta, type);
+    index_block_write_aggregate(block_start, position, &aggregate);
 }
\ No newline at end of file
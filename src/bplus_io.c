@@ -0,0 +1,68 @@
+#define _POSIX_C_SOURCE 200112L // posix_fadvise(), fdatasync()
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/bplus_io.h"
+
+// drops the clean kernel copies of all blocks of the file
+static void drop_os_cache(BPlusHandle *handle)
+{
+    posix_fadvise(handle->io_fd, 0, 0, POSIX_FADV_DONTNEED);
+    handle->io_operations = 0;
+}
+
+int bplus_set_io_mode(int file_desc, int mode)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+
+    if (mode == BPLUS_IO_BUFFERED) {
+        if (handle->io_fd != -1) {
+            close(handle->io_fd);
+            handle->io_fd = -1;
+        }
+        handle->io_mode = BPLUS_IO_BUFFERED;
+        return 0;
+    }
+
+    if (mode != BPLUS_IO_UNCACHED)
+        return -1;
+
+    // a descriptor of our own is enough for posix_fadvise(), as the page cache is shared by all descriptors of a file
+    if (handle->io_fd == -1) {
+        handle->io_fd = open(handle->file_name, O_RDONLY);
+        if (handle->io_fd == -1)
+            return -1;
+    }
+
+    handle->io_mode = BPLUS_IO_UNCACHED;
+    drop_os_cache(handle); // the blocks read so far are already in BF frames or not needed
+    return 0;
+}
+
+void bplus_io_account(int file_desc, int operation_count)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || handle->io_mode != BPLUS_IO_UNCACHED)
+        return;
+
+    handle->io_operations += operation_count;
+    if (handle->io_operations >= BPLUS_IO_DROP_INTERVAL)
+        drop_os_cache(handle);
+}
+
+void bplus_io_close(BPlusHandle *handle)
+{
+    if (handle->io_fd == -1)
+        return;
+
+    // BF has written back its dirty blocks by now; once they reach the device, their kernel copies can be dropped too
+    if (handle->io_mode == BPLUS_IO_UNCACHED) {
+        fdatasync(handle->io_fd);
+        drop_os_cache(handle);
+    }
+
+    close(handle->io_fd);
+    handle->io_fd = -1;
+}
@@ -0,0 +1,97 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/bplus_key.h"
+
+// returns the bytes that attribute takes in a normalized key (0 for a type that cannot be part of a key)
+static int attribute_width(const AttributeSchema *attribute)
+{
+    switch (attribute->type) {
+        case TYPE_INT:
+        case TYPE_FLOAT:
+            return 4;
+        case TYPE_LONG:
+            return 8;
+        case TYPE_CHAR:
+            return (attribute->length <= MAX_STRING_LENGTH) ? attribute->length : 0;
+        default:
+            return 0;
+    }
+}
+
+// writes value to key, most significant byte first
+static void put_big_endian(unsigned char *key, uint32_t value)
+{
+    key[0] = (unsigned char)(value >> 24);
+    key[1] = (unsigned char)(value >> 16);
+    key[2] = (unsigned char)(value >> 8);
+    key[3] = (unsigned char)value;
+}
+
+int bplus_key_format_init(BPlusKeyFormat *format, const TableSchema *schema, const char *attr_names)
+{
+    format->attribute_count = 0;
+    format->length = 0;
+
+    const char *name = attr_names;
+    while (1) {
+        size_t name_length = strcspn(name, ",");
+
+        int position = -1;
+        for (int i = 0; i < schema->count && position == -1; i++) {
+            if (strlen(schema->attributes[i].name) == name_length &&
+                strncmp(schema->attributes[i].name, name, name_length) == 0)
+                position = i;
+        }
+        for (int i = 0; i < format->attribute_count && position != -1; i++) {
+            if (format->attributes[i] == position)
+                position = -1; // repeated
+        }
+        if (position == -1 || format->attribute_count == MAX_ATTRIBUTES ||
+            attribute_width(&(schema->attributes[position])) == 0)
+            return -1;
+
+        format->attributes[(format->attribute_count)++] = position;
+        format->length += attribute_width(&(schema->attributes[position]));
+
+        if (name[name_length] == '\0')
+            return 0;
+        name += name_length + 1;
+    }
+}
+
+void bplus_key_encode(const BPlusKeyFormat *format, const TableSchema *schema, const Record *record,
+                      unsigned char *key)
+{
+    for (int i = 0; i < format->attribute_count; i++) {
+        const AttributeSchema *attribute = &(schema->attributes[format->attributes[i]]);
+        const FieldValue *value = &(record->values[format->attributes[i]]);
+
+        if (attribute->type == TYPE_INT) {
+            put_big_endian(key, (uint32_t)value->int_value ^ 0x80000000u);
+        }
+        else if (attribute->type == TYPE_FLOAT) {
+            float float_value = (value->float_value == 0) ? 0 : value->float_value; // -0.0 as 0.0
+            uint32_t bits;
+            memcpy(&bits, &float_value, sizeof(bits));
+            put_big_endian(key, (bits & 0x80000000u) ? ~bits : (bits ^ 0x80000000u));
+        }
+        else if (attribute->type == TYPE_LONG) {
+            uint64_t bits = (uint64_t)value->long_value ^ 0x8000000000000000ull;
+            put_big_endian(key, (uint32_t)(bits >> 32));
+            put_big_endian(key + 4, (uint32_t)bits);
+        }
+        else {
+            size_t string_length = strnlen(value->string_value, attribute->length);
+            memcpy(key, value->string_value, string_length);
+            memset(key + string_length, 0, attribute->length - string_length);
+        }
+
+        key += attribute_width(attribute);
+    }
+}
+
+int bplus_key_compare(const BPlusKeyFormat *format, const unsigned char *key1, const unsigned char *key2)
+{
+    return memcmp(key1, key2, format->length);
+}
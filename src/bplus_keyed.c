@@ -0,0 +1,802 @@
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_keyed.h"
+
+#define KEYED_DATA_KEYS_START ((int)(sizeof(int) + sizeof(KeyedDataHeader)))
+#define KEYED_INDEX_ENTRIES_START ((int)(sizeof(int) + sizeof(KeyedIndexHeader)))
+#define KEYED_INDEX_CAPACITY (BF_BLOCK_SIZE - KEYED_INDEX_ENTRIES_START) // bytes for the prefix and the entries
+#define KEYED_ENTRY_MAX_SIZE (1 + BPLUS_KEY_MAX_LENGTH + (int)sizeof(int))
+// with one entry over; an entry has at least 5 bytes, but one of them may have an empty suffix
+#define KEYED_INDEX_MAX_ENTRIES (KEYED_INDEX_CAPACITY / (1 + (int)sizeof(int)) + 2)
+
+// gets the block with block_index, pinned in block, as a block of the given access (see bplus_pool.h)
+// no other block of the file may be pinned, so that the quotas and the scan ring can be enforced
+// returns 0 on success, -1 otherwise
+static int get_block(int file_desc, int block_index, BF_Block *block, int access_hint)
+{
+    bplus_pool_check(file_desc);
+    if (BF_GetBlock(file_desc, block_index, block) != BF_OK)
+        return -1;
+    bplus_handle_touch(file_desc, block_index, access_hint);
+    return 0;
+}
+
+// allocates a block at the end of the file, pinned in block, and counts it in metadata
+// returns its index, or -1 if unsuccessful
+static int allocate_block(int file_desc, BPlusMeta *metadata, BF_Block *block)
+{
+    if (BF_AllocateBlock(file_desc, block) != BF_OK)
+        return -1;
+    metadata->block_count++;
+    return metadata->block_count - 1;
+}
+
+// returns the block type of the block that starts at block_start
+static int block_type(const char *block_start)
+{
+    int type;
+    memcpy(&type, block_start, sizeof(int));
+    return type;
+}
+
+// returns 1 if the index blocks of the file of metadata have fixed size entries (LONG key files), 0 otherwise
+static int has_fixed_entries(const BPlusMeta *metadata)
+{
+    return bplus_file_has_long_keys(metadata);
+}
+
+// returns the bytes of the separators of the fixed size index entries of the file of metadata, without the first
+// prefix_length bytes, or -1 if its entries have a length byte
+// the entry helpers below take it as fixed: with prefix_length 0 for whole separators, or with the prefix_length of an
+// index block for the suffixes in it
+static int fixed_length(const BPlusMeta *metadata, int prefix_length)
+{
+    return has_fixed_entries(metadata) ? metadata->key_format.length - prefix_length : -1;
+}
+
+// returns the bytes of the separator of the index entry that starts at entry
+static int entry_length(int fixed, const unsigned char *entry)
+{
+    return (fixed >= 0) ? fixed : entry[0];
+}
+
+// returns the separator of the index entry that starts at entry
+static const unsigned char *entry_separator(int fixed, const unsigned char *entry)
+{
+    return (fixed >= 0) ? entry : entry + 1;
+}
+
+// returns the bytes of the index entry that starts at entry
+static int entry_size(int fixed, const unsigned char *entry)
+{
+    return ((fixed >= 0) ? 0 : 1) + entry_length(fixed, entry) + (int)sizeof(int);
+}
+
+// returns the child of the index entry that starts at entry
+static int entry_child(int fixed, const unsigned char *entry)
+{
+    int child;
+    memcpy(&child, entry_separator(fixed, entry) + entry_length(fixed, entry), sizeof(int));
+    return child;
+}
+
+// writes the index entry of the separator of length bytes and child to entry
+// returns its bytes
+static int write_entry(int fixed, unsigned char *entry, const unsigned char *separator, int length, int child)
+{
+    int header_size = 0;
+    if (fixed < 0) {
+        entry[0] = (unsigned char)length;
+        header_size = 1;
+    }
+    memcpy(entry + header_size, separator, length);
+    memcpy(entry + header_size + length, &child, sizeof(int));
+    return header_size + length + (int)sizeof(int);
+}
+
+// returns the normalized key at position of a keyed data block of the file of metadata
+static const unsigned char *data_block_key(const char *block_start, const BPlusMeta *metadata, int position)
+{
+    return (const unsigned char *)block_start + KEYED_DATA_KEYS_START + position * metadata->key_format.length;
+}
+
+// returns the offset of the record at position in a keyed data block of the file of metadata
+static int data_block_record_offset(const BPlusMeta *metadata, int position)
+{
+    return KEYED_DATA_KEYS_START + metadata->max_records_per_block * metadata->key_format.length
+        + position * (int)sizeof(Record);
+}
+
+// searches the record_count keys of a keyed data block for key
+// found gets 1 if the block has key, 0 if not
+// returns the position of key, or of the first key greater than it
+static int data_block_search(const char *block_start, const BPlusMeta *metadata, int record_count,
+                             const unsigned char *key, int *found)
+{
+    int low = 0;
+    int high = record_count;
+    *found = 0;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        int comparison = memcmp(data_block_key(block_start, metadata, middle), key, metadata->key_format.length);
+        if (comparison == 0) {
+            *found = 1;
+            return middle;
+        }
+
+        if (comparison < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+// returns the child of a keyed index block of the file of metadata that key belongs under; position gets the entry of
+// that child (-1 for the first child)
+static int index_block_child(const char *block_start, const BPlusMeta *metadata, const unsigned char *key,
+                             int *position)
+{
+    KeyedIndexHeader header;
+    memcpy(&header, block_start + sizeof(int), sizeof(KeyedIndexHeader));
+    const unsigned char *prefix = (const unsigned char *)block_start + KEYED_INDEX_ENTRIES_START;
+    const unsigned char *entries = prefix + header.prefix_length;
+    int fixed = fixed_length(metadata, header.prefix_length);
+
+    // the prefix is compared once: a key below it is below every separator, and a key above it is above every one;
+    // otherwise only the rest of the key is compared with the suffixes
+    int comparison = memcmp(key, prefix, header.prefix_length);
+    const unsigned char *suffix = key + header.prefix_length;
+    if (comparison < 0 || header.entry_count == 0) {
+        *position = -1;
+        return header.first_index;
+    }
+
+    // fixed size entries are binary searched for the last separator that is at most key
+    if (fixed >= 0) {
+        int size = fixed + (int)sizeof(int);
+        int low = (comparison > 0) ? header.entry_count : 0;
+        int high = header.entry_count;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (memcmp(suffix, entries + middle * size, fixed) < 0)
+                high = middle;
+            else
+                low = middle + 1;
+        }
+
+        *position = low - 1;
+        return (low == 0) ? header.first_index : entry_child(fixed, entries + (low - 1) * size);
+    }
+
+    int child = header.first_index;
+    *position = -1;
+
+    const unsigned char *entry = entries;
+    for (int i = 0; i < header.entry_count; i++) {
+        if (comparison == 0 && memcmp(suffix, entry_separator(fixed, entry), entry_length(fixed, entry)) < 0)
+            break;
+
+        child = entry_child(fixed, entry);
+        *position = i;
+        entry += entry_size(fixed, entry);
+    }
+
+    return child;
+}
+
+// descends from the root of the keyed tree of metadata to the data block that key belongs in, which is left pinned in
+// block; path gets the index blocks on the way (from the root), positions the entry followed in each (-1 for the
+// first child), and depth their number, if path is not NULL
+// returns the index of the data block, or -1 if unsuccessful
+static int find_data_block(int file_desc, const BPlusMeta *metadata, const unsigned char *key, BF_Block *block,
+                           int *path, int *positions, int *depth)
+{
+    int block_index = metadata->root_index;
+    for (int level = 0; level <= BPLUS_KEYED_MAX_DEPTH; level++) {
+        if (get_block(file_desc, block_index, block, BPLUS_ACCESS_NORMAL) == -1)
+            return -1;
+        const char *block_start = BF_Block_GetData(block);
+
+        int type = block_type(block_start);
+        if (type == BLOCK_TYPE_KEYED_DATA) {
+            if (path)
+                *depth = level;
+            return block_index;
+        }
+        if (type != BLOCK_TYPE_KEYED_INDEX || level == BPLUS_KEYED_MAX_DEPTH)
+            break;
+
+        int position;
+        int child = index_block_child(block_start, metadata, key, &position);
+        if (path) {
+            path[level] = block_index;
+            positions[level] = position;
+        }
+
+        BF_UnpinBlock(block);
+        block_index = child;
+    }
+
+    BF_UnpinBlock(block);
+    return -1;
+}
+
+int bplus_keyed_data_capacity(const BPlusKeyFormat *format)
+{
+    return (BF_BLOCK_SIZE - KEYED_DATA_KEYS_START) / (format->length + (int)sizeof(Record));
+}
+
+// writes the separator of the keys left_key < right_key of a split to separator: the shortest prefix of right_key
+// that is greater than left_key, or all of right_key for fixed size index entries
+// returns its length
+static int make_separator(const BPlusMeta *metadata, const unsigned char *left_key, const unsigned char *right_key,
+                          unsigned char *separator)
+{
+    int length = 0;
+    while (length < metadata->key_format.length - 1 && left_key[length] == right_key[length])
+        length++;
+    length++; // up to the first byte where they differ
+    if (has_fixed_entries(metadata))
+        length = metadata->key_format.length;
+
+    memcpy(separator, right_key, length);
+    return length;
+}
+
+// the entries of a keyed index block, and one more, with their whole separators, while a separator is added to it
+struct index_entries {
+    int count;
+    int first_index;
+    int offsets[KEYED_INDEX_MAX_ENTRIES + 1]; // of each entry in bytes; offsets[count] is the end of the last one
+    unsigned char bytes[KEYED_INDEX_MAX_ENTRIES * KEYED_ENTRY_MAX_SIZE];
+};
+
+// returns the bytes that the separators of the entries first to last - 1 of entries start with (0 for no entries);
+// the separators ascend, so these are the bytes that the first and the last one share
+static int common_prefix(const BPlusMeta *metadata, const struct index_entries *entries, int first, int last)
+{
+    if (first >= last)
+        return 0;
+
+    int fixed = fixed_length(metadata, 0);
+    const unsigned char *first_entry = entries->bytes + entries->offsets[first];
+    const unsigned char *last_entry = entries->bytes + entries->offsets[last - 1];
+    const unsigned char *first_separator = entry_separator(fixed, first_entry);
+    const unsigned char *last_separator = entry_separator(fixed, last_entry);
+    int limit = entry_length(fixed, first_entry);
+    if (entry_length(fixed, last_entry) < limit)
+        limit = entry_length(fixed, last_entry);
+
+    int prefix_length = 0;
+    while (prefix_length < limit && first_separator[prefix_length] == last_separator[prefix_length])
+        prefix_length++;
+    return prefix_length;
+}
+
+// returns the bytes that the entries first to last - 1 of entries take in a keyed index block: their common prefix
+// once, and every entry without it
+static int index_block_size(const BPlusMeta *metadata, const struct index_entries *entries, int first, int last)
+{
+    int prefix_length = common_prefix(metadata, entries, first, last);
+    return prefix_length + entries->offsets[last] - entries->offsets[first] - (last - first) * prefix_length;
+}
+
+// writes the entries first to last - 1 of entries to a keyed index block of the file of metadata, with first_index as
+// its first child: the prefix of their separators once, then the entries with the rest of their separators
+static void write_index_block(char *block_start, const BPlusMeta *metadata, const struct index_entries *entries,
+                              int first_index, int first, int last)
+{
+    int prefix_length = common_prefix(metadata, entries, first, last);
+    int fixed = fixed_length(metadata, 0);
+    int block_fixed = fixed_length(metadata, prefix_length);
+
+    unsigned char *prefix = (unsigned char *)block_start + KEYED_INDEX_ENTRIES_START;
+    if (first < last)
+        memcpy(prefix, entry_separator(fixed, entries->bytes + entries->offsets[first]), prefix_length);
+
+    unsigned char *entry = prefix + prefix_length;
+    for (int i = first; i < last; i++) {
+        const unsigned char *source = entries->bytes + entries->offsets[i];
+        entry += write_entry(block_fixed, entry, entry_separator(fixed, source) + prefix_length,
+                             entry_length(fixed, source) - prefix_length, entry_child(fixed, source));
+    }
+
+    int type = BLOCK_TYPE_KEYED_INDEX;
+    KeyedIndexHeader header = { last - first, (int)(entry - (prefix + prefix_length)), first_index, prefix_length };
+    memcpy(block_start, &type, sizeof(int));
+    memcpy(block_start + sizeof(int), &header, sizeof(KeyedIndexHeader));
+}
+
+// adds the entry (separator of length bytes, child) to the keyed index block with block_index, after its entry at
+// position (-1 for the first child); if the block has no room, it is split: its first half stays, the second half goes
+// to a new block, and the separator between them is written to separator and length, for the parent
+// block is an initialized BF block handle, and other another one
+// returns the index of the new block, 0 if the block was not split, or -1 if unsuccessful
+static int add_index_entry(int file_desc, BPlusMeta *metadata, int block_index, int position,
+                           unsigned char *separator, int *length, int child, BF_Block *block, BF_Block *other)
+{
+    if (get_block(file_desc, block_index, block, BPLUS_ACCESS_NORMAL) == -1)
+        return -1;
+    char *block_start = BF_Block_GetData(block);
+
+    KeyedIndexHeader header;
+    memcpy(&header, block_start + sizeof(int), sizeof(KeyedIndexHeader));
+
+    // the entries with the new one after position, with the offset of each, and the prefix of the block put back on
+    // their separators
+    int fixed = fixed_length(metadata, 0);
+    int block_fixed = fixed_length(metadata, header.prefix_length);
+    unsigned char whole[BPLUS_KEY_MAX_LENGTH];
+    memcpy(whole, block_start + KEYED_INDEX_ENTRIES_START, header.prefix_length);
+
+    struct index_entries entries;
+    entries.count = 0;
+    entries.first_index = header.first_index;
+    const unsigned char *entry = (const unsigned char *)block_start + KEYED_INDEX_ENTRIES_START + header.prefix_length;
+    int offset = 0;
+    for (int i = 0; i <= header.entry_count; i++) {
+        if (i == position + 1) {
+            entries.offsets[entries.count++] = offset;
+            offset += write_entry(fixed, entries.bytes + offset, separator, *length, child);
+        }
+        if (i == header.entry_count)
+            break;
+
+        int suffix_length = entry_length(block_fixed, entry);
+        memcpy(whole + header.prefix_length, entry_separator(block_fixed, entry), suffix_length);
+        entries.offsets[entries.count++] = offset;
+        offset += write_entry(fixed, entries.bytes + offset, whole, header.prefix_length + suffix_length,
+                              entry_child(block_fixed, entry));
+        entry += entry_size(block_fixed, entry);
+    }
+    entries.offsets[entries.count] = offset;
+
+    if (index_block_size(metadata, &entries, 0, entries.count) <= KEYED_INDEX_CAPACITY) {
+        write_index_block(block_start, metadata, &entries, entries.first_index, 0, entries.count);
+        BF_Block_SetDirty(block);
+        BF_UnpinBlock(block);
+        return 0;
+    }
+
+    // the middle entry goes up: the entries before it stay, and its child is the first child of the new block, with
+    // the entries after it; the halves are as even as their sizes with their own prefixes allow (a half may share
+    // less of a prefix than the block did), and the new entry itself can always go up, as the old entries on either
+    // side of it fitted in the block
+    int middle = position + 1;
+    int middle_size = KEYED_INDEX_CAPACITY + 1;
+    for (int i = 0; i < entries.count; i++) {
+        int left_size = index_block_size(metadata, &entries, 0, i);
+        int right_size = index_block_size(metadata, &entries, i + 1, entries.count);
+        int larger = (left_size > right_size) ? left_size : right_size;
+        if (larger < middle_size) {
+            middle = i;
+            middle_size = larger;
+        }
+    }
+
+    int new_index = allocate_block(file_desc, metadata, other);
+    if (new_index == -1) {
+        BF_UnpinBlock(block);
+        return -1;
+    }
+
+    const unsigned char *middle_entry = entries.bytes + entries.offsets[middle];
+    int middle_child = entry_child(fixed, middle_entry);
+    write_index_block(BF_Block_GetData(other), metadata, &entries, middle_child, middle + 1, entries.count);
+    BF_Block_SetDirty(other);
+    BF_UnpinBlock(other);
+
+    write_index_block(block_start, metadata, &entries, entries.first_index, 0, middle);
+    BF_Block_SetDirty(block);
+    BF_UnpinBlock(block);
+
+    *length = entry_length(fixed, middle_entry);
+    memcpy(separator, entry_separator(fixed, middle_entry), *length);
+    return new_index;
+}
+
+// makes a keyed index block with the children left_index and right_index, and the separator of length bytes between
+// them, the root of the tree of metadata
+// returns 0 on success, -1 if unsuccessful
+static int add_root(int file_desc, BPlusMeta *metadata, int left_index, const unsigned char *separator, int length,
+                    int right_index, BF_Block *block)
+{
+    int root_index = allocate_block(file_desc, metadata, block);
+    if (root_index == -1)
+        return -1;
+
+    struct index_entries entries;
+    entries.count = 1;
+    entries.offsets[0] = 0;
+    entries.offsets[1] = write_entry(fixed_length(metadata, 0), entries.bytes, separator, length, right_index);
+
+    write_index_block(BF_Block_GetData(block), metadata, &entries, left_index, 0, 1);
+    BF_Block_SetDirty(block);
+    BF_UnpinBlock(block);
+
+    metadata->root_index = root_index;
+    return 0;
+}
+
+// writes record_count records and their keys to a keyed data block of the file of metadata, with next_index
+static void write_data_block(char *block_start, const BPlusMeta *metadata, const unsigned char *keys,
+                             const Record *records, int record_count, int next_index)
+{
+    int type = BLOCK_TYPE_KEYED_DATA;
+    KeyedDataHeader header = { record_count, next_index };
+    memcpy(block_start, &type, sizeof(int));
+    memcpy(block_start + sizeof(int), &header, sizeof(KeyedDataHeader));
+    memcpy(block_start + KEYED_DATA_KEYS_START, keys, record_count * metadata->key_format.length);
+    memcpy(block_start + data_block_record_offset(metadata, 0), records, record_count * sizeof(Record));
+}
+
+// stores record with key in the keyed tree of metadata, splitting the blocks on the way up as needed
+// block and other are initialized BF block handles
+// returns the index of the data block of the record, -2 if the tree has its key, or -1 if unsuccessful
+static int insert_record(int file_desc, BPlusMeta *metadata, const Record *record, const unsigned char *key,
+                         BF_Block *block, BF_Block *other)
+{
+    int key_length = metadata->key_format.length;
+
+    // the first record makes a data block that is the root
+    if (metadata->root_index == -1) {
+        int root_index = allocate_block(file_desc, metadata, block);
+        if (root_index == -1)
+            return -1;
+
+        write_data_block(BF_Block_GetData(block), metadata, key, record, 1, -1);
+        BF_Block_SetDirty(block);
+        BF_UnpinBlock(block);
+        metadata->root_index = root_index;
+        return root_index;
+    }
+
+    int path[BPLUS_KEYED_MAX_DEPTH];
+    int positions[BPLUS_KEYED_MAX_DEPTH];
+    int depth;
+    int leaf_index = find_data_block(file_desc, metadata, key, block, path, positions, &depth);
+    if (leaf_index == -1)
+        return -1;
+    char *leaf_start = BF_Block_GetData(block);
+
+    KeyedDataHeader header;
+    memcpy(&header, leaf_start + sizeof(int), sizeof(KeyedDataHeader));
+    int found;
+    int position = data_block_search(leaf_start, metadata, header.record_count, key, &found);
+    if (found) {
+        BF_UnpinBlock(block);
+        return -2;
+    }
+
+    // the keys and records of the block with the new one at position
+    unsigned char keys[(BPLUS_KEYED_MAX_RECORDS + 1) * BPLUS_KEY_MAX_LENGTH];
+    Record records[BPLUS_KEYED_MAX_RECORDS + 1];
+    int count = header.record_count;
+    memcpy(keys, leaf_start + KEYED_DATA_KEYS_START, position * key_length);
+    memcpy(keys + position * key_length, key, key_length);
+    memcpy(keys + (position + 1) * key_length, data_block_key(leaf_start, metadata, position),
+           (count - position) * key_length);
+    memcpy(records, leaf_start + data_block_record_offset(metadata, 0), position * sizeof(Record));
+    memcpy(&(records[position]), record, sizeof(Record));
+    memcpy(&(records[position + 1]), leaf_start + data_block_record_offset(metadata, position),
+           (count - position) * sizeof(Record));
+    count++;
+
+    if (count <= metadata->max_records_per_block) {
+        write_data_block(leaf_start, metadata, keys, records, count, header.next_index);
+        BF_Block_SetDirty(block);
+        BF_UnpinBlock(block);
+        return leaf_index;
+    }
+
+    // a full block keeps the first half of the records, and a new block after it in key order gets the rest
+    int new_index = allocate_block(file_desc, metadata, other);
+    if (new_index == -1) {
+        BF_UnpinBlock(block);
+        return -1;
+    }
+
+    int left_count = (count + 1) / 2;
+    write_data_block(BF_Block_GetData(other), metadata, keys + left_count * key_length, &(records[left_count]),
+                     count - left_count, header.next_index);
+    BF_Block_SetDirty(other);
+    BF_UnpinBlock(other);
+
+    write_data_block(leaf_start, metadata, keys, records, left_count, new_index);
+    BF_Block_SetDirty(block);
+    BF_UnpinBlock(block);
+
+    int inserted_index = (position < left_count) ? leaf_index : new_index;
+
+    // the separator of the new block goes up the path, for as long as the blocks on it split
+    unsigned char separator[BPLUS_KEY_MAX_LENGTH];
+    int length = make_separator(metadata, keys + (left_count - 1) * key_length, keys + left_count * key_length,
+                                separator);
+    int left_index = leaf_index;
+    int right_index = new_index;
+    for (int level = depth - 1; level >= 0; level--) {
+        right_index = add_index_entry(file_desc, metadata, path[level], positions[level], separator, &length,
+                                      right_index, block, other);
+        if (right_index == -1)
+            return -1;
+        if (right_index == 0)
+            return inserted_index;
+        left_index = path[level];
+    }
+
+    // the root split, so a new root goes above it
+    if (add_root(file_desc, metadata, left_index, separator, length, right_index, block) == -1)
+        return -1;
+    return inserted_index;
+}
+
+int bplus_keyed_insert(int file_desc, BPlusMeta *metadata, const Record *record)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !bplus_file_is_keyed(metadata) || bplus_mmap_is_mapped(handle) || handle->insert_block_count < 2)
+        return -1;
+
+    bplus_io_account(file_desc, 1);
+
+    unsigned char key[BPLUS_KEY_MAX_LENGTH];
+    bplus_key_encode(&(metadata->key_format), &(metadata->schema), record, key);
+
+    // the block handles are borrowed from the file's insert_blocks, as in tree_lookup()
+    BF_Block *block = handle->insert_blocks[--(handle->insert_block_count)];
+    BF_Block *other = handle->insert_blocks[--(handle->insert_block_count)];
+
+    // the counts and the root are read from block 0, and written back with the changes of the insert
+    int result = -1;
+    if (get_block(file_desc, 0, block, BPLUS_ACCESS_NORMAL) == 0) {
+        BPlusMeta header_metadata;
+        memcpy(&header_metadata, BF_Block_GetData(block), sizeof(BPlusMeta));
+        BF_UnpinBlock(block);
+
+        int block_count = header_metadata.block_count;
+        result = insert_record(file_desc, &header_metadata, record, key, block, other);
+        if (result >= 0) {
+            header_metadata.record_count++;
+            header_metadata.modification_count++;
+        }
+
+        // block 0 also gets the blocks of an insert that failed half way, so that it counts every block of the file
+        if (result >= 0 || header_metadata.block_count != block_count) {
+            if (get_block(file_desc, 0, block, BPLUS_ACCESS_NORMAL) == 0) {
+                memcpy(BF_Block_GetData(block), &header_metadata, sizeof(BPlusMeta));
+                BF_Block_SetDirty(block);
+                BF_UnpinBlock(block);
+                memcpy(metadata, &header_metadata, sizeof(BPlusMeta)); // updating the external metadata
+            }
+            else {
+                result = -1;
+            }
+        }
+    }
+
+    handle->insert_blocks[(handle->insert_block_count)++] = other;
+    handle->insert_blocks[(handle->insert_block_count)++] = block;
+    return (result >= 0) ? result : -1;
+}
+
+int bplus_keyed_update(int file_desc, BPlusMeta *metadata, const Record *record)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !bplus_file_is_keyed(metadata) || bplus_mmap_is_mapped(handle) || handle->insert_block_count == 0)
+        return -1;
+
+    bplus_io_account(file_desc, 1);
+    if (metadata->root_index == -1) // empty tree
+        return 0;
+
+    unsigned char key[BPLUS_KEY_MAX_LENGTH];
+    bplus_key_encode(&(metadata->key_format), &(metadata->schema), record, key);
+
+    BF_Block *block = handle->insert_blocks[--(handle->insert_block_count)];
+    int result = -1;
+    if (find_data_block(file_desc, metadata, key, block, NULL, NULL, NULL) != -1) {
+        char *block_start = BF_Block_GetData(block);
+
+        KeyedDataHeader header;
+        memcpy(&header, block_start + sizeof(int), sizeof(KeyedDataHeader));
+        int found;
+        int position = data_block_search(block_start, metadata, header.record_count, key, &found);
+        if (found) {
+            memcpy(block_start + data_block_record_offset(metadata, position), record, sizeof(Record));
+            BF_Block_SetDirty(block);
+        }
+        result = found;
+        BF_UnpinBlock(block);
+    }
+
+    // the change is counted in block 0, as an insert is
+    if (result == 1) {
+        if (get_block(file_desc, 0, block, BPLUS_ACCESS_NORMAL) == 0) {
+            BPlusMeta header_metadata;
+            memcpy(&header_metadata, BF_Block_GetData(block), sizeof(BPlusMeta));
+            header_metadata.modification_count++;
+            memcpy(BF_Block_GetData(block), &header_metadata, sizeof(BPlusMeta));
+            BF_Block_SetDirty(block);
+            BF_UnpinBlock(block);
+            memcpy(metadata, &header_metadata, sizeof(BPlusMeta)); // updating the external metadata
+        }
+        else {
+            result = -1;
+        }
+    }
+
+    handle->insert_blocks[(handle->insert_block_count)++] = block;
+    return result;
+}
+
+int bplus_keyed_get(int file_desc, const BPlusMeta *metadata, const Record *probe, Record *out_record)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || !probe || !bplus_file_is_keyed(metadata) || bplus_mmap_is_mapped(handle)
+        || handle->insert_block_count == 0)
+        return -1;
+
+    bplus_io_account(file_desc, 1);
+    if (metadata->root_index == -1) // empty tree
+        return 0;
+
+    unsigned char key[BPLUS_KEY_MAX_LENGTH];
+    bplus_key_encode(&(metadata->key_format), &(metadata->schema), probe, key);
+
+    BF_Block *block = handle->insert_blocks[--(handle->insert_block_count)];
+    int result = -1;
+    if (find_data_block(file_desc, metadata, key, block, NULL, NULL, NULL) != -1) {
+        const char *block_start = BF_Block_GetData(block);
+
+        KeyedDataHeader header;
+        memcpy(&header, block_start + sizeof(int), sizeof(KeyedDataHeader));
+        int found;
+        int position = data_block_search(block_start, metadata, header.record_count, key, &found);
+        if (found && out_record)
+            memcpy(out_record, block_start + data_block_record_offset(metadata, position), sizeof(Record));
+        result = found;
+
+        BF_UnpinBlock(block);
+    }
+
+    handle->insert_blocks[(handle->insert_block_count)++] = block;
+    return result;
+}
+
+// copies the records of the keyed data block that block_start points to into the scan, starting from the first one
+// whose key is at least key (from the first record if key is NULL)
+static void copy_block_records(BPlusKeyedScan *scan, const char *block_start, const unsigned char *key)
+{
+    KeyedDataHeader header;
+    memcpy(&header, block_start + sizeof(int), sizeof(KeyedDataHeader));
+
+    int found;
+    int first = key ? data_block_search(block_start, scan->metadata, header.record_count, key, &found) : 0;
+    scan->record_count = header.record_count - first;
+    memcpy(scan->records, block_start + data_block_record_offset(scan->metadata, first),
+           scan->record_count * sizeof(Record));
+    scan->position = 0;
+    scan->next_block_index = header.next_index;
+}
+
+int bplus_keyed_scan_open(BPlusKeyedScan *scan, int file_desc, const BPlusMeta *metadata, const Record *start)
+{
+    memset(scan, 0, sizeof(BPlusKeyedScan));
+    scan->file_desc = file_desc;
+    scan->metadata = metadata;
+    scan->next_block_index = -1;
+
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || !bplus_file_is_keyed(metadata) || bplus_mmap_is_mapped(handle))
+        return -1;
+    if (metadata->root_index == -1) // empty tree
+        return 0;
+
+    // the smallest normalized key is all zero bytes, so it leads to the first data block
+    unsigned char key[BPLUS_KEY_MAX_LENGTH];
+    memset(key, 0, sizeof(key));
+    if (start)
+        bplus_key_encode(&(metadata->key_format), &(metadata->schema), start, key);
+
+    BF_Block *block;
+    BF_Block_Init(&block);
+    int result = -1;
+    if (find_data_block(file_desc, metadata, key, block, NULL, NULL, NULL) != -1) {
+        copy_block_records(scan, BF_Block_GetData(block), start ? key : NULL);
+        BF_UnpinBlock(block);
+        result = 0;
+    }
+
+    BF_Block_Destroy(&block);
+    return result;
+}
+
+int bplus_keyed_scan_next(BPlusKeyedScan *scan, Record *record)
+{
+    while (scan->position == scan->record_count) {
+        if (scan->next_block_index == -1)
+            return 0;
+
+        BF_Block *block;
+        BF_Block_Init(&block);
+        if (get_block(scan->file_desc, scan->next_block_index, block, BPLUS_ACCESS_SCAN) == -1) {
+            BF_Block_Destroy(&block);
+            return -1;
+        }
+
+        const char *block_start = BF_Block_GetData(block);
+        int result = (block_type(block_start) == BLOCK_TYPE_KEYED_DATA) ? 0 : -1;
+        if (result == 0)
+            copy_block_records(scan, block_start, NULL);
+
+        BF_UnpinBlock(block);
+        BF_Block_Destroy(&block);
+        if (result == -1)
+            return -1;
+    }
+
+    memcpy(record, &(scan->records[(scan->position)++]), sizeof(Record));
+    return 1;
+}
+
+void bplus_keyed_scan_close(BPlusKeyedScan *scan)
+{
+    scan->record_count = 0;
+    scan->position = 0;
+    scan->next_block_index = -1;
+}
+
+void keyed_block_print(const char *block_start, const BPlusMeta *metadata)
+{
+    int type = block_type(block_start);
+    if (type != BLOCK_TYPE_KEYED_DATA && type != BLOCK_TYPE_KEYED_INDEX) {
+        perror("Not a keyed block\n");
+        return;
+    }
+
+    for (int i = 0; i < 20; i++) printf("-");
+    printf("\n");
+
+    if (type == BLOCK_TYPE_KEYED_DATA) {
+        KeyedDataHeader header;
+        memcpy(&header, block_start + sizeof(int), sizeof(KeyedDataHeader));
+        printf("record_count = %d\n", header.record_count);
+        printf("next_index = %d\n\n", header.next_index);
+
+        for (int i = 0; i < header.record_count && i < metadata->max_records_per_block; i++) {
+            Record record;
+            memcpy(&record, block_start + data_block_record_offset(metadata, i), sizeof(Record));
+            record_print(&(metadata->schema), &record);
+        }
+    }
+    else {
+        KeyedIndexHeader header;
+        memcpy(&header, block_start + sizeof(int), sizeof(KeyedIndexHeader));
+        printf("entry_count = %d\n", header.entry_count);
+        printf("used = %d\n", header.used);
+        printf("first_index = %d\n", header.first_index);
+        printf("prefix_length = %d\n\n", header.prefix_length);
+
+        // the prefix and the suffixes of the separators in hex, as they are normalized keys
+        const unsigned char *prefix = (const unsigned char *)block_start + KEYED_INDEX_ENTRIES_START;
+        printf("Prefix: ");
+        for (int j = 0; j < header.prefix_length; j++)
+            printf("%02x", prefix[j]);
+        printf("\n");
+
+        int fixed = fixed_length(metadata, header.prefix_length);
+        const unsigned char *entry = prefix + header.prefix_length;
+        printf("Entries: ");
+        for (int i = 0; i < header.entry_count; i++) {
+            const unsigned char *separator = entry_separator(fixed, entry);
+            for (int j = 0; j < entry_length(fixed, entry); j++)
+                printf("%02x", separator[j]);
+            printf(" -> %d, ", entry_child(fixed, entry));
+            entry += entry_size(fixed, entry);
+        }
+        printf("\n");
+    }
+
+    for (int i = 0; i < 20; i++) printf("-");
+    printf("\n");
+}
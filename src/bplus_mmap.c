@@ -0,0 +1,298 @@
+#define _DEFAULT_SOURCE // madvise()
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_mmap.h"
+
+// returns 1 if block_index is a block inside the mapping, 0 otherwise
+static int mapped_block_is_valid(const BPlusHandle *handle, int block_index)
+{
+    return block_index >= 0 && (size_t)(block_index + 1) * BF_BLOCK_SIZE <= handle->map_size;
+}
+
+// returns the start of the block with block_index in the mapping
+static const char *mapped_block(const BPlusHandle *handle, int block_index)
+{
+    return handle->map + (size_t)block_index * BF_BLOCK_SIZE;
+}
+
+// advises the kernel that the page(s) of a block will be needed soon, so it can start reading them
+static void mapped_block_advise_willneed(const BPlusHandle *handle, int block_index)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t block_offset = (size_t)block_index * BF_BLOCK_SIZE;
+    size_t page_offset = block_offset - block_offset % page_size; // madvise() needs a page aligned address
+
+    madvise(handle->map + page_offset, block_offset + BF_BLOCK_SIZE - page_offset, MADV_WILLNEED);
+}
+
+// reads in the index levels of the tree, level by level from the root: all blocks of a level are advised before
+// any of them is read, so their reads overlap; the data blocks (leaves) are left to be paged in on demand
+static void prefetch_index_levels(const BPlusHandle *handle, const BPlusMeta *metadata)
+{
+    if (metadata->root_index == -1 || !mapped_block_is_valid(handle, metadata->root_index))
+        return;
+
+    int *level = malloc(metadata->block_count * sizeof(int));
+    int *next_level = malloc(metadata->block_count * sizeof(int));
+    IndexNodeEntry *entry_array = malloc(metadata->max_indexes_per_block * sizeof(IndexNodeEntry));
+    if (!level || !next_level || !entry_array) {
+        free(level);
+        free(next_level);
+        free(entry_array);
+        return;
+    }
+
+    level[0] = metadata->root_index;
+    int level_count = 1;
+
+    while (level_count > 0) {
+        for (int i = 0; i < level_count; i++)
+            mapped_block_advise_willneed(handle, level[i]);
+
+        int next_level_count = 0;
+        for (int i = 0; i < level_count; i++) {
+            const char *block_start = mapped_block(handle, level[i]);
+            if (!is_index_block(block_start))
+                continue;
+
+            IndexNodeHeader header;
+            memcpy(&header, block_start + sizeof(int), sizeof(IndexNodeHeader));
+            if (header.index_count < 1 || header.index_count > metadata->max_indexes_per_block)
+                continue;
+
+            index_block_read_entries_as_array(block_start, &header, entry_array);
+
+            // the tree is balanced, so the children of an index block are either all index blocks or all data blocks
+            if (!mapped_block_is_valid(handle, entry_array[0].right_index) ||
+                !is_index_block(mapped_block(handle, entry_array[0].right_index)))
+                continue;
+
+            for (int j = 0; j < header.index_count && next_level_count < metadata->block_count; j++) {
+                if (mapped_block_is_valid(handle, entry_array[j].right_index))
+                    next_level[next_level_count++] = entry_array[j].right_index;
+            }
+        }
+
+        int *temp = level;
+        level = next_level;
+        next_level = temp;
+        level_count = next_level_count;
+    }
+
+    free(level);
+    free(next_level);
+    free(entry_array);
+}
+
+// opens fileName read-only and gets its size, which must be at least one block
+// returns the file descriptor, or -1 if unsuccessful
+static int open_tree_file(const char *fileName, size_t *file_size)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd == -1)
+        return -1;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size < BF_BLOCK_SIZE) {
+        close(fd);
+        return -1;
+    }
+
+    *file_size = (size_t)file_stat.st_size;
+    return fd;
+}
+
+// starts the runtime state of a mapped descriptor for map, which holds the file fileName of map_size bytes
+// returns the descriptor on success; on failure the mapping (of map_length bytes) is unmapped and -1 is returned
+static int attach_mapping(const char *fileName, char *map, size_t map_size, size_t map_length, BPlusMeta **metadata)
+{
+    int mapped_desc = bplus_handle_free_mapped_desc();
+
+    // checking magic number
+    BPlusMeta temp;
+    memcpy(&temp, map, sizeof(BPlusMeta)); // memcpy to avoid alignment issues
+    // mapped lookups search int key nodes, so keyed files are not mapped
+    if (mapped_desc == -1 || !bplus_magic_num_is_valid(&temp) || bplus_file_is_keyed(&temp)) {
+        munmap(map, map_length);
+        return -1;
+    }
+
+    // the caller gets a copy of the metadata, as with bplus_open_file()
+    *metadata = malloc(sizeof(BPlusMeta));
+    if (!(*metadata) || bplus_handle_open(mapped_desc, fileName) == -1) {
+        free(*metadata);
+        *metadata = NULL;
+        munmap(map, map_length);
+        return -1;
+    }
+    memcpy(*metadata, &temp, sizeof(BPlusMeta));
+
+    BPlusHandle *handle = bplus_handle_get(mapped_desc);
+    handle->map = map;
+    handle->map_size = map_size;
+    handle->map_length = map_length;
+
+    // the dictionaries are read in the mapping; closing the handle also unmaps it
+    if (bplus_dictionary_load(mapped_desc, *metadata) == -1) {
+        bplus_handle_close(mapped_desc);
+        free(*metadata);
+        *metadata = NULL;
+        return -1;
+    }
+    return mapped_desc;
+}
+
+int bplus_open_file_mmap(const char *fileName, int *file_desc, BPlusMeta **metadata)
+{
+    size_t map_size;
+    int fd = open_tree_file(fileName, &map_size);
+    if (fd == -1)
+        return -1;
+
+    char *map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file referenced
+    if (map == MAP_FAILED)
+        return -1;
+
+    int mapped_desc = attach_mapping(fileName, map, map_size, map_size, metadata);
+    if (mapped_desc == -1)
+        return -1;
+
+    // lookups jump around the file, so readahead would mostly read leaves that are not needed
+    madvise(map, map_size, MADV_RANDOM);
+    prefetch_index_levels(bplus_handle_get(mapped_desc), *metadata);
+
+    *file_desc = mapped_desc;
+    return 0;
+}
+
+// maps an anonymous arena of arena_length bytes (a multiple of BPLUS_HUGE_PAGE_SIZE) that starts at a huge page
+// boundary, so that the kernel can back all of it with huge pages
+// returns the arena, or NULL if unsuccessful
+static char *map_aligned_arena(size_t arena_length)
+{
+    // mapping one huge page more than needed, then unmapping the unaligned head and the tail
+    size_t mapped_length = arena_length + BPLUS_HUGE_PAGE_SIZE;
+    char *mapped = mmap(NULL, mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        return NULL;
+
+    size_t head = (BPLUS_HUGE_PAGE_SIZE - (uintptr_t)mapped % BPLUS_HUGE_PAGE_SIZE) % BPLUS_HUGE_PAGE_SIZE;
+    char *arena = mapped + head;
+    if (head > 0)
+        munmap(mapped, head);
+    munmap(arena + arena_length, mapped_length - head - arena_length);
+
+    return arena;
+}
+
+int bplus_open_file_arena(const char *fileName, int *file_desc, BPlusMeta **metadata, int flags)
+{
+    size_t map_size;
+    int fd = open_tree_file(fileName, &map_size);
+    if (fd == -1)
+        return -1;
+
+    size_t arena_length = (map_size + BPLUS_HUGE_PAGE_SIZE - 1) / BPLUS_HUGE_PAGE_SIZE * BPLUS_HUGE_PAGE_SIZE;
+    char *arena = map_aligned_arena(arena_length);
+    if (!arena) {
+        close(fd);
+        return -1;
+    }
+
+    // the advice must come before the arena is first written, so that its pages are faulted in as huge pages
+    if (flags & BPLUS_ARENA_HUGE_PAGES)
+        madvise(arena, arena_length, MADV_HUGEPAGE);
+    else
+        madvise(arena, arena_length, MADV_NOHUGEPAGE);
+
+    // reading the whole file, in as few calls as the kernel allows
+    size_t read_size = 0;
+    while (read_size < map_size) {
+        ssize_t count = pread(fd, arena + read_size, map_size - read_size, (off_t)read_size);
+        if (count <= 0)
+            break;
+        read_size += (size_t)count;
+    }
+    close(fd);
+
+    if (read_size < map_size) {
+        munmap(arena, arena_length);
+        return -1;
+    }
+    mprotect(arena, arena_length, PROT_READ); // read-only, like the mmap mode
+
+    int mapped_desc = attach_mapping(fileName, arena, map_size, arena_length, metadata);
+    if (mapped_desc == -1)
+        return -1;
+
+    *file_desc = mapped_desc;
+    return 0;
+}
+
+int bplus_mmap_is_mapped(const BPlusHandle *handle)
+{
+    return handle != NULL && handle->map != NULL;
+}
+
+const char *bplus_mmap_block(const BPlusHandle *handle, int block_index)
+{
+    return mapped_block_is_valid(handle, block_index) ? mapped_block(handle, block_index) : NULL;
+}
+
+int bplus_mmap_search_data_block(const BPlusHandle *handle, const BPlusMeta *metadata, int key)
+{
+    int block_index = metadata->root_index;
+    if (!mapped_block_is_valid(handle, block_index))
+        return -1;
+
+    // descending from the root block to the data block that could contain the key
+    const char *block_start = mapped_block(handle, block_index);
+    while (!is_data_block(block_start)) {
+        block_index = index_block_find_child(block_start, key);
+        if (!mapped_block_is_valid(handle, block_index))
+            return -1;
+
+        block_start = mapped_block(handle, block_index);
+    }
+
+    return block_index;
+}
+
+int bplus_mmap_find(const BPlusHandle *handle, const BPlusMeta *metadata, int key, Record *record)
+{
+    int block_index = bplus_mmap_search_data_block(handle, metadata, key);
+    if (block_index == -1)
+        return 0;
+
+    const char *block_start = mapped_block(handle, block_index);
+
+    DataNodeHeader header;
+    int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+    data_block_copy_header(block_start, &header);
+    data_block_copy_index_array(block_start, metadata, index_array);
+
+    int position = data_block_key_search(block_start, &header, index_array, metadata, key);
+    if (position < 0)
+        return 0;
+
+    data_block_copy_record(block_start, &header, index_array, metadata, position, record);
+    bplus_dictionary_decode(handle, metadata, record);
+    return 1;
+}
+
+void bplus_mmap_close(BPlusHandle *handle)
+{
+    if (!handle->map)
+        return;
+
+    munmap(handle->map, handle->map_length);
+    handle->map = NULL;
+    handle->map_size = 0;
+    handle->map_length = 0;
+}
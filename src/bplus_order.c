@@ -0,0 +1,188 @@
+#include <limits.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_order.h"
+
+#define CALL_BF(call)         \
+{                             \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+        BF_PrintError(code);  \
+        return -1;            \
+    }                         \
+}
+
+// gets the block with block_index, pinned in block, or read in the mapping if the file of handle is memory-mapped
+// returns 0 on success, -1 otherwise
+static int get_block(const BPlusHandle *handle, int file_desc, int block_index, BF_Block *block,
+                     const char **block_start)
+{
+    if (bplus_mmap_is_mapped(handle)) {
+        *block_start = bplus_mmap_block(handle, block_index);
+        return *block_start ? 0 : -1;
+    }
+
+    CALL_BF(BF_GetBlock(file_desc, block_index, block));
+    *block_start = BF_Block_GetData(block);
+    bplus_handle_touch(file_desc, block_index, BPLUS_ACCESS_NORMAL);
+    return 0;
+}
+
+// unpins a block got with get_block() (mapped blocks are not pinned)
+static void release_block(const BPlusHandle *handle, BF_Block *block)
+{
+    if (!bplus_mmap_is_mapped(handle))
+        BF_UnpinBlock(block);
+}
+
+// returns the number of records of the tree with key < bound by a scan over the leaf chain (for files without
+// subtree counts), or -1 on failure
+static int scan_count_below(int file_desc, const BPlusMeta *metadata, long long bound)
+{
+    BPlusScan scan;
+    if (bplus_scan_open(&scan, file_desc, metadata, INT_MIN, BPLUS_ACCESS_SCAN) == -1) {
+        bplus_scan_close(&scan);
+        return -1;
+    }
+
+    int count = 0, result;
+    Record record;
+    while ((result = bplus_scan_next(&scan, &record)) == 1 && record_get_key(&(metadata->schema), &record) < bound)
+        count++;
+    bplus_scan_close(&scan);
+    return (result == -1) ? -1 : count;
+}
+
+// returns the number of records of the tree with key < bound, or -1 on failure
+static int count_below(int file_desc, const BPlusMeta *metadata, long long bound)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || bplus_file_is_keyed(metadata))
+        return -1;
+    if (metadata->root_index == -1 || bound <= INT_MIN)
+        return 0;
+    if (bound > INT_MAX)
+        return metadata->record_count;
+    if (!bplus_file_has_counts(metadata))
+        return scan_count_below(file_desc, metadata, bound);
+
+    int key = (int)bound;
+    int count = 0;
+    int block_index = metadata->root_index;
+    BF_Block *block;
+    BF_Block_Init(&block);
+
+    while (1) {
+        const char *block_start;
+        if (get_block(handle, file_desc, block_index, block, &block_start) == -1) {
+            BF_Block_Destroy(&block);
+            return -1;
+        }
+
+        // in the data block, the records below the key are those before its insert position
+        if (is_data_block(block_start)) {
+            DataNodeHeader header;
+            int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+            data_block_copy_header(block_start, &header);
+            data_block_copy_index_array(block_start, metadata, index_array);
+
+            int position = data_block_key_search(block_start, &header, index_array, metadata, key);
+            if (position == -1)
+                position = data_block_search_insert_pos(block_start, &header, index_array, metadata, key);
+
+            release_block(handle, block);
+            BF_Block_Destroy(&block);
+            return (position < 0) ? -1 : count + position;
+        }
+
+        // else all records under the children left of the one that can lead to the key are below it
+        int position = index_block_find_child_position(block_start, key);
+        for (int i = 0; i < position; i++)
+            count += index_block_read_count(block_start, i);
+
+        block_index = index_block_find_child(block_start, key);
+        release_block(handle, block);
+    }
+}
+
+int bplus_rank(int file_desc, const BPlusMeta *metadata, int key)
+{
+    return count_below(file_desc, metadata, key);
+}
+
+int bplus_count_range(int file_desc, const BPlusMeta *metadata, int low_key, int high_key)
+{
+    if (low_key > high_key)
+        return 0;
+
+    int below_high = count_below(file_desc, metadata, (long long)high_key + 1);
+    int below_low = count_below(file_desc, metadata, low_key);
+    if (below_high == -1 || below_low == -1)
+        return -1;
+
+    return below_high - below_low;
+}
+
+int bplus_select(int file_desc, const BPlusMeta *metadata, int position, Record *record)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || bplus_file_is_keyed(metadata))
+        return -1;
+    if (position < 0 || position >= metadata->record_count)
+        return 0;
+
+    // without subtree counts, the records before the position are skipped over the leaf chain
+    if (!bplus_file_has_counts(metadata)) {
+        BPlusScan scan;
+        if (bplus_scan_open(&scan, file_desc, metadata, INT_MIN, BPLUS_ACCESS_SCAN) == -1) {
+            bplus_scan_close(&scan);
+            return -1;
+        }
+
+        int result;
+        while ((result = bplus_scan_next(&scan, record)) == 1 && position > 0)
+            position--;
+        bplus_scan_close(&scan);
+        return result;
+    }
+
+    int block_index = metadata->root_index;
+    BF_Block *block;
+    BF_Block_Init(&block);
+
+    while (1) {
+        const char *block_start;
+        if (get_block(handle, file_desc, block_index, block, &block_start) == -1) {
+            BF_Block_Destroy(&block);
+            return -1;
+        }
+
+        // position is now within the records of the data block
+        if (is_data_block(block_start)) {
+            DataNodeHeader header;
+            int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+            data_block_copy_header(block_start, &header);
+            data_block_copy_index_array(block_start, metadata, index_array);
+
+            int result = data_block_copy_record(block_start, &header, index_array, metadata, position, record);
+            if (result == 0)
+                bplus_dictionary_decode(handle, metadata, record);
+            release_block(handle, block);
+            BF_Block_Destroy(&block);
+            return (result == -1) ? -1 : 1;
+        }
+
+        // else the position is under the first child whose count, added to those left of it, passes it
+        IndexNodeHeader header;
+        index_block_copy_header(block_start, &header);
+
+        int child = 0;
+        while (child < header.index_count - 1 && position >= index_block_read_count(block_start, child)) {
+            position -= index_block_read_count(block_start, child);
+            child++;
+        }
+
+        block_index = index_block_read_child(block_start, child);
+        release_block(handle, block);
+    }
+}
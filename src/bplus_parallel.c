@@ -0,0 +1,382 @@
+#include <limits.h>
+#include <pthread.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_parallel.h"
+
+#define CALL_BF(call)         \
+{                             \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+        BF_PrintError(code);  \
+        return -1;            \
+    }                         \
+}
+
+typedef struct {
+    const BPlusHandle *handle;
+    int file_desc;
+    const BPlusMeta *metadata;
+    int partition;
+    long long low_key; // the partition has the keys in [low_key, end_key)
+    long long end_key;
+    BPlusScanCallback callback; // NULL if the records are passed on through ring
+    void *user_data;
+    // the bounded buffer of an ordered scan by threads: the worker appends the records of the partition, in ascending
+    // key order, and waits while it is full; the calling thread takes them out and calls the callback for them
+    Record *ring; // BPLUS_PARALLEL_BUFFER_RECORDS records
+    int ring_start; // first record to take out
+    int ring_count;
+    int is_done; // set by the worker after its last record, or on failure
+    int is_cancelled; // set by the calling thread to stop the worker, after a failure
+    pthread_mutex_t lock; // of the ring and the flags
+    pthread_cond_t changed; // signalled when the ring is half full, has room again, or a flag is set
+    int scanned; // records of the partition, or -1 if its scan failed
+} ScanPartition;
+
+// gets the block with block_index, pinned in block, or read in the mapping if the file of handle is memory-mapped
+// returns 0 on success, -1 otherwise
+static int get_block(const BPlusHandle *handle, int file_desc, int block_index, int access_hint, BF_Block *block,
+                     const char **block_start)
+{
+    if (bplus_mmap_is_mapped(handle)) {
+        *block_start = bplus_mmap_block(handle, block_index);
+        return *block_start ? 0 : -1;
+    }
+
+    CALL_BF(BF_GetBlock(file_desc, block_index, block));
+    *block_start = BF_Block_GetData(block);
+    bplus_handle_touch(file_desc, block_index, access_hint);
+    return 0;
+}
+
+// unpins a block got with get_block() (mapped blocks are not pinned)
+static void release_block(const BPlusHandle *handle, BF_Block *block)
+{
+    if (!bplus_mmap_is_mapped(handle))
+        BF_UnpinBlock(block);
+}
+
+// appends to separators (after separator_count of them) the keys between the children of the index block with
+// block_index, and the indexes of its children to children (if not NULL), in ascending key order
+// returns the number of children of the block (0 for a data block), or -1 on failure
+static int read_separators(const BPlusHandle *handle, int file_desc, int block_index, int *separators,
+                           int separator_count, int *children)
+{
+    BF_Block *block;
+    BF_Block_Init(&block);
+    const char *block_start;
+    if (get_block(handle, file_desc, block_index, BPLUS_ACCESS_NORMAL, block, &block_start) == -1) {
+        BF_Block_Destroy(&block);
+        return -1;
+    }
+
+    int child_count = 0;
+    if (!is_data_block(block_start)) {
+        IndexNodeHeader header;
+        IndexNodeEntry entry_array[BF_BLOCK_SIZE / sizeof(int)]; // more than any index block's indexes
+        index_block_copy_header(block_start, &header);
+        index_block_read_entries_as_array(block_start, &header, entry_array);
+
+        child_count = header.index_count;
+        for (int i = 0; i < child_count; i++) {
+            if (i > 0)
+                separators[separator_count++] = entry_array[i].key;
+            if (children)
+                children[i] = entry_array[i].right_index;
+        }
+    }
+
+    release_block(handle, block);
+    BF_Block_Destroy(&block);
+    return child_count;
+}
+
+// fills separators with the keys between the children of the root, or between those of the second level if the root
+// has fewer than partition_count children; separators must fit max_indexes_per_block^2 ints
+// returns the number of separators, or -1 on failure
+static int collect_separators(const BPlusHandle *handle, int file_desc, const BPlusMeta *metadata,
+                              int partition_count, int *separators)
+{
+    int children[BF_BLOCK_SIZE / sizeof(int)]; // more than any index block's indexes
+    int root_separators[BF_BLOCK_SIZE / sizeof(int)];
+    int child_count = read_separators(handle, file_desc, metadata->root_index, root_separators, 0, children);
+    if (child_count <= 0)
+        return child_count;
+
+    int separator_count = 0;
+    if (child_count >= partition_count) {
+        memcpy(separators, root_separators, (child_count - 1) * sizeof(int));
+        return child_count - 1;
+    }
+
+    // the separators of each child, with the separator of the root between two children
+    for (int i = 0; i < child_count; i++) {
+        if (i > 0)
+            separators[separator_count++] = root_separators[i - 1];
+
+        int result = read_separators(handle, file_desc, children[i], separators, separator_count, NULL);
+        if (result == -1)
+            return -1;
+        if (result > 0)
+            separator_count += result - 1;
+    }
+    return separator_count;
+}
+
+// passes record on to the callback of partition, or appends it to its ring, waiting while the ring is full
+// returns 0 on success, -1 if the scan was cancelled
+static int deliver_record(ScanPartition *partition, const Record *record)
+{
+    if (partition->callback) {
+        partition->callback(partition->user_data, partition->partition, record);
+        return 0;
+    }
+
+    pthread_mutex_lock(&(partition->lock));
+    while (partition->ring_count == BPLUS_PARALLEL_BUFFER_RECORDS && !partition->is_cancelled)
+        pthread_cond_wait(&(partition->changed), &(partition->lock));
+    if (partition->is_cancelled) {
+        pthread_mutex_unlock(&(partition->lock));
+        return -1;
+    }
+
+    int position = (partition->ring_start + partition->ring_count) % BPLUS_PARALLEL_BUFFER_RECORDS;
+    memcpy(&(partition->ring[position]), record, sizeof(Record));
+    if (++(partition->ring_count) == BPLUS_PARALLEL_BUFFER_RECORDS / 2) // the calling thread takes them as a batch
+        pthread_cond_signal(&(partition->changed));
+    pthread_mutex_unlock(&(partition->lock));
+    return 0;
+}
+
+// calls callback for the records of the ring of partition, in order, as the worker appends them, until it is done;
+// an empty ring is waited on until the worker has half filled it (or is done), so that they are taken in batches
+// the records are read outside the lock: the worker only writes to the free part of the ring
+static void drain_partition(ScanPartition *partition, BPlusScanCallback callback, void *user_data)
+{
+    pthread_mutex_lock(&(partition->lock));
+    while (1) {
+        while (partition->ring_count == 0 && !partition->is_done)
+            pthread_cond_wait(&(partition->changed), &(partition->lock));
+        int start = partition->ring_start;
+        int count = partition->ring_count;
+        if (count == 0)
+            break;
+        pthread_mutex_unlock(&(partition->lock));
+
+        for (int i = 0; i < count; i++)
+            callback(user_data, partition->partition, &(partition->ring[(start + i) % BPLUS_PARALLEL_BUFFER_RECORDS]));
+
+        pthread_mutex_lock(&(partition->lock));
+        partition->ring_start = (start + count) % BPLUS_PARALLEL_BUFFER_RECORDS;
+        partition->ring_count -= count;
+        pthread_cond_signal(&(partition->changed));
+    }
+    pthread_mutex_unlock(&(partition->lock));
+}
+
+// stops the worker of partition, which may be waiting for room in its ring
+static void cancel_partition(ScanPartition *partition)
+{
+    pthread_mutex_lock(&(partition->lock));
+    partition->is_cancelled = 1;
+    pthread_cond_signal(&(partition->changed));
+    pthread_mutex_unlock(&(partition->lock));
+}
+
+// scans the records of partition, from the data block of its first key along the leaf chain
+// returns the number of records scanned, or -1 on failure
+static int scan_records(ScanPartition *partition)
+{
+    const BPlusHandle *handle = partition->handle;
+    const BPlusMeta *metadata = partition->metadata;
+
+    int block_index;
+    if (bplus_mmap_is_mapped(handle)) {
+        block_index = bplus_mmap_search_data_block(handle, metadata, (int)partition->low_key);
+        if (block_index == -1)
+            return -1;
+    }
+    else {
+        bplus_pool_check(partition->file_desc);
+
+        BF_Block *block;
+        BF_Block_Init(&block);
+        int result = tree_search_data_block(metadata->root_index, (int)partition->low_key, partition->file_desc,
+                                            block, &block_index);
+        if (result == 0)
+            BF_UnpinBlock(block);
+        BF_Block_Destroy(&block);
+        if (result == -1)
+            return -1;
+    }
+
+    int scanned = 0;
+    BF_Block *block;
+    BF_Block_Init(&block);
+    while (block_index != -1) {
+        if (!bplus_mmap_is_mapped(handle))
+            bplus_pool_check(partition->file_desc);
+
+        const char *block_start;
+        if (get_block(handle, partition->file_desc, block_index, BPLUS_ACCESS_SCAN, block, &block_start) == -1) {
+            BF_Block_Destroy(&block);
+            return -1;
+        }
+        if (!is_data_block(block_start)) {
+            release_block(handle, block);
+            BF_Block_Destroy(&block);
+            return -1;
+        }
+
+        DataNodeHeader header;
+        int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+        data_block_copy_header(block_start, &header);
+        data_block_copy_index_array(block_start, metadata, index_array);
+        block_index = header.next_index;
+
+        Record record;
+        for (int i = 0; i < header.record_count && i < metadata->max_records_per_block; i++) {
+            if (data_block_copy_record(block_start, &header, index_array, metadata, i, &record) == -1)
+                break;
+
+            int key = record_get_key(&(metadata->schema), &record);
+            if (key < partition->low_key)
+                continue;
+            if (key >= partition->end_key) { // the rest of the leaf chain belongs to the next partitions
+                block_index = -1;
+                break;
+            }
+            bplus_dictionary_decode(handle, metadata, &record); // the workers only read the dictionaries, no lock is needed
+            if (deliver_record(partition, &record) == -1) {
+                release_block(handle, block);
+                BF_Block_Destroy(&block);
+                return -1;
+            }
+            scanned++;
+        }
+        release_block(handle, block);
+    }
+    BF_Block_Destroy(&block);
+    return scanned;
+}
+
+// scans the partition pointed to by arg and sets its scanned count (-1 on failure); with a ring, it then marks the
+// partition done for the calling thread
+// (the start routine of a worker thread, also called directly for the partitions that the calling thread scans)
+static void *scan_partition(void *arg)
+{
+    ScanPartition *partition = arg;
+    int scanned = scan_records(partition);
+
+    if (partition->callback) {
+        partition->scanned = scanned;
+        return NULL;
+    }
+
+    pthread_mutex_lock(&(partition->lock));
+    partition->scanned = scanned;
+    partition->is_done = 1;
+    pthread_cond_signal(&(partition->changed));
+    pthread_mutex_unlock(&(partition->lock));
+    return NULL;
+}
+
+int bplus_parallel_scan(int file_desc, const BPlusMeta *metadata, int thread_count, int mode,
+                        BPlusScanCallback callback, void *user_data)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || !callback || thread_count < 1 || thread_count > BPLUS_PARALLEL_MAX_THREADS
+        || bplus_file_is_keyed(metadata) || (mode != BPLUS_PARALLEL_ORDERED && mode != BPLUS_PARALLEL_UNORDERED))
+        return -1;
+    if (metadata->root_index == -1)
+        return 0;
+
+    int *separators = malloc(metadata->max_indexes_per_block * metadata->max_indexes_per_block * sizeof(int));
+    if (!separators)
+        return -1;
+    int separator_count = collect_separators(handle, file_desc, metadata, thread_count, separators);
+    if (separator_count == -1) {
+        free(separators);
+        return -1;
+    }
+
+    // partition p gets the children [p * children / partitions, (p + 1) * children / partitions) of the level
+    int partition_count = (separator_count + 1 < thread_count) ? separator_count + 1 : thread_count;
+    int threaded = bplus_mmap_is_mapped(handle);
+    ScanPartition partitions[BPLUS_PARALLEL_MAX_THREADS];
+    memset(partitions, 0, sizeof(partitions));
+    for (int p = 0; p < partition_count; p++) {
+        int first_child = p * (separator_count + 1) / partition_count;
+        int end_child = (p + 1) * (separator_count + 1) / partition_count;
+
+        partitions[p].handle = handle;
+        partitions[p].file_desc = file_desc;
+        partitions[p].metadata = metadata;
+        partitions[p].partition = p;
+        partitions[p].low_key = (p == 0) ? INT_MIN : separators[first_child - 1];
+        partitions[p].end_key = (p == partition_count - 1) ? (long long)INT_MAX + 1 : separators[end_child - 1];
+        partitions[p].callback = callback;
+        partitions[p].user_data = user_data;
+        partitions[p].scanned = -1;
+    }
+    free(separators);
+
+    // in an ordered scan by threads, each worker gets a ring and passes its records through it; a partition whose ring
+    // or thread cannot be made is scanned by the calling thread, in its turn
+    pthread_t threads[BPLUS_PARALLEL_MAX_THREADS];
+    int started[BPLUS_PARALLEL_MAX_THREADS];
+    for (int p = 0; p < partition_count; p++) {
+        started[p] = 0;
+        if (!threaded)
+            continue;
+
+        if (mode == BPLUS_PARALLEL_ORDERED) {
+            partitions[p].ring = malloc(BPLUS_PARALLEL_BUFFER_RECORDS * sizeof(Record));
+            if (!partitions[p].ring)
+                continue;
+            pthread_mutex_init(&(partitions[p].lock), NULL);
+            pthread_cond_init(&(partitions[p].changed), NULL);
+            partitions[p].callback = NULL;
+        }
+
+        started[p] = pthread_create(&(threads[p]), NULL, scan_partition, &(partitions[p])) == 0;
+        if (!started[p] && partitions[p].ring) {
+            pthread_cond_destroy(&(partitions[p].changed));
+            pthread_mutex_destroy(&(partitions[p].lock));
+            free(partitions[p].ring);
+            partitions[p].ring = NULL;
+            partitions[p].callback = callback;
+        }
+    }
+
+    // partition p is drained before p + 1, whose worker waits once its ring is full; after a failure, the workers of
+    // the partitions left are cancelled
+    int scanned = 0;
+    for (int p = 0; p < partition_count; p++) {
+        if (!started[p]) {
+            if (scanned != -1)
+                scan_partition(&(partitions[p]));
+        }
+        else if (partitions[p].ring) {
+            if (scanned != -1)
+                drain_partition(&(partitions[p]), callback, user_data);
+            else
+                cancel_partition(&(partitions[p]));
+        }
+        if (started[p])
+            pthread_join(threads[p], NULL);
+
+        if (partitions[p].scanned == -1 || scanned == -1)
+            scanned = -1;
+        else
+            scanned += partitions[p].scanned;
+
+        if (partitions[p].ring) {
+            pthread_cond_destroy(&(partitions[p].changed));
+            pthread_mutex_destroy(&(partitions[p].lock));
+            free(partitions[p].ring);
+        }
+    }
+    return scanned;
+}
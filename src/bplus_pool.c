@@ -0,0 +1,341 @@
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_pool.h"
+
+#define POOL_HASH_BITS 8
+#define POOL_HASH_SIZE (1 << POOL_HASH_BITS) // slots of the block lookup table, a power of 2 above BF_BUFFER_SIZE
+
+// a frame of the mirror of the BF pool
+struct pool_frame {
+    int file_desc;
+    int block_index;
+    int is_scanned; // 1 if the block was only fetched with the BPLUS_ACCESS_SCAN hint since it got a frame
+    int newer; // frame of the next more recently accessed block, -1 for the most recent one
+    int older; // frame of the next less recently accessed block, -1 for the least recent one
+};
+
+// the blocks in the BF frames, as far as the bplus layer knows (BF replaces them in LRU order); the frames are
+// linked in recency order, and found by block through a hash table with linear probing, so that an access is O(1)
+static struct pool_frame pool[BF_BUFFER_SIZE];
+static int pool_count = 0;
+static int pool_newest = -1; // frame of the most recently accessed block, -1 while the mirror is empty
+static int pool_oldest = -1; // frame of the least recently accessed block, -1 while the mirror is empty
+static int pool_slots[POOL_HASH_SIZE]; // frame + 1 of the block of each slot, 0 for an empty slot
+
+static int pool_frames = BF_BUFFER_SIZE; // frame budget divided by the quotas (the BF pool itself is not resized)
+static int quota_file_count = 0; // open files with a quota
+static int scanned_count = 0; // frames of the mirror that hold scanned blocks
+static int hold_count = 0; // checks are suspended while > 0
+static int accesses_since_check = 0;
+
+// the kinds of blocks in a quota check
+#define POOL_BLOCK_NORMAL 0
+#define POOL_BLOCK_PROTECTED 1 // among the min_frames most recent blocks of its file
+#define POOL_BLOCK_EXCESS 2 // past the max_frames most recent blocks of its file, or a scanned block past the ring
+
+// returns the slot of the lookup table where the search for block_index of file_desc starts
+static int home_slot(int file_desc, int block_index)
+{
+    unsigned int hash = ((unsigned int)block_index ^ ((unsigned int)file_desc << 24)) * 2654435761u;
+    return (int)(hash >> (32 - POOL_HASH_BITS));
+}
+
+// returns the frame of block_index of file_desc in the mirror, -1 if it is not there
+static int find_frame(int file_desc, int block_index)
+{
+    for (int slot = home_slot(file_desc, block_index); pool_slots[slot]; slot = (slot + 1) & (POOL_HASH_SIZE - 1)) {
+        const struct pool_frame *frame = &pool[pool_slots[slot] - 1];
+        if (frame->file_desc == file_desc && frame->block_index == block_index)
+            return pool_slots[slot] - 1;
+    }
+
+    return -1;
+}
+
+// adds frame to the lookup table
+static void add_slot(int frame)
+{
+    int slot = home_slot(pool[frame].file_desc, pool[frame].block_index);
+    while (pool_slots[slot])
+        slot = (slot + 1) & (POOL_HASH_SIZE - 1);
+
+    pool_slots[slot] = frame + 1;
+}
+
+// removes frame from the lookup table, moving back the entries after it that would no longer be found
+static void remove_slot(int frame)
+{
+    int slot = home_slot(pool[frame].file_desc, pool[frame].block_index);
+    while (pool_slots[slot] != frame + 1)
+        slot = (slot + 1) & (POOL_HASH_SIZE - 1);
+
+    int next = slot;
+    for (;;) {
+        pool_slots[slot] = 0;
+        for (;;) {
+            next = (next + 1) & (POOL_HASH_SIZE - 1);
+            if (!pool_slots[next])
+                return;
+
+            // an entry stays if its home slot is cyclically in (slot, next]
+            const struct pool_frame *moved = &pool[pool_slots[next] - 1];
+            int home = home_slot(moved->file_desc, moved->block_index);
+            if (slot <= next ? (slot < home && home <= next) : (slot < home || home <= next))
+                continue;
+
+            pool_slots[slot] = pool_slots[next];
+            slot = next;
+            break;
+        }
+    }
+}
+
+// takes frame out of the recency order
+static void unlink_frame(int frame)
+{
+    if (pool[frame].newer != -1)
+        pool[pool[frame].newer].older = pool[frame].older;
+    else
+        pool_newest = pool[frame].older;
+
+    if (pool[frame].older != -1)
+        pool[pool[frame].older].newer = pool[frame].newer;
+    else
+        pool_oldest = pool[frame].newer;
+}
+
+// puts frame at the most recent end of the recency order
+static void link_newest(int frame)
+{
+    pool[frame].newer = -1;
+    pool[frame].older = pool_newest;
+    if (pool_newest != -1)
+        pool[pool_newest].newer = frame;
+    else
+        pool_oldest = frame;
+
+    pool_newest = frame;
+}
+
+// returns the sum of the min quotas of the open files, leaving out the file except_desc
+static int min_quota_sum(int except_desc)
+{
+    int sum = 0;
+    for (int file_desc = 0; file_desc < BF_MAX_OPEN_FILES; file_desc++) {
+        BPlusHandle *handle = bplus_handle_get(file_desc);
+        if (handle && file_desc != except_desc)
+            sum += handle->pool_min_frames;
+    }
+
+    return sum;
+}
+
+// counts the open files with a quota
+static void count_quota_files()
+{
+    quota_file_count = 0;
+    for (int file_desc = 0; file_desc < BF_MAX_OPEN_FILES; file_desc++) {
+        BPlusHandle *handle = bplus_handle_get(file_desc);
+        if (handle && (handle->pool_min_frames > 0 || handle->pool_max_frames > 0))
+            quota_file_count++;
+    }
+}
+
+int bplus_pool_set_frames(int frames)
+{
+    if (frames < 1 || frames > BF_BUFFER_SIZE)
+        return -1;
+
+    int min_sum = min_quota_sum(-1);
+    if (min_sum > 0 && min_sum > frames - BPLUS_POOL_PINNED_FRAMES)
+        return -1;
+
+    pool_frames = frames;
+    return 0;
+}
+
+int bplus_pool_get_frames()
+{
+    return pool_frames;
+}
+
+int bplus_set_frame_quota(int file_desc, int min_frames, int max_frames)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || bplus_mmap_is_mapped(handle)) // mapped files do not use the BF frames
+        return -1;
+
+    if (min_frames < 0 || max_frames < 0 || (max_frames > 0 && max_frames < min_frames))
+        return -1;
+
+    if (min_frames > 0 && min_quota_sum(file_desc) + min_frames > pool_frames - BPLUS_POOL_PINNED_FRAMES)
+        return -1;
+
+    handle->pool_min_frames = min_frames;
+    handle->pool_max_frames = max_frames;
+    count_quota_files();
+    return 0;
+}
+
+int bplus_pool_resident_frames(int file_desc)
+{
+    if (!bplus_handle_get(file_desc))
+        return -1;
+
+    int frames = 0;
+    for (int i = 0; i < pool_count; i++)
+        frames += (pool[i].file_desc == file_desc);
+
+    return frames;
+}
+
+void bplus_pool_touch(int file_desc, int block_index, int access_hint)
+{
+    accesses_since_check++;
+
+    int is_scanned = (access_hint == BPLUS_ACCESS_SCAN);
+
+    // the block is already in a frame
+    int frame = find_frame(file_desc, block_index);
+    if (frame != -1) {
+        if (pool[frame].is_scanned && !is_scanned) { // a normal fetch makes the block part of a working set
+            pool[frame].is_scanned = 0;
+            scanned_count--;
+        }
+        unlink_frame(frame);
+        link_newest(frame);
+        return;
+    }
+
+    // or it replaces the least recently accessed block when the pool is full
+    if (pool_count < BF_BUFFER_SIZE) {
+        frame = pool_count++;
+    } else {
+        frame = pool_oldest;
+        scanned_count -= pool[frame].is_scanned;
+        remove_slot(frame);
+        unlink_frame(frame);
+    }
+
+    pool[frame].file_desc = file_desc;
+    pool[frame].block_index = block_index;
+    pool[frame].is_scanned = is_scanned;
+    scanned_count += is_scanned;
+    add_slot(frame);
+    link_newest(frame);
+}
+
+// gets and unpins the block of frame, which moves it to the MRU end of the BF pool
+// returns 0 on success, -1 otherwise
+static int refresh_frame(const struct pool_frame *frame, BF_Block *block)
+{
+    if (BF_GetBlock(frame->file_desc, frame->block_index, block) != BF_OK)
+        return -1;
+
+    BF_UnpinBlock(block);
+    bplus_pool_touch(frame->file_desc, frame->block_index, BPLUS_ACCESS_NORMAL);
+    return 0;
+}
+
+void bplus_pool_check(int file_desc)
+{
+    (void)file_desc; // the quotas of all open files are checked together, as they share the pool
+
+    // without quotas and with the scanned blocks within their ring, the plain LRU order is what is wanted
+    if (quota_file_count == 0 && scanned_count <= BPLUS_POOL_SCAN_RING_SIZE)
+        return;
+
+    if (hold_count > 0 || accesses_since_check < BPLUS_POOL_CHECK_INTERVAL)
+        return;
+    accesses_since_check = 0;
+
+    // nothing is evicted until the pool is close to full
+    if (pool_count < BF_BUFFER_SIZE - BPLUS_POOL_REFRESH_MARGIN)
+        return;
+
+    // classifying the blocks, from the most to the least recently accessed one of each file
+    struct pool_frame frames[BF_BUFFER_SIZE];
+    int kinds[BF_BUFFER_SIZE];
+    int seen[BF_MAX_OPEN_FILES] = { 0 }; // blocks of each file classified so far
+    int scanned_seen = 0; // scanned blocks classified so far
+    int has_excess = 0;
+
+    int frame_count = 0;
+    for (int frame = pool_newest; frame != -1; frame = pool[frame].older)
+        frames[frame_count++] = pool[frame];
+
+    for (int i = 0; i < pool_count; i++) {
+        BPlusHandle *handle = bplus_handle_get(frames[i].file_desc);
+        int min_frames = handle ? handle->pool_min_frames : 0;
+        int max_frames = (handle && handle->pool_max_frames > 0) ? handle->pool_max_frames : pool_frames;
+
+        if (frames[i].is_scanned) {
+            kinds[i] = (scanned_seen++ < BPLUS_POOL_SCAN_RING_SIZE) ? POOL_BLOCK_NORMAL : POOL_BLOCK_EXCESS;
+            has_excess |= (kinds[i] == POOL_BLOCK_EXCESS);
+            continue;
+        }
+
+        int rank = seen[frames[i].file_desc]++;
+        if (rank < min_frames)
+            kinds[i] = POOL_BLOCK_PROTECTED;
+        else if (rank >= max_frames)
+            kinds[i] = POOL_BLOCK_EXCESS;
+        else
+            kinds[i] = POOL_BLOCK_NORMAL;
+
+        has_excess |= (kinds[i] == POOL_BLOCK_EXCESS);
+    }
+
+    // refreshing, from the LRU end, the blocks that must outlive the ones left there, until enough blocks are left
+    // at the LRU end for the evictions up to the next check
+    BF_Block *block;
+    BF_Block_Init(&block);
+
+    int evictable_count = 0;
+    for (int i = pool_count - 1; i >= 0 && evictable_count < BPLUS_POOL_REFRESH_MARGIN; i--) {
+        // a scanned block is read once, so even within the ring it is not worth keeping
+        if (kinds[i] == POOL_BLOCK_PROTECTED || (kinds[i] == POOL_BLOCK_NORMAL && has_excess && !frames[i].is_scanned))
+            refresh_frame(&frames[i], block);
+        else
+            evictable_count++;
+    }
+
+    BF_Block_Destroy(&block);
+    accesses_since_check = 0; // the refreshes are not accesses of the operations
+}
+
+void bplus_pool_hold(int delta)
+{
+    hold_count += delta;
+}
+
+void bplus_pool_close(int file_desc)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (handle) {
+        handle->pool_min_frames = 0;
+        handle->pool_max_frames = 0;
+    }
+
+    // rebuilding the mirror from the blocks of the other files, from the least to the most recently accessed
+    struct pool_frame kept[BF_BUFFER_SIZE];
+    int kept_count = 0;
+    for (int frame = pool_oldest; frame != -1; frame = pool[frame].newer) {
+        if (pool[frame].file_desc != file_desc)
+            kept[kept_count++] = pool[frame];
+    }
+
+    memset(pool_slots, 0, sizeof(pool_slots));
+    pool_count = 0;
+    pool_newest = -1;
+    pool_oldest = -1;
+    scanned_count = 0;
+    for (int i = 0; i < kept_count; i++) {
+        int frame = pool_count++;
+        pool[frame] = kept[i];
+        scanned_count += pool[frame].is_scanned;
+        add_slot(frame);
+        link_newest(frame);
+    }
+
+    count_quota_files();
+}
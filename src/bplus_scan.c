@@ -0,0 +1,134 @@
+#include <limits.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_scan.h"
+
+// copies the records of the data block at block_start into the scan, in ascending key order, skipping keys < min_key
+// (handle is the runtime state of the file, for its dictionaries)
+static void copy_block_records(BPlusScan *scan, const BPlusHandle *handle, const char *block_start, int min_key)
+{
+    DataNodeHeader header;
+    int index_array[BF_BLOCK_SIZE / sizeof(int)]; // large enough for any data block's index array
+    data_block_copy_header(block_start, &header);
+    data_block_copy_index_array(block_start, scan->metadata, index_array);
+
+    scan->record_count = 0;
+    scan->position = 0;
+    for (int i = 0; i < header.record_count && i < scan->metadata->max_records_per_block; i++) {
+        Record *record = &(scan->records[scan->record_count]);
+        if (data_block_copy_record(block_start, &header, index_array, scan->metadata, i, record) == -1)
+            break;
+
+        if (record_get_key(&(scan->metadata->schema), record) >= min_key) {
+            bplus_dictionary_decode(handle, scan->metadata, record);
+            scan->record_count++;
+        }
+    }
+
+    scan->next_block_index = header.next_index;
+}
+
+// loads the records of the data block with block_index into the scan
+// returns 0 on success, -1 otherwise
+static int load_block(BPlusScan *scan, int block_index, int min_key)
+{
+    BPlusHandle *handle = bplus_handle_get(scan->file_desc);
+    if (!handle)
+        return -1;
+
+    // a memory-mapped file is read directly in the mapping
+    if (bplus_mmap_is_mapped(handle)) {
+        const char *block_start = bplus_mmap_block(handle, block_index);
+        if (!block_start || !is_data_block(block_start))
+            return -1;
+
+        copy_block_records(scan, handle, block_start, min_key);
+        return 0;
+    }
+
+    // no block of the scan is pinned here, so the quotas and the scan ring can be enforced
+    bplus_pool_check(scan->file_desc);
+
+    BF_Block *block;
+    BF_Block_Init(&block);
+    if (BF_GetBlock(scan->file_desc, block_index, block) != BF_OK) {
+        BF_Block_Destroy(&block);
+        return -1;
+    }
+    bplus_handle_touch(scan->file_desc, block_index, scan->access_hint);
+
+    const char *block_start = BF_Block_GetData(block);
+    int result = 0;
+    if (is_data_block(block_start))
+        copy_block_records(scan, handle, block_start, min_key);
+    else
+        result = -1;
+
+    BF_UnpinBlock(block);
+    BF_Block_Destroy(&block);
+    return result;
+}
+
+int bplus_scan_open(BPlusScan *scan, int file_desc, const BPlusMeta *metadata, int start_key, int access_hint)
+{
+    memset(scan, 0, sizeof(BPlusScan));
+    scan->file_desc = file_desc;
+    scan->metadata = metadata;
+    scan->access_hint = access_hint;
+    scan->next_block_index = -1;
+
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || bplus_file_is_keyed(metadata)) // keyed files are scanned with bplus_keyed_scan_open()
+        return -1;
+
+    scan->records = malloc(metadata->max_records_per_block * sizeof(Record));
+    if (!(scan->records))
+        return -1;
+
+    if (metadata->root_index == -1) // empty tree, the scan is already at its end
+        return 0;
+
+    // finding the data block of start_key; the index blocks on the way are hot for every scan and lookup
+    int block_index;
+    if (bplus_mmap_is_mapped(handle)) {
+        block_index = bplus_mmap_search_data_block(handle, metadata, start_key);
+        if (block_index == -1)
+            return -1;
+    }
+    else {
+        bplus_pool_check(file_desc);
+
+        BF_Block *block;
+        BF_Block_Init(&block);
+        int result = tree_search_data_block(metadata->root_index, start_key, file_desc, block, &block_index);
+        if (result == 0)
+            BF_UnpinBlock(block);
+        BF_Block_Destroy(&block);
+        if (result == -1)
+            return -1;
+    }
+
+    return load_block(scan, block_index, start_key);
+}
+
+int bplus_scan_next(BPlusScan *scan, Record *record)
+{
+    // moving along the leaf chain until a data block with records is found (a block may have no record >= start_key)
+    while (scan->position == scan->record_count) {
+        if (scan->next_block_index == -1)
+            return 0;
+
+        if (load_block(scan, scan->next_block_index, INT_MIN) == -1)
+            return -1;
+    }
+
+    memcpy(record, &(scan->records[scan->position++]), sizeof(Record));
+    return 1;
+}
+
+void bplus_scan_close(BPlusScan *scan)
+{
+    free(scan->records);
+    memset(scan, 0, sizeof(BPlusScan));
+    scan->next_block_index = -1;
+}
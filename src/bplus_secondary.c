@@ -0,0 +1,700 @@
+#include <limits.h>
+#include <stdint.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_secondary.h"
+
+#define POSTINGS_BLOCK_START ((int)(sizeof(int) + sizeof(PostingsNodeHeader)))
+#define POSTING_MAX_LENGTH 5 // bytes of the longest varint of a 32-bit difference
+
+// an entry is a record of the index file with the indexed attributes, then these two INT attributes
+#define ENTRY_FIRST_KEY_NAME "_first_key" // the first primary key of the value
+#define ENTRY_POSTINGS_NAME "_postings" // the first postings block of the value, -1 for none
+
+// returns the difference of primary_key from previous_key, which wraps around as a 32-bit value, so that any two keys
+// have one
+static int32_t key_difference(int primary_key, int previous_key)
+{
+    return (int32_t)((uint32_t)primary_key - (uint32_t)previous_key);
+}
+
+// writes the varint of the zigzag encoding of difference (so that small negative differences are short too) to bytes
+// returns its length
+static int write_posting(unsigned char *bytes, int32_t difference)
+{
+    uint32_t value = ((uint32_t)difference << 1) ^ (uint32_t)(difference >> 31);
+    int length = 0;
+    while (value >= 0x80) {
+        bytes[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    bytes[length++] = (unsigned char)value;
+    return length;
+}
+
+// reads a varint written by write_posting() from bytes to difference
+// returns its length
+static int read_posting(const unsigned char *bytes, int32_t *difference)
+{
+    uint32_t value = 0;
+    int length = 0;
+    do {
+        value |= (uint32_t)(bytes[length] & 0x7f) << (7 * length);
+    } while (bytes[length++] & 0x80 && length < POSTING_MAX_LENGTH);
+
+    *difference = (int32_t)((value >> 1) ^ (0u - (value & 1)));
+    return length;
+}
+
+// returns the index file name of attr_names of file_name (caller frees), or NULL if unsuccessful
+static char *index_file_name(const char *file_name, const char *attr_names)
+{
+    char *name = malloc(strlen(file_name) + 1 + strlen(attr_names) + sizeof(BPLUS_SECONDARY_SUFFIX));
+    if (!name)
+        return NULL;
+
+    sprintf(name, "%s.%s%s", file_name, attr_names, BPLUS_SECONDARY_SUFFIX);
+    return name;
+}
+
+// returns the schema of the entries of secondary, an index of the tree with schema: the indexed attributes (as they
+// are in schema), then _first_key and _postings
+static TableSchema index_schema(const struct bplus_secondary *secondary, const TableSchema *schema)
+{
+    int count = secondary->format.attribute_count;
+    AttributeSchema attrs[MAX_ATTRIBUTES];
+    for (int i = 0; i < count; i++)
+        attrs[i] = schema->attributes[secondary->format.attributes[i]];
+    attrs[count] = (AttributeSchema){ ENTRY_FIRST_KEY_NAME, TYPE_INT, 0 };
+    attrs[count + 1] = (AttributeSchema){ ENTRY_POSTINGS_NAME, TYPE_INT, 0 };
+
+    TableSchema index;
+    schema_init(&index, attrs, count + 2, attrs[0].name);
+    return index;
+}
+
+// writes the entry of secondary with the values of record (of the tree) to entry, with no postings
+static void make_entry(const struct bplus_secondary *secondary, const Record *record, Record *entry)
+{
+    memset(entry, 0, sizeof(Record));
+    for (int i = 0; i < secondary->format.attribute_count; i++)
+        entry->values[i] = record->values[secondary->format.attributes[i]];
+    entry->values[secondary->format.attribute_count + 1].int_value = -1;
+}
+
+// returns the first primary key of entry (of secondary)
+static int entry_first_key(const struct bplus_secondary *secondary, const Record *entry)
+{
+    return entry->values[secondary->format.attribute_count].int_value;
+}
+
+// returns the first postings block of entry (of secondary), -1 if it has none
+static int entry_postings(const struct bplus_secondary *secondary, const Record *entry)
+{
+    return entry->values[secondary->format.attribute_count + 1].int_value;
+}
+
+// returns the open index of handle with format, or NULL if there is none
+static struct bplus_secondary *find_index(BPlusHandle *handle, const BPlusKeyFormat *format)
+{
+    for (int i = 0; i < BPLUS_MAX_SECONDARY_INDEXES; i++) {
+        struct bplus_secondary *secondary = handle->secondary[i];
+        if (secondary && secondary->format.attribute_count == format->attribute_count &&
+            memcmp(secondary->format.attributes, format->attributes, format->attribute_count * sizeof(int)) == 0)
+            return secondary;
+    }
+
+    return NULL;
+}
+
+// allocates an empty postings block in the index file of secondary, which block 0 and the metadata of the index count
+// block is an initialized BF block handle, which is pinned to the new block on success
+// returns the index of the block, or -1 if unsuccessful
+static int allocate_postings_block(struct bplus_secondary *secondary, BF_Block *block)
+{
+    if (BF_AllocateBlock(secondary->file_desc, block) != BF_OK)
+        return -1;
+    char *block_start = BF_Block_GetData(block);
+
+    int block_type = BLOCK_TYPE_POSTINGS;
+    PostingsNodeHeader header = { 0, 0, 0, -1, -1 };
+    memcpy(block_start, &block_type, sizeof(int));
+    memcpy(block_start + sizeof(int), &header, sizeof(PostingsNodeHeader));
+    BF_Block_SetDirty(block);
+
+    // the new block is counted in block 0, where the inserts into the index file read the block count from
+    BF_Block *header_block;
+    BF_Block_Init(&header_block);
+    if (BF_GetBlock(secondary->file_desc, 0, header_block) != BF_OK) {
+        BF_Block_Destroy(&header_block);
+        BF_UnpinBlock(block);
+        return -1;
+    }
+    char *header_block_start = BF_Block_GetData(header_block);
+
+    BPlusMeta header_metadata;
+    memcpy(&header_metadata, header_block_start, sizeof(BPlusMeta));
+    header_metadata.block_count++;
+    memcpy(header_block_start, &header_metadata, sizeof(BPlusMeta));
+    BF_Block_SetDirty(header_block);
+    BF_UnpinBlock(header_block);
+    BF_Block_Destroy(&header_block);
+
+    secondary->metadata->block_count = header_metadata.block_count;
+    bplus_handle_touch(secondary->file_desc, header_metadata.block_count - 1, BPLUS_ACCESS_NORMAL);
+    return header_metadata.block_count - 1;
+}
+
+// reads the header of the postings block with block_index of the index file of secondary to header
+// block is an initialized BF block handle, which is left pinned to the block on success
+// returns 0 on success, -1 if unsuccessful (also if it is not a postings block)
+static int get_postings_block(const struct bplus_secondary *secondary, int block_index, BF_Block *block,
+                              PostingsNodeHeader *header)
+{
+    bplus_pool_check(secondary->file_desc);
+    if (BF_GetBlock(secondary->file_desc, block_index, block) != BF_OK)
+        return -1;
+    bplus_handle_touch(secondary->file_desc, block_index, BPLUS_ACCESS_NORMAL);
+    const char *block_start = BF_Block_GetData(block);
+
+    int block_type;
+    memcpy(&block_type, block_start, sizeof(int));
+    if (block_type != BLOCK_TYPE_POSTINGS) {
+        BF_UnpinBlock(block);
+        return -1;
+    }
+
+    memcpy(header, block_start + sizeof(int), sizeof(PostingsNodeHeader));
+    return 0;
+}
+
+// writes header to the postings block pinned in block, and unpins it
+static void put_postings_header(BF_Block *block, const PostingsNodeHeader *header)
+{
+    memcpy(BF_Block_GetData(block) + sizeof(int), header, sizeof(PostingsNodeHeader));
+    BF_Block_SetDirty(block);
+    BF_UnpinBlock(block);
+}
+
+// appends primary_key to the postings blocks of the value of entry (of secondary), in a new block if the last one is
+// full or the value has none yet; entry gets the new block if it is the first one of the value
+// block is an initialized BF block handle
+// returns 1 if entry changed, 0 if not, -1 if unsuccessful
+static int append_posting(struct bplus_secondary *secondary, Record *entry, int primary_key, BF_Block *block)
+{
+    int first_index = entry_postings(secondary, entry);
+    int last_index = -1;
+    int previous_key = entry_first_key(secondary, entry);
+    unsigned char bytes[POSTING_MAX_LENGTH];
+
+    // the last block takes the key if it has room
+    if (first_index != -1) {
+        PostingsNodeHeader header;
+        if (get_postings_block(secondary, first_index, block, &header) == -1)
+            return -1;
+        last_index = header.last_index;
+        if (last_index != first_index) {
+            BF_UnpinBlock(block);
+            if (get_postings_block(secondary, last_index, block, &header) == -1)
+                return -1;
+        }
+        char *block_start = BF_Block_GetData(block);
+
+        int length = write_posting(bytes, key_difference(primary_key, header.last_key));
+        if (POSTINGS_BLOCK_START + header.used + length <= BF_BLOCK_SIZE) {
+            memcpy(block_start + POSTINGS_BLOCK_START + header.used, bytes, length);
+            header.count++;
+            header.last_key = primary_key;
+            header.used += length;
+            put_postings_header(block, &header);
+            return 0;
+        }
+
+        previous_key = header.last_key;
+        BF_UnpinBlock(block);
+    }
+
+    // else it goes to a new last block, whose first difference is from the last key before it
+    int block_index = allocate_postings_block(secondary, block);
+    if (block_index == -1)
+        return -1;
+    char *block_start = BF_Block_GetData(block);
+
+    int length = write_posting(bytes, key_difference(primary_key, previous_key));
+    PostingsNodeHeader header = { 1, primary_key, length, -1, block_index };
+    memcpy(block_start + sizeof(int), &header, sizeof(PostingsNodeHeader));
+    memcpy(block_start + POSTINGS_BLOCK_START, bytes, length);
+    BF_Block_SetDirty(block);
+    BF_UnpinBlock(block);
+
+    if (first_index == -1) {
+        entry->values[secondary->format.attribute_count + 1].int_value = block_index;
+        return 1;
+    }
+
+    // linking the previous last block to it, and the first block of the chain to its new last block
+    PostingsNodeHeader last_header;
+    if (get_postings_block(secondary, last_index, block, &last_header) == -1)
+        return -1;
+    last_header.next_index = block_index;
+    if (last_index == first_index)
+        last_header.last_index = block_index;
+    put_postings_header(block, &last_header);
+
+    if (last_index != first_index) {
+        PostingsNodeHeader first_header;
+        if (get_postings_block(secondary, first_index, block, &first_header) == -1)
+            return -1;
+        first_header.last_index = block_index;
+        put_postings_header(block, &first_header);
+    }
+    return 0;
+}
+
+// adds the primary key of record (of the tree of metadata) to the entry of its values in secondary, which is made if
+// the value has none yet
+// returns 0 on success, -1 if unsuccessful
+static int add_record(struct bplus_secondary *secondary, const BPlusMeta *metadata, const Record *record)
+{
+    int primary_key = record_get_key(&(metadata->schema), record);
+    Record probe;
+    make_entry(secondary, record, &probe);
+
+    Record entry;
+    int found = bplus_keyed_get(secondary->file_desc, secondary->metadata, &probe, &entry);
+    if (found == -1)
+        return -1;
+    if (!found) {
+        probe.values[secondary->format.attribute_count].int_value = primary_key;
+        return (bplus_record_insert(secondary->file_desc, secondary->metadata, &probe) == -1) ? -1 : 0;
+    }
+
+    BF_Block *block;
+    BF_Block_Init(&block);
+    int changed = append_posting(secondary, &entry, primary_key, block);
+    BF_Block_Destroy(&block);
+    if (changed == 1 && bplus_record_update(secondary->file_desc, secondary->metadata, &entry) != 1)
+        return -1;
+    return (changed == -1) ? -1 : 0;
+}
+
+// copies the postings block with block_index of the index file of secondary to block_copy (BF_BLOCK_SIZE bytes)
+// returns 0 on success, -1 if unsuccessful (also if it is not a postings block)
+static int read_postings_block(const struct bplus_secondary *secondary, int block_index, unsigned char *block_copy)
+{
+    BF_Block *block;
+    BF_Block_Init(&block);
+    PostingsNodeHeader header;
+    int result = get_postings_block(secondary, block_index, block, &header);
+    if (result == 0) {
+        memcpy(block_copy, BF_Block_GetData(block), BF_BLOCK_SIZE);
+        BF_UnpinBlock(block);
+    }
+
+    BF_Block_Destroy(&block);
+    return result;
+}
+
+// writes the indexed_modification_count of the metadata of secondary to block 0 of its index file
+// returns 0 on success, -1 if unsuccessful
+static int save_indexed_count(const struct bplus_secondary *secondary)
+{
+    BF_Block *block;
+    BF_Block_Init(&block);
+    if (BF_GetBlock(secondary->file_desc, 0, block) != BF_OK) {
+        BF_Block_Destroy(&block);
+        return -1;
+    }
+    char *block_start = BF_Block_GetData(block);
+
+    BPlusMeta header_metadata;
+    memcpy(&header_metadata, block_start, sizeof(BPlusMeta));
+    header_metadata.indexed_modification_count = secondary->metadata->indexed_modification_count;
+    memcpy(block_start, &header_metadata, sizeof(BPlusMeta));
+    BF_Block_SetDirty(block);
+    BF_UnpinBlock(block);
+    BF_Block_Destroy(&block);
+    return 0;
+}
+
+// closes the index tree of the index in slot of handle and frees it; its file is removed if remove_file is 1, else it
+// records which modification of the tree the index is up to date with
+static void drop_index(BPlusHandle *handle, int slot, int remove_file)
+{
+    struct bplus_secondary *secondary = handle->secondary[slot];
+    handle->secondary[slot] = NULL;
+
+    if (!remove_file && save_indexed_count(secondary) == -1)
+        remove_file = 1; // the next open would not know if the index is up to date, so it rebuilds it anyway
+
+    bplus_close_file(secondary->file_desc, secondary->metadata);
+    if (remove_file)
+        remove(secondary->file_name);
+
+    free(secondary->file_name);
+    free(secondary);
+}
+
+// returns the number of postings in the entries of the index file of secondary and their postings blocks, or -1 on
+// error
+static long count_postings(const struct bplus_secondary *secondary)
+{
+    BPlusKeyedScan scan;
+    if (bplus_keyed_scan_open(&scan, secondary->file_desc, secondary->metadata, NULL) == -1)
+        return -1;
+
+    long count = 0;
+    Record entry;
+    unsigned char block[BF_BLOCK_SIZE];
+    int result;
+    while ((result = bplus_keyed_scan_next(&scan, &entry)) == 1) {
+        count++; // the first key of the value
+
+        for (int block_index = entry_postings(secondary, &entry); block_index != -1; ) {
+            if (read_postings_block(secondary, block_index, block) == -1) {
+                result = -1;
+                break;
+            }
+
+            PostingsNodeHeader block_header;
+            memcpy(&block_header, block + sizeof(int), sizeof(PostingsNodeHeader));
+            count += block_header.count;
+            block_index = block_header.next_index;
+        }
+        if (result == -1)
+            break;
+    }
+
+    bplus_keyed_scan_close(&scan);
+    return (result == -1) ? -1 : count;
+}
+
+// opens the index file of secondary, if it exists and is up to date with the tree of metadata: it is a keyed file of
+// the entries of secondary, it was last in sync with the same modification_count of the tree (an update in place
+// while the index was closed changes it but not the number of records), and has a posting for every record
+// returns 0 on success, -1 if there is no such index file
+static int open_index(struct bplus_secondary *secondary, const BPlusMeta *metadata)
+{
+    const char *name = secondary->file_name;
+    FILE *file = fopen(name, "rb"); // BF reports an error for a missing file, so that case is checked first
+    if (!file)
+        return -1;
+    fclose(file);
+
+    if (bplus_open_file(name, &(secondary->file_desc), &(secondary->metadata)) == -1)
+        return -1;
+
+    // an index of a previous format (an int key tree of hashed entries) is not a keyed file, and is rebuilt
+    TableSchema schema = index_schema(secondary, &(metadata->schema));
+    const TableSchema *file_schema = &(secondary->metadata->schema);
+    int same_schema = bplus_file_is_keyed(secondary->metadata) && file_schema->count == schema.count;
+    for (int i = 0; i < schema.count && same_schema; i++) {
+        same_schema = strcmp(file_schema->attributes[i].name, schema.attributes[i].name) == 0 &&
+                      file_schema->attributes[i].type == schema.attributes[i].type &&
+                      file_schema->attributes[i].length == schema.attributes[i].length;
+    }
+
+    if (same_schema && secondary->metadata->indexed_modification_count == metadata->modification_count &&
+        count_postings(secondary) == metadata->record_count)
+        return 0;
+
+    bplus_close_file(secondary->file_desc, secondary->metadata);
+    return -1;
+}
+
+// creates the index file of secondary, the index of attr_names, and adds the postings of all records of the tree of
+// file_desc to it by a scan over the leaf chain (so the postings of each value are in ascending order, and their
+// differences are short)
+// returns 0 on success, -1 if unsuccessful
+static int build_index(struct bplus_secondary *secondary, const char *attr_names, int file_desc,
+                       const BPlusMeta *metadata)
+{
+    const char *name = secondary->file_name;
+    remove(name);
+    TableSchema schema = index_schema(secondary, &(metadata->schema));
+    if (bplus_create_keyed_file(&schema, name, attr_names) == -1)
+        return -1;
+    if (bplus_open_file(name, &(secondary->file_desc), &(secondary->metadata)) == -1)
+        return -1;
+
+    BPlusScan scan;
+    int result = bplus_scan_open(&scan, file_desc, metadata, INT_MIN, BPLUS_ACCESS_SCAN);
+    if (result == 0) {
+        Record record;
+        while ((result = bplus_scan_next(&scan, &record)) == 1) {
+            if (add_record(secondary, metadata, &record) == -1) {
+                result = -1;
+                break;
+            }
+        }
+        bplus_scan_close(&scan);
+    }
+
+    if (result == -1) {
+        bplus_close_file(secondary->file_desc, secondary->metadata);
+        remove(name);
+        return -1;
+    }
+
+    secondary->metadata->indexed_modification_count = metadata->modification_count;
+    return 0;
+}
+
+int bplus_create_secondary_index(int file_desc, const BPlusMeta *metadata, const char *attr_names)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || !attr_names || bplus_file_is_keyed(metadata))
+        return -1;
+
+    // the entries have room for the indexed attributes and their two INT attributes
+    BPlusKeyFormat format;
+    if (bplus_key_format_init(&format, &(metadata->schema), attr_names) == -1 ||
+        format.attribute_count > MAX_ATTRIBUTES - 2 ||
+        (format.attribute_count == 1 && format.attributes[0] == metadata->schema.key_index))
+        return -1;
+    if (find_index(handle, &format)) // already open
+        return 0;
+
+    int slot = 0;
+    while (slot < BPLUS_MAX_SECONDARY_INDEXES && handle->secondary[slot])
+        slot++;
+    if (slot == BPLUS_MAX_SECONDARY_INDEXES)
+        return -1;
+
+    struct bplus_secondary *secondary = calloc(1, sizeof(struct bplus_secondary));
+    if (!secondary)
+        return -1;
+    secondary->format = format;
+    secondary->file_name = index_file_name(handle->file_name, attr_names);
+    if (!(secondary->file_name)) {
+        free(secondary);
+        return -1;
+    }
+
+    int result = open_index(secondary, metadata);
+    if (result == -1)
+        result = build_index(secondary, attr_names, file_desc, metadata);
+
+    if (result == -1) {
+        free(secondary->file_name);
+        free(secondary);
+        return -1;
+    }
+
+    handle->secondary[slot] = secondary;
+    return 0;
+}
+
+// starts scan over the entries of the index of attr_names with values from those of low to those of high
+// returns 0 on success, -1 on failure
+static int open_scan(BPlusSecondaryScan *scan, int file_desc, const BPlusMeta *metadata, const char *attr_names,
+                     const Record *low, const Record *high)
+{
+    memset(scan, 0, sizeof(BPlusSecondaryScan));
+    scan->is_at_end = 1;
+    scan->next_block = -1;
+
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || !attr_names || !low || !high)
+        return -1;
+
+    BPlusKeyFormat format;
+    if (bplus_key_format_init(&format, &(metadata->schema), attr_names) == -1)
+        return -1;
+
+    scan->secondary = find_index(handle, &format);
+    if (!(scan->secondary))
+        return -1;
+    const struct bplus_secondary *secondary = scan->secondary;
+
+    Record low_entry, high_entry;
+    make_entry(secondary, low, &low_entry);
+    make_entry(secondary, high, &high_entry);
+    bplus_key_encode(&(secondary->metadata->key_format), &(secondary->metadata->schema), &high_entry,
+                     scan->high_key);
+    if (bplus_keyed_scan_open(&(scan->entries), secondary->file_desc, secondary->metadata, &low_entry) == -1)
+        return -1;
+
+    scan->is_at_end = 0;
+    return 0;
+}
+
+int bplus_secondary_scan_open(BPlusSecondaryScan *scan, int file_desc, const BPlusMeta *metadata,
+                              const char *attr_names, const Record *probe)
+{
+    return open_scan(scan, file_desc, metadata, attr_names, probe, probe);
+}
+
+int bplus_secondary_range_open(BPlusSecondaryScan *scan, int file_desc, const BPlusMeta *metadata,
+                               const char *attr_names, const Record *low, const Record *high)
+{
+    return open_scan(scan, file_desc, metadata, attr_names, low, high);
+}
+
+int bplus_secondary_scan_next(BPlusSecondaryScan *scan, int *primary_key)
+{
+    // moving to the next postings block of the entry, or else to the next entry of the scan, whose first key is
+    // returned from the entry
+    while (scan->remaining == 0) {
+        if (scan->next_block != -1) {
+            if (read_postings_block(scan->secondary, scan->next_block, scan->block) == -1)
+                return -1;
+
+            PostingsNodeHeader block_header;
+            memcpy(&block_header, scan->block + sizeof(int), sizeof(PostingsNodeHeader));
+            scan->remaining = block_header.count;
+            scan->position = POSTINGS_BLOCK_START;
+            scan->next_block = block_header.next_index;
+            continue;
+        }
+
+        if (scan->is_at_end)
+            return 0;
+
+        Record entry;
+        int result = bplus_keyed_scan_next(&(scan->entries), &entry);
+        if (result == -1)
+            return -1;
+
+        const struct bplus_secondary *secondary = scan->secondary;
+        unsigned char key[BPLUS_KEY_MAX_LENGTH];
+        int comparison = 1;
+        if (result == 1) {
+            bplus_key_encode(&(secondary->metadata->key_format), &(secondary->metadata->schema), &entry, key);
+            comparison = bplus_key_compare(&(secondary->metadata->key_format), key, scan->high_key);
+        }
+        if (comparison > 0) {
+            scan->is_at_end = 1;
+            return 0;
+        }
+        if (comparison == 0) // the values are unique, so no other entry is at most the highest ones
+            scan->is_at_end = 1;
+
+        scan->last_key = entry_first_key(secondary, &entry);
+        scan->next_block = entry_postings(secondary, &entry);
+        *primary_key = scan->last_key;
+        return 1;
+    }
+
+    int32_t difference;
+    scan->position += read_posting(scan->block + scan->position, &difference);
+    scan->last_key = (int)((uint32_t)scan->last_key + (uint32_t)difference);
+    scan->remaining--;
+
+    *primary_key = scan->last_key;
+    return 1;
+}
+
+void bplus_secondary_scan_close(BPlusSecondaryScan *scan)
+{
+    if (scan->secondary)
+        bplus_keyed_scan_close(&(scan->entries));
+    memset(scan, 0, sizeof(BPlusSecondaryScan));
+    scan->is_at_end = 1;
+    scan->next_block = -1;
+}
+
+int bplus_secondary_find(int file_desc, const BPlusMeta *metadata, const char *attr_names, const Record *probe,
+                         int *primary_keys, int max_keys)
+{
+    BPlusSecondaryScan scan;
+    if (bplus_secondary_scan_open(&scan, file_desc, metadata, attr_names, probe) == -1) {
+        bplus_secondary_scan_close(&scan);
+        return -1;
+    }
+
+    int count = 0;
+    int primary_key;
+    int result;
+    while ((result = bplus_secondary_scan_next(&scan, &primary_key)) == 1) {
+        if (count < max_keys)
+            primary_keys[count] = primary_key;
+        count++;
+    }
+
+    bplus_secondary_scan_close(&scan);
+    return (result == -1) ? -1 : count;
+}
+
+int bplus_secondary_find_records(int file_desc, const BPlusMeta *metadata, const char *attr_names,
+                                 const Record *probe, Record *records, int max_records)
+{
+    int *primary_keys = malloc((max_records > 0 ? max_records : 1) * sizeof(int));
+    if (!primary_keys)
+        return -1;
+
+    int count = bplus_secondary_find(file_desc, metadata, attr_names, probe, primary_keys, max_records);
+    for (int i = 0; i < count && i < max_records; i++) {
+        if (bplus_record_get(file_desc, metadata, primary_keys[i], &(records[i])) != 1) {
+            count = -1; // the index has a posting for a record that the tree does not
+            break;
+        }
+    }
+
+    free(primary_keys);
+    return count;
+}
+
+int bplus_secondary_stats(int file_desc, const BPlusMeta *metadata, const char *attr_names,
+                          BPlusSecondaryStats *stats)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    BPlusKeyFormat format;
+    if (!handle || !metadata || !attr_names ||
+        bplus_key_format_init(&format, &(metadata->schema), attr_names) == -1)
+        return -1;
+
+    const struct bplus_secondary *secondary = find_index(handle, &format);
+    if (!secondary)
+        return -1;
+
+    stats->entry_count = secondary->metadata->record_count;
+    stats->block_count = secondary->metadata->block_count;
+    return 0;
+}
+
+void bplus_secondary_add(BPlusHandle *handle, const BPlusMeta *metadata, const Record *record)
+{
+    for (int i = 0; i < BPLUS_MAX_SECONDARY_INDEXES; i++) {
+        struct bplus_secondary *secondary = handle->secondary[i];
+        if (!secondary)
+            continue;
+
+        // the inserts into the index tree write its block 0 over its metadata, so the count is set after them
+        if (add_record(secondary, metadata, record) == -1)
+            drop_index(handle, i, 1);
+        else
+            secondary->metadata->indexed_modification_count = metadata->modification_count;
+    }
+}
+
+void postings_block_print(const char *block_start)
+{
+    int block_type;
+    memcpy(&block_type, block_start, sizeof(int));
+    if (block_type != BLOCK_TYPE_POSTINGS) {
+        perror("Not a postings block\n");
+        return;
+    }
+
+    PostingsNodeHeader header;
+    memcpy(&header, block_start + sizeof(int), sizeof(PostingsNodeHeader));
+
+    for (int i = 0; i < 20; i++) printf("-");
+    printf("\n");
+    printf("count = %d\n", header.count);
+    printf("last_key = %d\n", header.last_key);
+    printf("used = %d\n", header.used);
+    printf("next_index = %d\n", header.next_index);
+    printf("last_index = %d\n\n", header.last_index);
+    for (int i = 0; i < 20; i++) printf("-");
+    printf("\n");
+}
+
+void bplus_secondary_close(BPlusHandle *handle)
+{
+    for (int i = 0; i < BPLUS_MAX_SECONDARY_INDEXES; i++) {
+        if (handle->secondary[i])
+            drop_index(handle, i, 0);
+    }
+}
@@ -0,0 +1,216 @@
+#define _POSIX_C_SOURCE 200112L // posix_fadvise()
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/bplus_file_funcs.h"
+#include "../include/bplus_warm.h"
+
+static const char WARM_MAGIC_NUM[4] = { 'B', 'P', 'W', '2' }; // this identifies a sidecar file (of the layout below)
+
+// returns the sidecar file name of file_name (caller frees), or NULL if unsuccessful
+static char *warm_file_name(const char *file_name)
+{
+    char *name = malloc(strlen(file_name) + sizeof(BPLUS_WARM_SUFFIX));
+    if (!name)
+        return NULL;
+
+    strcpy(name, file_name);
+    strcat(name, BPLUS_WARM_SUFFIX);
+    return name;
+}
+
+// orders entries from the most to the least recently accessed
+static int compare_by_recency(const void *a, const void *b)
+{
+    const struct bplus_warm_entry *entry_a = a;
+    const struct bplus_warm_entry *entry_b = b;
+    return (entry_a->last_access < entry_b->last_access) - (entry_a->last_access > entry_b->last_access);
+}
+
+// orders entries by ascending block index
+static int compare_by_block_index(const void *a, const void *b)
+{
+    const struct bplus_warm_entry *entry_a = a;
+    const struct bplus_warm_entry *entry_b = b;
+    return (entry_a->block_index > entry_b->block_index) - (entry_a->block_index < entry_b->block_index);
+}
+
+int bplus_warm_enable(int file_desc)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle)
+        return -1;
+    if (handle->warm_blocks)
+        return 0;
+
+    handle->warm_blocks = malloc(BPLUS_WARM_TABLE_SIZE * sizeof(struct bplus_warm_entry));
+    if (!handle->warm_blocks)
+        return -1;
+
+    for (int i = 0; i < BPLUS_WARM_TABLE_SIZE; i++) {
+        handle->warm_blocks[i].block_index = -1;
+        handle->warm_blocks[i].last_access = 0;
+    }
+    handle->warm_count = 0;
+    return 0;
+}
+
+void bplus_warm_touch(int file_desc, int block_index)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !handle->warm_blocks)
+        return;
+
+    // the block replaces whichever block had its slot; that one was accessed less recently
+    struct bplus_warm_entry *slot = &(handle->warm_blocks[block_index & (BPLUS_WARM_TABLE_SIZE - 1)]);
+    if (slot->block_index == -1)
+        handle->warm_count++;
+
+    slot->block_index = block_index;
+    slot->last_access = ++(handle->warm_clock);
+}
+
+// sidecar layout:
+/* [char magic_num[4]][int entry_count][entry][entry]...[entry]
+** an entry is [int block_index][int rank]; entries are ordered from the most to the least recently accessed, and
+** rank is the position in that order (0 for the most recent), so the clocks of different runs never need to be
+** compared
+*/
+void bplus_warm_close(BPlusHandle *handle)
+{
+    if (!handle->warm_blocks)
+        return;
+
+    char *name = warm_file_name(handle->file_name);
+    if (handle->warm_count > 0 && name) {
+        // moving the tracked blocks to the front of the table, then keeping the most recent ones
+        int entry_count = 0;
+        for (int i = 0; i < BPLUS_WARM_TABLE_SIZE; i++) {
+            if (handle->warm_blocks[i].block_index != -1)
+                handle->warm_blocks[entry_count++] = handle->warm_blocks[i];
+        }
+        qsort(handle->warm_blocks, entry_count, sizeof(struct bplus_warm_entry), compare_by_recency);
+        if (entry_count > BPLUS_WARM_MAX_BLOCKS)
+            entry_count = BPLUS_WARM_MAX_BLOCKS;
+
+        FILE *file = fopen(name, "wb");
+        if (file) {
+            fwrite(WARM_MAGIC_NUM, sizeof(WARM_MAGIC_NUM), 1, file);
+            fwrite(&entry_count, sizeof(int), 1, file);
+            for (int rank = 0; rank < entry_count; rank++) {
+                fwrite(&(handle->warm_blocks[rank].block_index), sizeof(int), 1, file);
+                fwrite(&rank, sizeof(int), 1, file);
+            }
+            fclose(file);
+        }
+    }
+
+    free(name);
+    free(handle->warm_blocks);
+    handle->warm_blocks = NULL;
+    handle->warm_count = 0;
+}
+
+// reads the entries of the sidecar file of file_name into entries (at most BPLUS_WARM_MAX_BLOCKS)
+// returns the number of entries read, 0 if there is no valid sidecar file
+static int read_warm_file(const char *file_name, struct bplus_warm_entry *entries)
+{
+    char *name = warm_file_name(file_name);
+    if (!name)
+        return 0;
+
+    FILE *file = fopen(name, "rb");
+    free(name);
+    if (!file)
+        return 0;
+
+    char magic_num[4];
+    int entry_count = 0;
+    if (fread(magic_num, sizeof(magic_num), 1, file) != 1 ||
+        memcmp(magic_num, WARM_MAGIC_NUM, sizeof(WARM_MAGIC_NUM)) != 0 ||
+        fread(&entry_count, sizeof(int), 1, file) != 1 || entry_count < 0) {
+        fclose(file);
+        return 0;
+    }
+
+    if (entry_count > BPLUS_WARM_MAX_BLOCKS)
+        entry_count = BPLUS_WARM_MAX_BLOCKS; // the most recent ones come first
+
+    // turning the saved ranks back into clock values (higher is more recent)
+    int read_count = 0;
+    for (int i = 0; i < entry_count; i++) {
+        int rank;
+        if (fread(&(entries[read_count].block_index), sizeof(int), 1, file) != 1 ||
+            fread(&rank, sizeof(int), 1, file) != 1)
+            break;
+        entries[read_count++].last_access = entry_count - rank;
+    }
+    entry_count = read_count;
+
+    fclose(file);
+    return entry_count;
+}
+
+// has the kernel read the blocks of entries (sorted by block index) into the page cache, one read per run of
+// adjacent blocks, so that the BF reads that follow do not wait for the device
+static void read_ahead_blocks(const char *file_name, const struct bplus_warm_entry *entries, int entry_count)
+{
+    int fd = open(file_name, O_RDONLY);
+    if (fd == -1)
+        return;
+
+    int run_start = 0;
+    for (int i = 1; i <= entry_count; i++) {
+        if (i < entry_count && entries[i].block_index == entries[i - 1].block_index + 1)
+            continue;
+
+        off_t offset = (off_t)entries[run_start].block_index * BF_BLOCK_SIZE;
+        off_t length = (off_t)(entries[i - 1].block_index - entries[run_start].block_index + 1) * BF_BLOCK_SIZE;
+        posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+        run_start = i;
+    }
+
+    close(fd);
+}
+
+int bplus_warm_preload(int file_desc, const BPlusMeta *metadata)
+{
+    BPlusHandle *handle = bplus_handle_get(file_desc);
+    if (!handle || !metadata || bplus_mmap_is_mapped(handle))
+        return -1;
+
+    struct bplus_warm_entry entries[BPLUS_WARM_MAX_BLOCKS];
+    int read_count = read_warm_file(handle->file_name, entries);
+
+    // skipping blocks that are no longer in the file
+    int entry_count = 0;
+    for (int i = 0; i < read_count; i++) {
+        if (entries[i].block_index >= 0 && entries[i].block_index < metadata->block_count)
+            entries[entry_count++] = entries[i];
+    }
+    if (entry_count == 0)
+        return 0;
+
+    qsort(entries, entry_count, sizeof(struct bplus_warm_entry), compare_by_block_index);
+    read_ahead_blocks(handle->file_name, entries, entry_count);
+
+    // getting the blocks into the BF frames, the most recently accessed last (it is the last to be evicted)
+    qsort(entries, entry_count, sizeof(struct bplus_warm_entry), compare_by_recency);
+
+    BF_Block *block;
+    BF_Block_Init(&block);
+    for (int i = entry_count - 1; i >= 0; i--) {
+        BF_ErrorCode code = BF_GetBlock(file_desc, entries[i].block_index, block);
+        if (code != BF_OK) {
+            BF_PrintError(code);
+            BF_Block_Destroy(&block);
+            return -1;
+        }
+        BF_UnpinBlock(block);
+
+        bplus_handle_touch(file_desc, entries[i].block_index, BPLUS_ACCESS_NORMAL); // the saved order carries over to the next close
+    }
+    BF_Block_Destroy(&block);
+
+    return entry_count;
+}
@@ -21,6 +21,9 @@ void schema_init(TableSchema *schema, const AttributeSchema *attrs, const int at
             case TYPE_FLOAT:
                 schema->record_size += sizeof(float);
                 break;
+            case TYPE_LONG:
+                schema->record_size += sizeof(long long);
+                break;
             case TYPE_CHAR:
                 schema->record_size += attrs[i].length;
                 break;
@@ -50,6 +53,9 @@ void record_create(const TableSchema *schema, Record* record, ...) {
             case TYPE_FLOAT:
                 record->values[i].float_value = (float)va_arg(args, double);
                 break;
+            case TYPE_LONG:
+                record->values[i].long_value = va_arg(args, long long);
+                break;
             case TYPE_CHAR: {
                 const char *str = va_arg(args, char *);
                 strncpy(record->values[i].string_value, str, attr->length);
@@ -90,6 +96,9 @@ void schema_print(const TableSchema *schema){
             case TYPE_FLOAT:
                 printf("FLOAT");
                 break;
+            case TYPE_LONG:
+                printf("LONG");
+                break;
             case TYPE_CHAR:
                 printf("CHAR(%d)", attr->length);
                 break;
@@ -115,6 +124,9 @@ void record_print(const TableSchema *schema, const Record *record) {
             case TYPE_FLOAT:
                 printf("%.2f", record->values[i].float_value);
                 break;
+            case TYPE_LONG:
+                printf("%lld", record->values[i].long_value);
+                break;
             case TYPE_CHAR:
                 printf("%s", record->values[i].string_value);
                 break;
@@ -136,6 +148,8 @@ DataType get_type(const TableSchema *schema, const char *attr_name) {
                     return TYPE_INT; // Success
                 case TYPE_FLOAT:
                     return TYPE_FLOAT; // Success
+                case TYPE_LONG:
+                    return TYPE_LONG; // Success
                 case TYPE_CHAR:
                     return TYPE_CHAR;
                 default:
@@ -159,6 +173,9 @@ DataType record_get_value(const TableSchema *schema, const Record *record, const
                 }case TYPE_FLOAT: {
                     *(float *) output = record->values[i].float_value;
                     return TYPE_FLOAT; // Success
+                }case TYPE_LONG: {
+                    memcpy(output, &(record->values[i].long_value), sizeof(long long));
+                    return TYPE_LONG; // Success
                 }case TYPE_CHAR: {
                     memcpy(output, record->values[i].string_value, attr->length);
                     return TYPE_CHAR; // Success